@@ -0,0 +1,154 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#include "CallStats.hpp"
+#include <string.h>
+
+namespace cph {
+
+char const * const CallStats::callNames[CALL_TYPES] = {
+  "MQCONNX", "MQDISC", "MQOPEN", "MQCLOSE", "MQSUB", "MQPUT", "MQPUT1",
+  "MQGET", "MQCMIT", "MQBACK", "MQCRTMH", "MQDLTMH", "MQBUFMH", "MQSETMP",
+  "MQCB", "MQCTL", "MQSTAT"
+};
+
+char const * const CallStats::eventNames[EVENT_TYPES] = {
+  "MQGET no message available", "MQGET truncated message retries", "MQGET buffer shrinks",
+  "MQPUT async warnings", "MQPUT async failures",
+  "Replies out of order", "Replies late", "Replies missing",
+  "Reply queue cache hits", "Reply queue cache misses", "Reply queue cache evictions",
+  "Timestamped message gaps", "Timestamped messages out of order"
+};
+
+CallStats::CallStats(){
+  reset();
+}
+
+CallStats::CallStats(CallStats const &other){
+  other.snapshot(*this);
+}
+
+CallStats & CallStats::operator=(CallStats const &other){
+  if(this != &other) other.snapshot(*this);
+  return *this;
+}
+
+/*
+ * Method: snapshot
+ * ----------------
+ *
+ * Copy the current state of these statistics into another object, without interrupting the writer.
+ * The copy is retried if a call was recorded during it; if the writer is so busy that no attempt
+ * succeeds, the last copy is kept, which may include the time but not yet the count of one call.
+ */
+void CallStats::snapshot(CallStats &into) const {
+  for(unsigned int attempt = 0; attempt < CPH_SEQLOCK_READ_ATTEMPTS; attempt++){
+    uint64_t seq = cphSeqlockReadBegin(&sequence);
+    for(unsigned int i=0; i<CALL_TYPES; i++){
+      into.calls[i] = cphAtomicLoad64(&calls[i]);
+      into.failures[i] = cphAtomicLoad64(&failures[i]);
+      into.totalTime[i] = cphAtomicLoad64(&totalTime[i]);
+      into.maxTime[i] = cphAtomicLoad64(&maxTime[i]);
+    }
+    for(unsigned int i=0; i<EVENT_TYPES; i++)
+      into.events[i] = cphAtomicLoad64(&events[i]);
+    if(!cphSeqlockReadRetry(&sequence, seq)) break;
+  }
+  into.sequence = 0;
+}
+
+/*
+ * Method: reset
+ * -------------
+ *
+ * Clear all counts. Not safe to call while another thread is recording.
+ */
+void CallStats::reset(){
+  sequence = 0;
+  memset((void *) calls, 0, sizeof(calls));
+  memset((void *) failures, 0, sizeof(failures));
+  memset((void *) totalTime, 0, sizeof(totalTime));
+  memset((void *) maxTime, 0, sizeof(maxTime));
+  memset((void *) events, 0, sizeof(events));
+}
+
+/*
+ * Method: add
+ * -----------
+ *
+ * Merge the counts of another (quiescent) CallStats into this one.
+ */
+void CallStats::add(CallStats const &other){
+  for(unsigned int i=0; i<CALL_TYPES; i++){
+    calls[i] += other.calls[i];
+    failures[i] += other.failures[i];
+    totalTime[i] += other.totalTime[i];
+    if(other.maxTime[i] > maxTime[i]) maxTime[i] = other.maxTime[i];
+  }
+  for(unsigned int i=0; i<EVENT_TYPES; i++)
+    events[i] += other.events[i];
+}
+
+/*
+ * Method: subtract
+ * ----------------
+ *
+ * Remove the counts in an earlier snapshot of the same CallStats from this one,
+ * leaving only those made in between. The maximum times are left unchanged, so are
+ * the maxima since the statistics were created rather than for the interval.
+ */
+void CallStats::subtract(CallStats const &other){
+  for(unsigned int i=0; i<CALL_TYPES; i++){
+    calls[i] = calls[i] >= other.calls[i] ? calls[i] - other.calls[i] : 0;
+    failures[i] = failures[i] >= other.failures[i] ? failures[i] - other.failures[i] : 0;
+    totalTime[i] = totalTime[i] >= other.totalTime[i] ? totalTime[i] - other.totalTime[i] : 0;
+  }
+  for(unsigned int i=0; i<EVENT_TYPES; i++)
+    events[i] = events[i] >= other.events[i] ? events[i] - other.events[i] : 0;
+}
+
+uint64_t CallStats::getCalls(CallType type) const {
+  return calls[type];
+}
+
+uint64_t CallStats::getFailures(CallType type) const {
+  return failures[type];
+}
+
+uint64_t CallStats::getTotalTime(CallType type) const {
+  return totalTime[type];
+}
+
+uint64_t CallStats::getMaxTime(CallType type) const {
+  return maxTime[type];
+}
+
+uint64_t CallStats::getEvents(CallEvent event) const {
+  return events[event];
+}
+
+}
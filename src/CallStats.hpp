@@ -0,0 +1,167 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#ifndef CALLSTATS_HPP_
+#define CALLSTATS_HPP_
+
+#include "cphAtomic.h"
+
+namespace cph {
+
+/*
+ * The messaging provider calls timed by CallStats.
+ */
+enum CallType {
+  CALL_MQCONNX = 0,
+  CALL_MQDISC,
+  CALL_MQOPEN,
+  CALL_MQCLOSE,
+  CALL_MQSUB,
+  CALL_MQPUT,
+  CALL_MQPUT1,
+  CALL_MQGET,
+  CALL_MQCMIT,
+  CALL_MQBACK,
+  CALL_MQCRTMH,
+  CALL_MQDLTMH,
+  CALL_MQBUFMH,
+  CALL_MQSETMP,
+  CALL_MQCB,
+  CALL_MQCTL,
+  CALL_MQSTAT,
+  CALL_TYPES
+};
+
+/*
+ * Noteworthy call outcomes counted by CallStats: those that are retried rather than treated as failures,
+ * those of asynchronous puts, which are only reported later by MQSTAT, those of the replies to a
+ * Requester's window of requests, those of a Responder's cache of open reply-to-queues, and breaks in
+ * the sequence of timestamped messages (ow).
+ */
+enum CallEvent {
+  /*An MQGET returned MQRC_NO_MSG_AVAILABLE.*/
+  EVENT_GET_NO_MSG = 0,
+  /*An MQGET returned MQRC_TRUNCATED_MSG_FAILED, and was retried with a larger buffer.*/
+  EVENT_GET_TRUNCATED,
+  /*A receive buffer was shrunk after a run of small messages (ra).*/
+  EVENT_GET_BUFFER_SHRUNK,
+  /*An asynchronous put completed with a warning.*/
+  EVENT_ASYNC_PUT_WARNING,
+  /*An asynchronous put failed.*/
+  EVENT_ASYNC_PUT_FAILURE,
+  /*A reply arrived after the reply to a later request.*/
+  EVENT_REPLY_OUT_OF_ORDER,
+  /*A reply arrived after its request had been given up on (or matched no request).*/
+  EVENT_REPLY_LATE,
+  /*A request had no reply within the polling timeout.*/
+  EVENT_REPLY_MISSING,
+  /*A reply-to-queue was found open in a Responder's cache.*/
+  EVENT_REPLYQ_HIT,
+  /*A reply-to-queue had to be opened.*/
+  EVENT_REPLYQ_MISS,
+  /*A reply-to-queue was closed to keep a Responder's cache within its limit.*/
+  EVENT_REPLYQ_EVICTED,
+  /*A timestamped message (ow) skipped sequence numbers of its sender.*/
+  EVENT_ONEWAY_GAP,
+  /*A timestamped message (ow) had a sequence number no higher than one already got from its sender.*/
+  EVENT_ONEWAY_REORDERED,
+  EVENT_TYPES
+};
+
+/*
+ * Class: CallStats
+ * ----------------
+ *
+ * Per-call-type counts and elapsed times of the calls made by a single thread.
+ *
+ * As with Histogram, there is a single writer which never takes a lock; other threads
+ * take a snapshot() and subtract the previous one to find the calls made in an interval.
+ * Each update is bracketed by a seqlock (see cphAtomic.h), so that a snapshot never holds
+ * the time of a call without its count.
+ */
+class CallStats {
+public:
+  static char const * const callNames[CALL_TYPES];
+  static char const * const eventNames[EVENT_TYPES];
+
+  CallStats();
+  CallStats(CallStats const &other);
+  CallStats & operator=(CallStats const &other);
+
+  /*
+   * Method: record
+   * --------------
+   *
+   * Count a single call that took the given number of nanoseconds.
+   * Must only be called by the thread that owns these statistics.
+   */
+  inline void record(CallType type, uint64_t ns, bool failed) {
+    cphSeqlockWriteBegin(&sequence);
+    cphAtomicStore64(&totalTime[type], totalTime[type] + ns);
+    if(ns > maxTime[type]) cphAtomicStore64(&maxTime[type], ns);
+    if(failed) cphAtomicInc64(&failures[type]);
+    cphAtomicInc64(&calls[type]);
+    cphSeqlockWriteEnd(&sequence);
+  }
+
+  /*
+   * Method: count
+   * -------------
+   *
+   * Count occurrences (by default, one) of the given event. Must only be called by the owning thread.
+   */
+  inline void count(CallEvent event, uint64_t occurrences = 1) {
+    cphSeqlockWriteBegin(&sequence);
+    cphAtomicStore64(&events[event], events[event] + occurrences);
+    cphSeqlockWriteEnd(&sequence);
+  }
+
+  void snapshot(CallStats &into) const;
+  void reset();
+  void add(CallStats const &other);
+  void subtract(CallStats const &other);
+
+  uint64_t getCalls(CallType type) const;
+  uint64_t getFailures(CallType type) const;
+  uint64_t getTotalTime(CallType type) const;
+  uint64_t getMaxTime(CallType type) const;
+  uint64_t getEvents(CallEvent event) const;
+
+private:
+  /*Odd while an update is in progress - see cphAtomic.h.*/
+  volatile uint64_t sequence;
+  volatile uint64_t calls[CALL_TYPES];
+  volatile uint64_t failures[CALL_TYPES];
+  /*Nanoseconds.*/
+  volatile uint64_t totalTime[CALL_TYPES];
+  volatile uint64_t maxTime[CALL_TYPES];
+  volatile uint64_t events[EVENT_TYPES];
+};
+
+}
+
+#endif /* CALLSTATS_HPP_ */
@@ -86,6 +86,84 @@ public:
 // END ShutdownException
 ////////////////////////
 
+/*
+ * Function: appendLatencyStats
+ *
+ * Append a summary of the given latency histogram to a statistics line,
+ * with each field name starting with the given prefix.
+ */
+static void appendLatencyStats(std::stringstream &ss, char const * prefix, Histogram const &h){
+  char buff[512];
+  sprintf(buff,
+      "%savg_latency(uSec)=%.0f,%sp50_latency(uSec)=%" PRIu64 ",%sp90_latency(uSec)=%" PRIu64
+      ",%sp99_latency(uSec)=%" PRIu64 ",%sp99.9_latency(uSec)=%" PRIu64 ",%smax_latency(uSec)=%" PRIu64
+      ",%smin_latency(uSec)=%" PRIu64,
+      prefix, h.getMean(),
+      prefix, h.getValueAtPercentile(50),
+      prefix, h.getValueAtPercentile(90),
+      prefix, h.getValueAtPercentile(99),
+      prefix, h.getValueAtPercentile(99.9),
+      prefix, h.getMaxValue(),
+      prefix, h.getMinValue());
+  ss << buff;
+}
+
+/*
+ * Function: appendCpuStats
+ *
+ * Append the CPU time used (seconds, in user and system mode) to a statistics line, with the
+ * CPU time per iteration (microseconds) if any iterations were completed.
+ */
+static void appendCpuStats(std::stringstream &ss, CpuTime const &cpu, uint64_t iterations){
+  char buff[256];
+  sprintf(buff, "cpu_user(sec)=%.3f,cpu_system(sec)=%.3f,cpu_per_iteration(uSec)=%.2f",
+      (double) cpu.user / 1000000000, (double) cpu.system / 1000000000,
+      iterations == 0 ? 0 : (double) (cpu.user + cpu.system) / 1000 / iterations);
+  ss << buff;
+}
+
+/*
+ * Function: logCallStats
+ *
+ * Log a table of the calls counted in the given CallStats, with a line for each type of call made
+ * followed by a line for each type of retry seen. The maximum call time is only shown if requested,
+ * as it is only known for the whole run.
+ */
+static void logCallStats(CPH_LOG * pLog, int level, std::string const &stem, CallStats const &stats, bool showMax){
+  char buff[256];
+  uint64_t totalTime = 0, totalCalls = 0;
+  int type;
+
+  for(type = 0; type < CALL_TYPES; type++){
+    totalTime += stats.getTotalTime((CallType) type);
+    totalCalls += stats.getCalls((CallType) type);
+  }
+  if(totalCalls == 0) return;
+
+  snprintf(buff, sizeof(buff), "%s%-8s %12s %8s %10s %8s%s", stem.data(),
+      "call", "count", "failed", "avg(uSec)", "time(%)", showMax ? "  max(uSec)" : "");
+  cphLogPrintLn(pLog, level, buff);
+
+  for(type = 0; type < CALL_TYPES; type++){
+    uint64_t calls = stats.getCalls((CallType) type);
+    if(calls == 0) continue;
+    uint64_t time = stats.getTotalTime((CallType) type);
+    int len = snprintf(buff, sizeof(buff), "%s%-8s %12" PRIu64 " %8" PRIu64 " %10.1f %8.1f", stem.data(),
+        CallStats::callNames[type], calls, stats.getFailures((CallType) type),
+        (double) time / calls / 1000, totalTime == 0 ? 0 : (double) time * 100 / totalTime);
+    if(showMax)
+      snprintf(buff + len, sizeof(buff) - len, " %10.1f", (double) stats.getMaxTime((CallType) type) / 1000);
+    cphLogPrintLn(pLog, level, buff);
+  }
+
+  for(type = 0; type < EVENT_TYPES; type++){
+    uint64_t events = stats.getEvents((CallEvent) type);
+    if(events == 0) continue;
+    snprintf(buff, sizeof(buff), "%s%s=%" PRIu64, stem.data(), CallStats::eventNames[type], events);
+    cphLogPrintLn(pLog, level, buff);
+  }
+}
+
 /*
  * Class: StatsThread
  * Extends: cph::Thread
@@ -94,18 +172,16 @@ public:
  */
 class StatsThread : public Thread {
   ControlThread const * const pControlThread;
+  /*Where to write a machine-readable record of each interval, or NULL.*/
+  StatsSink * const pSink;
+  /*Reporting period in milliseconds.*/
   unsigned int const statsInterval;
   bool statsPerThread;
-  bool collectLatencyStats;
 
 public:
-  long minLatency;
-  long maxLatency;
-  long avgLatency;
-
-  StatsThread(ControlThread const * const pControlThread, unsigned int const interval, bool collectLatencyStatsIn) :
+  StatsThread(ControlThread const * const pControlThread, unsigned int const interval, StatsSink * const pSink) :
       Thread(pControlThread->pConfig),
-      pControlThread(pControlThread), statsInterval(interval) {
+      pControlThread(pControlThread), pSink(pSink), statsInterval(interval) {
 
     CPHTRACEENTRY(pControlThread->pConfig->pTrc)
 
@@ -114,7 +190,6 @@ public:
       configError(pConfig, "(sp) Could not determine whether to display per-thread performance data.");
     statsPerThread = temp==CPHTRUE;
     CPHTRACEMSG(pControlThread->pConfig->pTrc, "Display per-thread performance data %s.", statsPerThread ? "yes" : "no")
-    collectLatencyStats = collectLatencyStatsIn;
     CPHTRACEEXIT(pControlThread->pConfig->pTrc)
   }
 
@@ -127,17 +202,49 @@ protected:
 
     CPH_LOG *pLog = pConfig->pLog;
 
-    std::vector<unsigned int> * prev = new std::vector<unsigned int>();
-    std::vector<unsigned int> * curr = new std::vector<unsigned int>();
-    std::vector<unsigned int> * temp;
-
-    long latencyStats[3];
-    int statIter=0;
-    minLatency=LONG_MAX;
-    maxLatency=0;
-    avgLatency=0;
-
+    std::vector<WorkerCountersSnapshot> * prev = new std::vector<WorkerCountersSnapshot>();
+    std::vector<WorkerCountersSnapshot> * curr = new std::vector<WorkerCountersSnapshot>();
+    std::vector<WorkerCountersSnapshot> * temp;
+
+    /* Cumulative latency histograms of all workers merged, as at the previous and current intervals */
+    Histogram * prevLatency[LATENCY_TYPES];
+    Histogram * currLatency[LATENCY_TYPES];
+    Histogram * tempLatency;
+    Histogram * intervalLatency[LATENCY_TYPES];
+    Histogram * snapshotLatency = new Histogram();
+    int type;
+
+    /* Cumulative call statistics of all workers merged, as at the previous and current intervals */
+    CallStats * prevCalls = new CallStats();
+    CallStats * currCalls = new CallStats();
+    CallStats * tempCalls;
+    CallStats * intervalCalls = NULL;
+
+    /* CPU time used by each worker, as at the previous and current intervals */
+    std::vector<CpuTime> * prevCpu = new std::vector<CpuTime>();
+    std::vector<CpuTime> * currCpu = new std::vector<CpuTime>();
+    std::vector<CpuTime> * tempCpu;
+    CpuTime intervalCpu;
+
+    /* Iterations called for by the target rate of each thread, as at the previous interval and now */
+    std::vector<double> * prevTarget = new std::vector<double>();
+    std::vector<double> * currTarget = new std::vector<double>();
+    std::vector<double> * tempTarget;
+    bool const paced = WorkerThread::isPaced();
+    double targetRate = 0;
+
+    /* Resource usage of the process, as at the previous interval, and for this interval */
+    ProcessResources prevResources, intervalResources;
+    bool const collectResources = pControlThread->isCollectingResourceStats();
+    if(collectResources) prevResources.sample();
+
+    for(type = 0; type < LATENCY_TYPES; type++){
+      prevLatency[type] = NULL;
+      currLatency[type] = NULL;
+      intervalLatency[type] = NULL;
+    }
 
+    StatsRecord record;
     std::stringstream ss;
 
     if(0 < strlen(pControlThread->procId))
@@ -146,16 +253,17 @@ protected:
 
     /* Get the initial start time */
     CPH_TIME startTime = cphUtilGetNow();  /* start of sleep time       */
+    MQINT64 const firstSnapshotTime = cphUtilGetMonotonicNs();
+    MQINT64 prevTargetTime = firstSnapshotTime;
 
     try {
       while(!shutdown) {
-        unsigned int total, j, running;
-        size_t shortest;
-        long elapsedTime;                            /* elapsed time in milli-sec */
+        unsigned int j, running;
+        double rate;
+        uint64_t iterations;
         CPH_TIME endTime;                            /* end of sleep time         */
 
-        statIter++;
-        sleep(statsInterval * 1000);
+        sleep(statsInterval);
 
         temp = prev;
         prev = curr;
@@ -163,50 +271,147 @@ protected:
         running = pControlThread->getThreadStats(*curr);
         endTime = cphUtilGetNow();
 
-        /*We just collect latency stats for thread 0 right now*/
-        if(collectLatencyStats) {
-           pControlThread->getThreadLatencyStats(latencyStats,0);
-           if(latencyStats[1] > maxLatency)maxLatency= latencyStats[1];
-           if(latencyStats[2] < minLatency)minLatency= latencyStats[2];
-           avgLatency=((avgLatency * (statIter-1)) + latencyStats[0]) / (statIter);
+        for(type = 0; type < LATENCY_TYPES; type++) {
+          if(!pControlThread->isCollectingLatencyStats((LatencyType) type))
+            continue;
+          if(intervalLatency[type] == NULL){
+            intervalLatency[type] = new Histogram();
+            prevLatency[type] = new Histogram();
+            currLatency[type] = new Histogram();
+          }
+
+          tempLatency = prevLatency[type];
+          prevLatency[type] = currLatency[type];
+          currLatency[type] = tempLatency;
+          pControlThread->getTotalLatencyStats(*currLatency[type], *snapshotLatency, (LatencyType) type);
+
+          /* The values recorded by all threads during this interval */
+          *intervalLatency[type] = *currLatency[type];
+          intervalLatency[type]->subtract(*prevLatency[type]);
+        }
+
+        if(pControlThread->isCollectingCallStats()){
+          if(intervalCalls == NULL) intervalCalls = new CallStats();
+
+          tempCalls = prevCalls;
+          prevCalls = currCalls;
+          currCalls = tempCalls;
+          pControlThread->getTotalCallStats(*currCalls);
+
+          *intervalCalls = *currCalls;
+          intervalCalls->subtract(*prevCalls);
+        }
+
+        if(pControlThread->isCollectingCpuStats()){
+          tempCpu = prevCpu;
+          prevCpu = currCpu;
+          currCpu = tempCpu;
+          pControlThread->getThreadCpuTimes(*currCpu);
+
+          intervalCpu.user = intervalCpu.system = 0;
+          for (j = 0; j < currCpu->size(); j++) {
+            CpuTime const &now = (*currCpu)[j];
+            if(j < prevCpu->size()){
+              addCpuInterval(intervalCpu, now, (*prevCpu)[j]);
+            } else {
+              intervalCpu.user += now.user;
+              intervalCpu.system += now.system;
+            }
+          }
+        }
+
+        if(paced){
+          MQINT64 const now = cphUtilGetMonotonicNs();
+          tempTarget = prevTarget;
+          prevTarget = currTarget;
+          currTarget = tempTarget;
+          pControlThread->getThreadTargetIterations(*currTarget, now);
+
+          /* A thread starting a new session starts its target again, so only count its target since then */
+          targetRate = 0;
+          for (j = 0; j < currTarget->size(); j++) {
+            double then = j < prevTarget->size() ? (*prevTarget)[j] : 0;
+            targetRate += (*currTarget)[j] < then ? (*currTarget)[j] : (*currTarget)[j] - then;
+          }
+          targetRate = (now > prevTargetTime ? targetRate * 1000000000 / (now - prevTargetTime) : 0) + WorkerThread::getGlobalRate();
+          prevTargetTime = now;
         }
 
-        total=0;
+        if(collectResources){
+          ProcessResources now;
+          now.sample();
+          intervalResources = now;
+          intervalResources.subtract(prevResources);
+          prevResources = now;
+        }
+
+        rate=0;
+        iterations=0;
+        record.threadRates.clear();
         std::stringstream ss2;
         ss2 << stem;
         if(statsPerThread) ss2 << " (";
 
-        shortest = prev->size();
-        if(curr->size() < shortest) shortest = curr->size();
-
-        for (j = 0; j < shortest; j++) {
-          unsigned int diff = (*curr)[j] - (*prev)[j];
+        /*
+         * Each thread's rate is calculated over the time between its own snapshots,
+         * and the rates summed. New threads are measured from the start of reporting.
+         */
+        for (j = 0; j < curr->size(); j++) {
+          WorkerCountersSnapshot const &now = (*curr)[j];
+          uint64_t diff = now.iterations - (j < prev->size() ? (*prev)[j].iterations : 0);
+          MQINT64 then = j < prev->size() ? (*prev)[j].time : firstSnapshotTime;
           if(statsPerThread) ss2 << diff << "\t";
-          total += diff;
-        }
-        /* Add on new threads */
-        for (j = (int)shortest; j<curr->size(); j++ ) {
-          if(statsPerThread) ss2 << (*curr)[j];
-          total += (*curr)[j];
+          iterations += diff;
+          double threadRate = now.time > then ? (double) diff * 1000000000 / (now.time - then) : 0;
+          record.threadRates.push_back(threadRate);
+          rate += threadRate;
         }
 
         if(statsPerThread) ss2 << ") ";
 
-        /* Get the elapsed time */
-        elapsedTime = cphUtilGetTimeDifference(endTime, startTime);
-        /* Set the start time to the end time, for the next sleep */
-        cphCopyTime(&startTime, &endTime);
-
         char buff[160];
-        sprintf(buff, "rate=%.2f,threads=%u", (double) total / (elapsedTime / 1000), running);
+        if(paced)
+          sprintf(buff, "rate=%.2f,targetRate=%.2f,threads=%u", rate, targetRate, running);
+        else
+          sprintf(buff, "rate=%.2f,threads=%u", rate, running);
         ss2 << buff;
 
-        if(collectLatencyStats){
-          sprintf(buff,",avg_latency(uSec)=%ld,max_latency(uSec)=%ld,min_latency(uSec)=%ld",latencyStats[0],latencyStats[1],latencyStats[2]);
-          ss2 << buff;
+        for(type = 0; type < LATENCY_TYPES; type++){
+          if(intervalLatency[type] == NULL) continue;
+          ss2 << ",";
+          appendLatencyStats(ss2, latencyPrefixes[type], *intervalLatency[type]);
+          pControlThread->logHistogram((std::string(latencyPrefixes[type]) + "interval").data(), *intervalLatency[type], startTime, endTime);
+        }
+        if(pControlThread->isCollectingCpuStats()){
+          ss2 << ",";
+          appendCpuStats(ss2, intervalCpu, iterations);
+        }
+        if(collectResources){
+          ss2 << ",";
+          intervalResources.append(ss2);
         }
         cphLogPrintLn(pLog, LOG_INFO, ss2.str().data());
+        if(intervalCalls != NULL)
+          logCallStats(pLog, LOG_INFO, stem, *intervalCalls, false);
+
+        if(pSink != NULL){
+          record.time = cphUtilGetEpochMs();
+          record.duration = cphUtilGetDoubleDuration(startTime, endTime);
+          record.running = running;
+          record.failed = pControlThread->getFailedWorkers();
+          record.rate = rate;
+          record.targetRate = paced ? &targetRate : NULL;
+          record.iterations = iterations;
+          record.cpu = pControlThread->isCollectingCpuStats() ? &intervalCpu : NULL;
+          record.resources = collectResources ? &intervalResources : NULL;
+          for(type = 0; type < LATENCY_TYPES; type++)
+            record.latency[type] = intervalLatency[type];
+          record.calls = intervalCalls;
+          pSink->write(record);
+        }
 
+        /* Set the start time to the end time, for the next sleep */
+        cphCopyTime(&startTime, &endTime);
       }
     } catch (ShutdownException &e) {
       (void)e;
@@ -215,6 +420,19 @@ protected:
 
     delete prev;
     delete curr;
+    for(type = 0; type < LATENCY_TYPES; type++){
+      delete prevLatency[type];
+      delete currLatency[type];
+      delete intervalLatency[type];
+    }
+    delete snapshotLatency;
+    delete prevCalls;
+    delete currCalls;
+    delete intervalCalls;
+    delete prevCpu;
+    delete currCpu;
+    delete prevTarget;
+    delete currTarget;
 
     CPHTRACEEXIT(pTrc)
   }
@@ -233,10 +451,23 @@ ControlThread::ControlThread(CPH_CONFIG * const pConfig) :
     pDestinationFactory(NULL),
     threadId(Thread::getCurrentThreadId()),
     workers(),
+    workerCounters(),
     pStatsThread(NULL),
+    pStatsSink(NULL),
+    pMetricsServer(NULL),
+    pHistogramLog(NULL),
+    collectCpuStats(false),
+    collectResourceStats(false),
     shutdown(false),
     runningWorkers(0),
-    threadCountLock() {
+    threadCountLock(),
+    openConcurrency(0),
+    openingWorkers(0),
+    openedWorkers(0),
+    startState(START_WAITING),
+    openLock(),
+    startLock() {
+  cphUtilTimeIni(&histogramLogStart);
   cphDestinationFactoryIni(&pDestinationFactory, pConfig);
 }
 
@@ -257,6 +488,15 @@ ControlThread::~ControlThread(){
     fprintf(pTrc->tFp, "ThreadId: %" PRIu64 "\t\t\tControl thread.\n", threadId);
     if(pStatsThread!=NULL)
       fprintf(pTrc->tFp, "ThreadId: %" PRIu64 "\t\t\tStats thread.\n", pStatsThread->getId());
+    if(pMetricsServer!=NULL)
+      fprintf(pTrc->tFp, "ThreadId: %" PRIu64 "\t\t\tMetrics server thread.\n", pMetricsServer->getId());
+  }
+
+  for(std::vector<WorkerPool *>::const_iterator it = pools.begin(); it != pools.end(); ++it){
+    if(traceIsOn)
+      fprintf(pTrc->tFp, "Thread Id: %" PRIu64 "\t\t\tThread Name: %s.\n", (*it)->getId(), (*it)->name.data());
+
+    delete *it;
   }
 
   for(std::vector<WorkerThread *>::const_iterator it = workers.begin(); it != workers.end(); ++it){
@@ -270,6 +510,9 @@ ControlThread::~ControlThread(){
 
   workers.clear();
   delete pStatsThread;
+  delete pStatsSink;
+  delete pMetricsServer;
+  if(pHistogramLog != NULL) fclose(pHistogramLog);
   cphDestinationFactoryFree(&pDestinationFactory);
 
   CPHTRACEEXIT(pTrc)
@@ -297,7 +540,7 @@ void ControlThread::run() {
   /* Options Variables */
   bool doFinalSummary, reportTlf = false;
   bool collectLatencyStats = false;
-  //int threadStackSize;
+  bool collectCallStats = false;
   unsigned int numWorkers, threadStartInterval, threadStartTimeout, runLength;
 
   /* Temporary/transient variables */
@@ -313,6 +556,18 @@ void ControlThread::run() {
       configError(pConfig, "(tc) Could not determine worker thread type class.");
     cph::WorkerThread::setImplementation(pConfig->pTrc, std::string(tempStr));
 
+    if (CPHTRUE != cphConfigGetString(pConfig, tempStr, sizeof(tempStr), "tb"))
+      configError(pConfig, "(tb) Could not determine timebase.");
+    if (0 != strcmp(tempStr, "clock") && 0 != strcmp(tempStr, "tsc"))
+      configError(pConfig, "(tb) Timebase must be one of {clock,tsc}.");
+    if (0 == strcmp(tempStr, "tsc") && CPHTRUE != cphUtilTimebaseIni(CPHTRUE))
+      cphLogPrintLn(pLog, LOG_WARNING, "The processor's time stamp counter can't be used for timing - using the clock instead.");
+    if (cphUtilGetTimebaseFrequency() > 0)
+      sprintf(tempStr, "Timebase: tsc (%.1fMHz), %.1fns per timestamp.", cphUtilGetTimebaseFrequency() / 1000000, cphUtilGetTimestampCost());
+    else
+      sprintf(tempStr, "Timebase: clock, %.1fns per timestamp.", cphUtilGetTimestampCost());
+    cphLogPrintLn(pLog, LOG_INFO, tempStr);
+
     /* Get the set duration option */
     if (CPHTRUE != cphConfigGetString(pConfig, tempStr, sizeof(tempStr), "sd")) exit(1);
     if (0 == strcmp(tempStr, "normal"))
@@ -344,35 +599,61 @@ void ControlThread::run() {
     CPHTRACEMSG(pTrc, "Process Id: %s.", procId)
 
     if (CPHTRUE != cphConfigGetBoolean(pConfig, &temp, "ls"))
-      configError(pConfig, "(ls) Could not determine whether to display latency performance data for thread 0.");
+      configError(pConfig, "(ls) Could not determine whether to collect latency performance data.");
     collectLatencyStats = temp==CPHTRUE;
-    CPHTRACEMSG(pTrc, "Display latency performance data for thread 0 %s.", collectLatencyStats ? "yes" : "no")
+    CPHTRACEMSG(pTrc, "Collect latency performance data %s.", collectLatencyStats ? "yes" : "no")
+
+    if (CPHTRUE != cphConfigGetBoolean(pConfig, &temp, "vs"))
+      configError(pConfig, "(vs) Could not determine whether to collect per-call performance data.");
+    collectCallStats = temp==CPHTRUE;
+    CPHTRACEMSG(pTrc, "Collect per-call performance data %s.", collectCallStats ? "yes" : "no")
+
+    if (CPHTRUE != cphConfigGetBoolean(pConfig, &temp, "cu"))
+      configError(pConfig, "(cu) Could not determine whether to collect CPU usage data.");
+    collectCpuStats = temp==CPHTRUE;
+    CPHTRACEMSG(pTrc, "Collect CPU usage data %s.", collectCpuStats ? "yes" : "no")
+
+    if (CPHTRUE != cphConfigGetBoolean(pConfig, &temp, "ru"))
+      configError(pConfig, "(ru) Could not determine whether to collect process resource usage data.");
+    collectResourceStats = temp==CPHTRUE;
+    CPHTRACEMSG(pTrc, "Collect process resource usage data %s.", collectResourceStats ? "yes" : "no")
+
+    if (CPHTRUE != cphConfigGetString(pConfig, tempStr, sizeof(tempStr), "lf"))
+      configError(pConfig, "(lf) Could not determine latency histogram log file.");
+    CPHTRACEMSG(pTrc, "Latency histogram log file: %s.", tempStr)
+    if(0 < strlen(tempStr)){
+      if(NULL == (pHistogramLog = fopen(tempStr, "w")))
+        configError(pConfig, std::string("(lf) Could not open latency histogram log file: ") + tempStr);
+      histogramLogStart = cphUtilGetNow();
+      Histogram::writeLogHeader(pHistogramLog, procId, "us", (long) time(NULL));
+    }
 
     /* Start the stats thread if the specified interval is greater than zero */
-    if (CPHTRUE != cphConfigGetInt(pConfig, (int *) &temp, "ss"))
+    float statsInterval;
+    if (CPHTRUE != cphConfigGetFloat(pConfig, &statsInterval, "ss"))
       configError(pConfig, "(ss) Could not determine stats interval.");
-    CPHTRACEMSG(pTrc, "Stats interval: %d.", temp)
-    // Create stats thread if needed
-    if(temp>0)
-      pStatsThread = new StatsThread(this, temp, collectLatencyStats);
-
-#ifdef DISABLED
-    if (CPHTRUE != cphConfigGetInt(pConfig, &threadStackSize, "ts"))
-      status = CPHFALSE;
-    else {
-      CPHTRACEMSG(pTrc, "Thread stack size command line option: %d.", threadStackSize)
-                if (threadStackSize > 0)
-                {
-#ifdef CPH_UNIX
-                  CPHTRACEMSG(pTrc, "Setting per thread stack allocation to: %d.\n", 1024 * threadStackSize)
-                   cphThreadSetStackSize(&pControlThread->threadAttr, 1024 * threadStackSize);
-#else
-                  CPHTRACEMSG(pTrc, "-ts option is only supported on Unix.\n")
-                  cphConfigInvalidParameter(pConfig, (char*) "-ts is only supported on Unix");
-#endif
-                }
+    CPHTRACEMSG(pTrc, "Stats interval: %gs.", statsInterval)
+    // Create stats thread if needed (the interval is rounded to the nearest millisecond)
+    if(statsInterval>0){
+      if (CPHTRUE != cphConfigGetString(pConfig, tempStr, sizeof(tempStr), "sf"))
+        configError(pConfig, "(sf) Could not determine statistics output.");
+      CPHTRACEMSG(pTrc, "Statistics output: %s.", tempStr)
+      if(0 < strlen(tempStr)){
+        char format[8];
+        if (CPHTRUE != cphConfigGetString(pConfig, format, sizeof(format), "sfm"))
+          configError(pConfig, "(sfm) Could not determine statistics output format.");
+        if(0 != strcmp(format, "csv") && 0 != strcmp(format, "json"))
+          configError(pConfig, "(sfm) Statistics output format must be one of {csv,json}.");
+        pStatsSink = new StatsSink(pConfig, tempStr, 0 == strcmp(format, "csv") ? StatsSink::CSV : StatsSink::JSON, procId);
+      }
+      pStatsThread = new StatsThread(this, statsInterval<0.001 ? 1 : (unsigned int) (statsInterval*1000 + 0.5), pStatsSink);
     }
-#endif
+
+    if (CPHTRUE != cphConfigGetInt(pConfig, &temp, "ts"))
+      configError(pConfig, "(ts) Could not determine thread stack size.");
+    CPHTRACEMSG(pTrc, "Thread stack size: %dKb.", temp)
+    if (temp < 0 || !Thread::setStackSize((size_t) temp * 1024))
+      configError(pConfig, "(ts) Thread stack size is not valid on this platform.");
 
     if (CPHTRUE != cphConfigGetInt(pConfig, (int*) &threadStartInterval, "wi"))
       configError(pConfig, "(wi) Could not determine worker thread start interval.");
@@ -382,20 +663,71 @@ void ControlThread::run() {
       configError(pConfig, "(wt) Could not determine worker thread start timeout.");
     CPHTRACEMSG(pTrc, "Number of seconds to wait for worker thread to start: %u.", threadStartTimeout)
 
+    if (CPHTRUE != cphConfigGetInt(pConfig, &temp, "wp"))
+      configError(pConfig, "(wp) Could not determine worker thread parallel start.");
+    if (temp < 0)
+      configError(pConfig, "(wp) Worker thread parallel start must not be negative.");
+    openConcurrency = (unsigned int) temp;
+    CPHTRACEMSG(pTrc, "Number of worker threads to open sessions at once: %u.", openConcurrency)
+
+    unsigned int poolCount;
+    if (CPHTRUE != cphConfigGetInt(pConfig, &temp, "np"))
+      configError(pConfig, "(np) Could not determine number of worker pool threads.");
+    if (temp < 0)
+      configError(pConfig, "(np) Number of worker pool threads must not be negative.");
+    poolCount = (unsigned int) temp;
+    CPHTRACEMSG(pTrc, "Number of worker pool threads: %u.", poolCount)
+    if (poolCount>0 && openConcurrency>0)
+      configError(pConfig, "(np) Worker pools can't be combined with a parallel start (wp).");
+    if (poolCount>numWorkers)
+      poolCount = numWorkers;
+    if (poolCount>0 && collectCpuStats)
+      configError(pConfig, "(cu) Per-thread CPU time can't be collected for workers driven by worker pools (np).");
+
     if (CPHTRUE != cphConfigGetInt(pConfig, (int*) &runLength, "rl"))
       configError(pConfig, "(rl) Could not determine run length");
     CPHTRACEMSG(pTrc, "Run length: %us.", runLength)
 
+    if (CPHTRUE != cphConfigGetString(pConfig, tempStr, sizeof(tempStr), "mp"))
+      configError(pConfig, "(mp) Could not determine metrics endpoint.");
+    CPHTRACEMSG(pTrc, "Metrics endpoint: %s.", tempStr)
+    if(0 < strlen(tempStr))
+      pMetricsServer = new MetricsServer(this, tempStr);
+
+    if (CPHTRUE != cphConfigGetString(pConfig, tempStr, sizeof(tempStr), "sm"))
+      configError(pConfig, "(sm) Could not determine statistics segment file.");
+    CPHTRACEMSG(pTrc, "Statistics segment file: %s.", tempStr)
+
     // Create worker threads (but don't start them).
+    workerCounters.allocate(numWorkers, procId, tempStr);
     workers.reserve(numWorkers);
     for(unsigned int i=0; i<numWorkers; ++i)
       workers.push_back(WorkerThread::create(this));
 
+    if(poolCount>0){
+      if(WorkerThread::getGlobalRate()>0)
+        configError(pConfig, "(np) Worker pools can't be combined with a global rate (gr).");
+      if(!workers.empty() && !workers[0]->canRunPooled())
+        configError(pConfig, "(np) " + workers[0]->className + " worker threads can't be run in a worker pool.");
+
+      // Deal the workers out between the pools
+      for(unsigned int i=0; i<poolCount; ++i)
+        pools.push_back(new WorkerPool(pConfig, i));
+      for(unsigned int i=0; i<numWorkers; ++i)
+        pools[i % poolCount]->add(workers[i]);
+    }
+
     if(cphConfigIsInvalid(pConfig)==CPHTRUE)
       throw std::runtime_error("Configuration is invalid.");
 
-    if(pStatsThread!=NULL && collectLatencyStats){
-      workers[0]->setCollectLatencyStats(true);
+    if(collectLatencyStats){
+      for(std::vector<WorkerThread *>::iterator it = workers.begin(); it != workers.end(); ++it)
+        (*it)->setCollectLatencyStats(true);
+    }
+
+    if(collectCallStats){
+      for(std::vector<WorkerThread *>::iterator it = workers.begin(); it != workers.end(); ++it)
+        (*it)->setCollectCallStats(true);
     }
 
   } catch (std::runtime_error &e) {
@@ -412,8 +744,15 @@ void ControlThread::run() {
   bool exceptionCaught = false;
 
   try {
+    if(pStatsSink != NULL) pStatsSink->start();
     if(pStatsThread != NULL) pStatsThread->start();
-    startWorkers(threadStartInterval, threadStartTimeout);
+    if(pMetricsServer != NULL) pMetricsServer->start();
+    if(!pools.empty())
+      startPools(threadStartTimeout);
+    else if(openConcurrency>0)
+      startWorkersTogether(threadStartTimeout);
+    else
+      startWorkers(threadStartInterval, threadStartTimeout);
 
     startTime = cphUtilGetNow();
     runLength *= 1000;
@@ -460,10 +799,17 @@ void ControlThread::run() {
     while(pStatsThread->isAlive())
       Thread::yield();
   }
+  if(pStatsSink!=NULL)
+    pStatsSink->close();
+  if(pMetricsServer!=NULL){
+    pMetricsServer->signalShutdown();
+    while(pMetricsServer->isAlive())
+      Thread::yield();
+  }
 
   CPH_TIME wtTime, endTime;
   cphUtilTimeIni(&endTime);
-  unsigned int iterations = 0;
+  uint64_t iterations = 0;
 
   for(std::vector<WorkerThread *>::iterator it = workers.begin(); it != workers.end(); ++it){
 
@@ -498,17 +844,55 @@ void ControlThread::run() {
     double duration = cphUtilGetDoubleDuration(startTime, endTime);
 
     sprintf(tempStr,
-        "totalIterations=%u,totalSeconds=%.2f,avgRate=%.2f",
+        "totalIterations=%" PRIu64 ",totalSeconds=%.2f,avgRate=%.2f",
         iterations, duration, (double)iterations/duration);
     cphLogPrintLn(pLog, LOG_WARNING, tempStr);
 
-    if(pStatsThread != NULL && collectLatencyStats){
-      sprintf(tempStr,
-         "avg_latency(uSec)=%ld,max_latency(uSec)=%ld,min_latency(uSec)=%ld",
-         pStatsThread->avgLatency,
-         pStatsThread->maxLatency,
-         pStatsThread->minLatency);
-      cphLogPrintLn(pLog, LOG_WARNING, tempStr);
+    for(int type = 0; type < LATENCY_TYPES; type++){
+      if(!isCollectingLatencyStats((LatencyType) type)) continue;
+
+      Histogram * pTotal = new Histogram();
+      Histogram * pSnapshot = new Histogram();
+      for(std::vector<WorkerThread *>::iterator it = workers.begin(); it != workers.end(); ++it){
+        (*it)->getLatencyStats(*pSnapshot, (LatencyType) type);
+        pTotal->add(*pSnapshot);
+      }
+
+      std::stringstream ss;
+      appendLatencyStats(ss, latencyPrefixes[type], *pTotal);
+      cphLogPrintLn(pLog, LOG_WARNING, ss.str().data());
+      logHistogram((std::string(latencyPrefixes[type]) + "total").data(), *pTotal, startTime, endTime);
+
+      delete pTotal;
+      delete pSnapshot;
+    }
+
+    if(isCollectingCallStats()){
+      CallStats total;
+      getTotalCallStats(total);
+      logCallStats(pLog, LOG_WARNING, "", total, true);
+    }
+
+    if(collectCpuStats){
+      CpuTime total, cpu;
+      total.user = total.system = 0;
+      for(std::vector<WorkerThread *>::iterator it = workers.begin(); it != workers.end(); ++it){
+        if(!(*it)->getCpuTime(cpu)) continue;
+        total.user += cpu.user;
+        total.system += cpu.system;
+      }
+      std::stringstream ss;
+      ss << "workerClass=" << (workers.empty() ? "" : workers[0]->className.data()) << ",";
+      appendCpuStats(ss, total, iterations);
+      cphLogPrintLn(pLog, LOG_WARNING, ss.str().data());
+    }
+
+    if(collectResourceStats){
+      ProcessResources total;
+      std::stringstream ss;
+      total.sample();
+      total.append(ss);
+      cphLogPrintLn(pLog, LOG_WARNING, ss.str().data());
     }
 
   }
@@ -528,33 +912,159 @@ void ControlThread::run() {
 /*
 ** Method: getThreadStats
 **
-** This method gets an iteration count for each worker thread and puts
-** them in the given vector. Any pre-existing contents of the vector
-** are erased.
+** This method takes a timestamped snapshot of the counters of each worker thread and puts
+** them in the given vector, which is only resized if the number of worker threads has changed.
 */
-unsigned int ControlThread::getThreadStats(std::vector<unsigned int> &stats) const {
+unsigned int ControlThread::getThreadStats(std::vector<WorkerCountersSnapshot> &stats) const {
   CPHTRACEENTRY(pConfig->pTrc)
-  stats.clear();
-  stats.reserve(workers.size());
+  workerCounters.snapshot(stats);
+  CPHTRACEEXIT(pConfig->pTrc)
+  return runningWorkers;
+}
+
+/*
+** Method: allocateWorkerCounters
+**
+** This method returns the next free slot in the worker counters array.
+** It is called by each WorkerThread as it is created.
+*/
+WorkerCounters * ControlThread::allocateWorkerCounters() {
+  return workerCounters.next();
+}
+
+/*
+** Method: getFailedWorkers
+**
+** Returns the number of worker threads that have stopped because of an error.
+*/
+unsigned int ControlThread::getFailedWorkers() const {
+  unsigned int failed = 0;
+  for(std::vector<WorkerThread *>::const_iterator it = workers.begin(); it != workers.end(); ++it)
+    if((*it)->getState() & S_ERROR) failed++;
+  return failed;
+}
 
-  for(std::vector<WorkerThread *>::const_iterator it = workers.begin(); it != workers.end(); ++it) {
-    stats.push_back((*it)->getIterations());
+/*
+** Method: getTotalLatencyStats
+**
+** This method merges snapshots of the cumulative latency histograms of the given type of all the worker
+** threads into the given total, using the given histogram to take each snapshot in. Threads not collecting
+** latency stats add nothing. Interval figures are found by subtracting the previous total from the current one.
+*/
+void ControlThread::getTotalLatencyStats(Histogram &total, Histogram &snapshot, LatencyType type) const {
+  CPHTRACEENTRY(pConfig->pTrc)
+  total.reset();
+  for(std::vector<WorkerThread *>::const_iterator it = workers.begin(); it != workers.end(); ++it){
+    if(!(*it)->isCollectingLatencyStats(type)) continue;
+    (*it)->getLatencyStats(snapshot, type);
+    total.add(snapshot);
   }
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+/*
+** Method: isCollectingLatencyStats
+**
+** Returns whether any worker thread records the given type of latency.
+*/
+bool ControlThread::isCollectingLatencyStats(LatencyType type) const {
+  for(std::vector<WorkerThread *>::const_iterator it = workers.begin(); it != workers.end(); ++it)
+    if((*it)->isCollectingLatencyStats(type)) return true;
+  return false;
+}
 
+/*
+** Method: getTotalCallStats
+**
+** This method merges snapshots of the cumulative call statistics of all the worker threads into the given
+** total. As with getTotalLatencyStats, interval figures are found by subtracting the previous total.
+*/
+void ControlThread::getTotalCallStats(CallStats &total) const {
+  CPHTRACEENTRY(pConfig->pTrc)
+  CallStats snapshot;
+  total.reset();
+  for(std::vector<WorkerThread *>::const_iterator it = workers.begin(); it != workers.end(); ++it){
+    (*it)->getCallStats(snapshot);
+    total.add(snapshot);
+  }
   CPHTRACEEXIT(pConfig->pTrc)
-  return runningWorkers;
 }
 
 /*
-** Method: getThreadLatencyStats
+** Method: isCollectingCallStats
 **
-** This method populates an array with the values of avg, max & min latencies recorded by
-*  the thread specified since the last time this was called.
-*  TODO: Generalise this to be more in line with getThreadStats, populating a vector of arrays
-*  for all threads (array empty where latency stats are not enabled?) and returning a count of runningWorkers
+** Returns whether any worker thread records call statistics.
 */
-void ControlThread::getThreadLatencyStats(long latencyStats[], int tid) const {
-     workers[tid]->getLatencyStats(latencyStats);
+bool ControlThread::isCollectingCallStats() const {
+  for(std::vector<WorkerThread *>::const_iterator it = workers.begin(); it != workers.end(); ++it)
+    if((*it)->isCollectingCallStats()) return true;
+  return false;
+}
+
+/*
+** Method: getThreadCpuTimes
+**
+** This method samples the CPU time used so far by each worker thread and puts them in the given vector,
+** in the same order as getThreadStats. The vector is only resized if the number of worker threads has
+** changed. Threads whose CPU time can't be found (e.g. not yet started) are given zero.
+*/
+void ControlThread::getThreadCpuTimes(std::vector<CpuTime> &stats) const {
+  CPHTRACEENTRY(pConfig->pTrc)
+  if(stats.size() != workers.size())
+    stats.resize(workers.size());
+
+  for(size_t i = 0; i < workers.size(); i++){
+    if(!workers[i]->getCpuTime(stats[i]))
+      stats[i].user = stats[i].system = stats[i].userTicks = stats[i].systemTicks = 0;
+  }
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+/*
+** Method: getThreadTargetIterations
+**
+** This method puts the number of iterations each worker thread's target rate has called for in its current
+** session by the given time (from cphUtilGetMonotonicNs) in the given vector, in the same order as getThreadStats.
+** The vector is only resized if the number of worker threads has changed.
+*/
+void ControlThread::getThreadTargetIterations(std::vector<double> &targets, MQINT64 at) const {
+  CPHTRACEENTRY(pConfig->pTrc)
+  if(targets.size() != workers.size())
+    targets.resize(workers.size());
+
+  for(size_t i = 0; i < workers.size(); i++)
+    targets[i] = workers[i]->getTargetIterations(at);
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+/*
+** Method: isCollectingCpuStats
+**
+** Returns whether the CPU time of the worker threads is to be reported (cu).
+*/
+bool ControlThread::isCollectingCpuStats() const {
+  return collectCpuStats;
+}
+
+/*
+** Method: isCollectingResourceStats
+**
+** Returns whether the resource usage of the process is to be reported (ru).
+*/
+bool ControlThread::isCollectingResourceStats() const {
+  return collectResourceStats;
+}
+
+/*
+** Method: logHistogram
+**
+** If a latency histogram log file was requested (lf), append the given histogram to it,
+** tagged with the given name and the period it covers relative to the start of the log.
+*/
+void ControlThread::logHistogram(char const * tag, Histogram const &h, CPH_TIME start, CPH_TIME end) const {
+  if(pHistogramLog == NULL) return;
+  double offset = cphUtilTimeCompare(start, histogramLogStart) > 0 ? cphUtilGetDoubleDuration(histogramLogStart, start) : 0;
+  h.writeLog(pHistogramLog, tag, offset, cphUtilGetDoubleDuration(start, end));
 }
 
 /*
@@ -628,6 +1138,229 @@ void ControlThread::startWorkers(unsigned int interval, unsigned int timeout) {
   CPHTRACEEXIT(pTrc)
 }
 
+/*
+** Method: startWorkersTogether
+**
+** This method starts all the worker threads in the "workers" vector at once. Each opens its first session,
+** with at most "wp" of them doing so at the same time (see beginOpen), and then waits at a barrier (see awaitStart).
+** Once every thread has opened its session, or ended, they are released together and counted as running,
+** so that all of them measure the same period.
+**
+** Input Parameters:
+**     timeout  - the max number of seconds to wait for all sessions to open, or 0 to wait indefinitely
+**
+*/
+void ControlThread::startWorkersTogether(unsigned int timeout) {
+  char errorString[512];
+  size_t numWorkers = workers.size();
+
+  CPHTRACEREF(pTrc, pConfig->pTrc)
+  CPHTRACEENTRY(pTrc)
+
+  MQINT64 begin = cphUtilGetMonotonicNs();
+  for(std::vector<WorkerThread *>::iterator it = workers.begin(); it != workers.end(); ++it){
+    CPHTRACEMSG(pTrc, "Starting worker thread.")
+    (*it)->start();
+  }
+  sprintf(errorString, "Started %u worker threads - opening sessions, %u at a time.", (unsigned int) numWorkers, openConcurrency);
+  cphLogPrintLn(pConfig->pLog, LOG_VERBOSE, errorString);
+
+  for(;;){
+    {
+      lockAndWait(threadCountLock, 1000, openedWorkers < numWorkers)
+    }
+    if (cphControlCInvoked != 0) throw ShutdownException();
+
+    // Threads that fail before or while opening their session don't report it, so look for them
+    size_t ended = 0;
+    for(std::vector<WorkerThread *>::iterator it = workers.begin(); it != workers.end(); ++it){
+      int state = (*it)->getState();
+      if(state & S_ERROR){
+        sprintf(errorString, "%s: State ERROR set.", (*it)->name.data());
+        CPHTRACEMSG(pTrc, errorString)
+        throw std::runtime_error(errorString);
+      } else if (state & S_ENDED) {
+        ended++;
+      }
+    }
+
+    threadCountLock.lock();
+    size_t ready = openedWorkers + ended;
+    threadCountLock.unlock();
+    if(ready >= numWorkers) break;
+
+    if(timeout>0 && cphUtilGetMonotonicNs() - begin >= (MQINT64) timeout * 1000000000){
+      sprintf(errorString, "Timed out waiting for worker thread sessions to open (%u of %u open).",
+          (unsigned int) (ready - ended), (unsigned int) numWorkers);
+      cphLogPrintLn(pConfig->pLog, LOG_ERROR, errorString);
+      throw std::runtime_error(errorString);
+    }
+  }
+
+  // Count the released workers as running now, so the run length doesn't start before they do
+  threadCountLock.lock();
+  runningWorkers += openedWorkers;
+  threadCountLock.notify();
+  threadCountLock.unlock();
+
+  openLock.lock();
+  startLock.lock();
+  startState = START_RELEASED;
+  startLock.notifyAll();
+  startLock.unlock();
+  openLock.unlock();
+
+  sprintf(errorString, "All worker thread sessions open after %.3fs - starting worker threads together.",
+      (double) (cphUtilGetMonotonicNs() - begin) / 1000000000);
+  cphLogPrintLn(pConfig->pLog, LOG_INFO, errorString);
+
+  CPHTRACEEXIT(pTrc)
+}
+
+/*
+** Method: startPools
+**
+** This method starts the worker pool threads (np), each of which opens the first sessions of its workers
+** and then drives their iterations, and waits until every worker is running, or has ended.
+**
+** Input Parameters:
+**     timeout  - the max number of seconds to wait for all sessions to open, or 0 to wait indefinitely
+**
+*/
+void ControlThread::startPools(unsigned int timeout) {
+  char errorString[512];
+  size_t numWorkers = workers.size();
+
+  CPHTRACEREF(pTrc, pConfig->pTrc)
+  CPHTRACEENTRY(pTrc)
+
+  MQINT64 begin = cphUtilGetMonotonicNs();
+  for(std::vector<WorkerPool *>::iterator it = pools.begin(); it != pools.end(); ++it){
+    CPHTRACEMSG(pTrc, "Starting worker pool thread.")
+    (*it)->start();
+  }
+  sprintf(errorString, "Started %u worker pool threads for %u worker threads.", (unsigned int) pools.size(), (unsigned int) numWorkers);
+  cphLogPrintLn(pConfig->pLog, LOG_VERBOSE, errorString);
+
+  for(;;){
+    {
+      lockAndWait(threadCountLock, 1000, runningWorkers < numWorkers)
+    }
+    if (cphControlCInvoked != 0) throw ShutdownException();
+
+    size_t ready = 0;
+    for(std::vector<WorkerThread *>::iterator it = workers.begin(); it != workers.end(); ++it){
+      int state = (*it)->getState();
+      if(state & S_ERROR){
+        sprintf(errorString, "%s: State ERROR set.", (*it)->name.data());
+        CPHTRACEMSG(pTrc, errorString)
+        throw std::runtime_error(errorString);
+      } else if (state & (S_RUNNING|S_ENDED)) {
+        ready++;
+      }
+    }
+    if(ready >= numWorkers) break;
+
+    if(timeout>0 && cphUtilGetMonotonicNs() - begin >= (MQINT64) timeout * 1000000000){
+      sprintf(errorString, "Timed out waiting for worker thread sessions to open (%u of %u open).",
+          (unsigned int) ready, (unsigned int) numWorkers);
+      cphLogPrintLn(pConfig->pLog, LOG_ERROR, errorString);
+      throw std::runtime_error(errorString);
+    }
+  }
+
+  sprintf(errorString, "All worker thread sessions open after %.3fs.", (double) (cphUtilGetMonotonicNs() - begin) / 1000000000);
+  cphLogPrintLn(pConfig->pLog, LOG_INFO, errorString);
+
+  CPHTRACEEXIT(pTrc)
+}
+
+/*
+** Method: isStartBarrier
+**
+** Whether worker threads open their first sessions in parallel and then wait to be started together,
+** by calling beginOpen, endOpen and awaitStart.
+*/
+bool ControlThread::isStartBarrier() const {
+  return openConcurrency>0;
+}
+
+/*
+** Method: beginOpen
+**
+** Called by a worker thread before opening its first session, this waits until fewer than "wp"
+** other threads are doing so.
+**
+** Returns: true if the session should be opened (endOpen must then be called), false if starting has been abandoned.
+*/
+bool ControlThread::beginOpen() {
+  bool ok;
+  openLock.lock();
+  while(openingWorkers>=openConcurrency && startState==START_WAITING)
+    openLock.wait();
+  ok = startState==START_WAITING;
+  if(ok) ++openingWorkers;
+  openLock.unlock();
+  return ok;
+}
+
+/*
+** Method: endOpen
+**
+** Called by a worker thread after it has tried to open its first session, having called beginOpen,
+** to let another thread start opening its own.
+**
+** Input Parameters:
+**     opened - whether the session was opened successfully
+*/
+void ControlThread::endOpen(bool opened) {
+  openLock.lock();
+  --openingWorkers;
+  openLock.notify();
+  openLock.unlock();
+
+  if(opened){
+    threadCountLock.lock();
+    ++openedWorkers;
+    threadCountLock.notify();
+    threadCountLock.unlock();
+  }
+}
+
+/*
+** Method: awaitStart
+**
+** Called by a worker thread once its first session is open, this waits until all the worker threads are
+** ready and released together by startWorkersTogether.
+**
+** Returns: true if the thread has been released, and counted as running, false if starting has been abandoned.
+*/
+bool ControlThread::awaitStart() {
+  bool released;
+  startLock.lock();
+  while(startState==START_WAITING)
+    startLock.wait();
+  released = startState==START_RELEASED;
+  startLock.unlock();
+  return released;
+}
+
+/*
+** Method: abortStart
+**
+** Release any worker threads waiting in beginOpen or awaitStart without starting them.
+*/
+void ControlThread::abortStart() {
+  openLock.lock();
+  startLock.lock();
+  if(startState==START_WAITING)
+    startState = START_ABORTED;
+  startLock.notifyAll();
+  startLock.unlock();
+  openLock.notifyAll();
+  openLock.unlock();
+}
+
 /*
 ** Method: incRunners
 **
@@ -674,8 +1407,13 @@ void ControlThread::decRunners() {
 void ControlThread::shutdownWorkers() {
   CPHTRACEENTRY(pConfig->pTrc)
 
+  if(openConcurrency>0)
+    abortStart();
+
   for(std::vector<WorkerThread *>::iterator it=workers.begin(); it!=workers.end(); ++it)
     (*it)->signalShutdown();
+  for(std::vector<WorkerPool *>::iterator it=pools.begin(); it!=pools.end(); ++it)
+    (*it)->signalShutdown();
 
   while(runningWorkers>0){
 
@@ -687,11 +1425,19 @@ void ControlThread::shutdownWorkers() {
       for(std::vector<WorkerThread *>::iterator it=workers.begin(); it!=workers.end(); ++it)
         if((*it)->isAlive())
           ss << (*it)->name << " ";
+      for(std::vector<WorkerPool *>::iterator it=pools.begin(); it!=pools.end(); ++it)
+        if((*it)->isAlive())
+          ss << (*it)->name << " ";
       ss << ")";
       cphLogPrintLn(pConfig->pLog, LOG_WARNING, ss.str().data());
     }
   }
 
+  // Pools may still be ending workers that weren't running
+  for(std::vector<WorkerPool *>::iterator it=pools.begin(); it!=pools.end(); ++it)
+    while((*it)->isAlive())
+      Thread::yield();
+
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
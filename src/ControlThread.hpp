@@ -31,11 +31,19 @@
 
 #include "Thread.hpp"
 #include "WorkerThread.hpp"
+#include "Histogram.hpp"
+#include "CallStats.hpp"
+#include "WorkerCounters.hpp"
+#include "StatsSink.hpp"
+#include "MetricsServer.hpp"
+#include "WorkerPool.hpp"
+#include "ProcessResources.hpp"
 
 #include "cphDestinationFactory.h"
 #include "cphConfig.h"
 
 #include <vector>
+#include <stdio.h>
 
 namespace cph {
 class StatsThread;
@@ -53,18 +61,57 @@ public:
   void run();
   void incRunners();
   void decRunners();
-  unsigned int getThreadStats(std::vector<unsigned int> &stats) const;
-  void getThreadLatencyStats(long latencyStats[], int tid) const;
+  WorkerCounters * allocateWorkerCounters();
+  unsigned int getThreadStats(std::vector<WorkerCountersSnapshot> &stats) const;
+  unsigned int getFailedWorkers() const;
+  void getTotalLatencyStats(Histogram &total, Histogram &snapshot, LatencyType type) const;
+  bool isCollectingLatencyStats(LatencyType type) const;
+  void getTotalCallStats(CallStats &total) const;
+  bool isCollectingCallStats() const;
+  void getThreadCpuTimes(std::vector<CpuTime> &stats) const;
+  void getThreadTargetIterations(std::vector<double> &targets, MQINT64 at) const;
+  bool isCollectingCpuStats() const;
+  bool isCollectingResourceStats() const;
+  bool isStartBarrier() const;
+  bool beginOpen();
+  void endOpen(bool opened);
+  bool awaitStart();
+  void logHistogram(char const * tag, Histogram const &h, CPH_TIME start, CPH_TIME end) const;
 
 private:
   uint64_t const threadId;
   std::vector<WorkerThread *> workers;
+  WorkerCountersArray workerCounters;
   StatsThread * pStatsThread;
+  StatsSink * pStatsSink;
+  MetricsServer * pMetricsServer;
+  FILE * pHistogramLog;
+  CPH_TIME histogramLogStart;
+  bool collectCpuStats;
+  bool collectResourceStats;
   bool shutdown;
   unsigned int runningWorkers;
   Lock threadCountLock;
 
+  /*The number of workers that may open their first session at once when starting together (wp), or 0 to start them one by one.*/
+  unsigned int openConcurrency;
+  /*The number of workers currently opening their first session (guarded by openLock).*/
+  unsigned int openingWorkers;
+  /*The number of workers whose first session is open, waiting to be released (guarded by threadCountLock).*/
+  unsigned int openedWorkers;
+  enum StartState {START_WAITING, START_RELEASED, START_ABORTED};
+  /*Whether workers held at the start barrier have been released, or should give up (set holding both openLock and startLock).*/
+  volatile StartState startState;
+  Lock openLock;
+  Lock startLock;
+
+  /*The threads driving the workers (np), or empty if each worker runs on its own thread.*/
+  std::vector<WorkerPool *> pools;
+
   void startWorkers(unsigned int interval, unsigned int timeout);
+  void startWorkersTogether(unsigned int timeout);
+  void startPools(unsigned int timeout);
+  void abortStart();
   void shutdownWorkers();
   void traceThreadSummary() const;
 };
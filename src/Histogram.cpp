@@ -0,0 +1,300 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#include "Histogram.hpp"
+#include <math.h>
+#include <string.h>
+
+#ifdef CPH_WINDOWS
+#include "msint.h"
+#else
+#include <inttypes.h>
+#endif
+
+#if defined(_MSC_VER) && defined(_WIN64)
+#include <intrin.h>
+#pragma intrinsic(_BitScanReverse64)
+#endif
+
+#define CPH_HISTOGRAM_NO_MIN (~(uint64_t) 0)
+
+namespace cph {
+
+char const * const latencyPrefixes[LATENCY_TYPES] = {"", "oneway_", "corrected_", "jitter_"};
+
+/*
+ * Function: mostSignificantBit
+ * ----------------------------
+ *
+ * Returns the (zero-based) position of the highest set bit of a non-zero value.
+ */
+static inline unsigned int mostSignificantBit(uint64_t value){
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(value);
+#elif defined(_MSC_VER) && defined(_WIN64)
+  unsigned long pos;
+  _BitScanReverse64(&pos, value);
+  return (unsigned int) pos;
+#else
+  unsigned int pos = 0;
+  while(value >>= 1) pos++;
+  return pos;
+#endif
+}
+
+Histogram::Histogram(){
+  reset();
+}
+
+Histogram::Histogram(Histogram const &other){
+  other.snapshot(*this);
+}
+
+Histogram & Histogram::operator=(Histogram const &other){
+  if(this != &other) other.snapshot(*this);
+  return *this;
+}
+
+/*
+ * Static Method: getBucketIndex
+ * -----------------------------
+ *
+ * Returns the index of the bucket that the given value is counted in.
+ */
+unsigned int Histogram::getBucketIndex(uint64_t value){
+  if(value < SUB_BUCKET_COUNT) return (unsigned int) value;
+
+  unsigned int msb = mostSignificantBit(value);
+  if(msb >= MAX_VALUE_BITS) return BUCKET_COUNT - 1;
+
+  unsigned int shift = msb - (SUB_BUCKET_BITS - 1);
+  return shift * SUB_BUCKET_HALF_COUNT + (unsigned int) (value >> shift);
+}
+
+/*
+ * Static Method: getBucketLowestValue
+ * -----------------------------------
+ *
+ * Returns the smallest value that would be counted in the given bucket.
+ */
+uint64_t Histogram::getBucketLowestValue(unsigned int index){
+  if(index < SUB_BUCKET_COUNT) return index;
+  unsigned int shift = index / SUB_BUCKET_HALF_COUNT - 1;
+  return (uint64_t) (index - shift * SUB_BUCKET_HALF_COUNT) << shift;
+}
+
+/*
+ * Static Method: getBucketHighestValue
+ * ------------------------------------
+ *
+ * Returns the largest value that would be counted in the given bucket.
+ */
+uint64_t Histogram::getBucketHighestValue(unsigned int index){
+  if(index < SUB_BUCKET_COUNT) return index;
+  unsigned int shift = index / SUB_BUCKET_HALF_COUNT - 1;
+  return (((uint64_t) (index - shift * SUB_BUCKET_HALF_COUNT + 1)) << shift) - 1;
+}
+
+/*
+ * Method: record
+ * --------------
+ *
+ * Count a single value. Must only be called by the thread that owns this histogram.
+ */
+void Histogram::record(uint64_t value){
+  cphAtomicInc64(&counts[getBucketIndex(value)]);
+  cphAtomicStore64(&totalValue, totalValue + value);
+  if(value < minValue) cphAtomicStore64(&minValue, value);
+  if(value > maxValue) cphAtomicStore64(&maxValue, value);
+  cphAtomicInc64(&totalCount);
+}
+
+/*
+ * Method: snapshot
+ * ----------------
+ *
+ * Copy the current state of this histogram into another, without interrupting the writer.
+ * The total count of the copy is calculated from the copied buckets, so that percentiles
+ * calculated from it are self-consistent even if values were recorded during the copy.
+ */
+void Histogram::snapshot(Histogram &into) const {
+  uint64_t total = 0;
+  for(unsigned int i=0; i<BUCKET_COUNT; i++){
+    uint64_t c = cphAtomicLoad64(&counts[i]);
+    into.counts[i] = c;
+    total += c;
+  }
+  into.totalCount = total;
+  into.totalValue = cphAtomicLoad64(&totalValue);
+  into.minValue = cphAtomicLoad64(&minValue);
+  into.maxValue = cphAtomicLoad64(&maxValue);
+}
+
+/*
+ * Method: reset
+ * -------------
+ *
+ * Clear all recorded values. Not safe to call while another thread is recording.
+ */
+void Histogram::reset(){
+  memset((void *) counts, 0, sizeof(counts));
+  totalCount = 0;
+  totalValue = 0;
+  minValue = CPH_HISTOGRAM_NO_MIN;
+  maxValue = 0;
+}
+
+/*
+ * Method: add
+ * -----------
+ *
+ * Merge the values recorded in another (quiescent) histogram into this one.
+ */
+void Histogram::add(Histogram const &other){
+  for(unsigned int i=0; i<BUCKET_COUNT; i++)
+    counts[i] += other.counts[i];
+  totalCount += other.totalCount;
+  totalValue += other.totalValue;
+  if(other.minValue < minValue) minValue = other.minValue;
+  if(other.maxValue > maxValue) maxValue = other.maxValue;
+}
+
+/*
+ * Method: subtract
+ * ----------------
+ *
+ * Remove the values recorded in an earlier snapshot of the same histogram from this one,
+ * leaving only those recorded in between. The min and max of the result are only known to
+ * bucket precision.
+ */
+void Histogram::subtract(Histogram const &other){
+  for(unsigned int i=0; i<BUCKET_COUNT; i++)
+    counts[i] = counts[i] >= other.counts[i] ? counts[i] - other.counts[i] : 0;
+  totalCount = totalCount >= other.totalCount ? totalCount - other.totalCount : 0;
+  totalValue = totalValue >= other.totalValue ? totalValue - other.totalValue : 0;
+  recalcMinMax();
+}
+
+void Histogram::recalcMinMax(){
+  uint64_t exactMax = maxValue;
+  minValue = CPH_HISTOGRAM_NO_MIN;
+  maxValue = 0;
+  for(unsigned int i=0; i<BUCKET_COUNT; i++){
+    if(counts[i] > 0){
+      if(minValue == CPH_HISTOGRAM_NO_MIN) minValue = getBucketLowestValue(i);
+      maxValue = getBucketHighestValue(i);
+    }
+  }
+  if(maxValue > exactMax) maxValue = exactMax;
+}
+
+uint64_t Histogram::getTotalCount() const {
+  return totalCount;
+}
+
+uint64_t Histogram::getTotalValue() const {
+  return totalValue;
+}
+
+/* Returns the number of values counted in the bucket with the given index */
+uint64_t Histogram::getCount(unsigned int index) const {
+  return counts[index];
+}
+
+uint64_t Histogram::getMinValue() const {
+  return totalCount == 0 ? 0 : minValue;
+}
+
+uint64_t Histogram::getMaxValue() const {
+  return maxValue;
+}
+
+double Histogram::getMean() const {
+  return totalCount == 0 ? 0 : (double) totalValue / totalCount;
+}
+
+/*
+ * Method: getValueAtPercentile
+ * ----------------------------
+ *
+ * Returns the value below which the given percentage of recorded values fall,
+ * reported as the highest value equivalent to the bucket containing that percentile.
+ */
+uint64_t Histogram::getValueAtPercentile(double percentile) const {
+  if(totalCount == 0) return 0;
+
+  uint64_t target = (uint64_t) ceil(percentile / 100 * totalCount);
+  if(target < 1) target = 1;
+  if(target > totalCount) target = totalCount;
+
+  uint64_t cumulative = 0;
+  for(unsigned int i=0; i<BUCKET_COUNT; i++){
+    cumulative += counts[i];
+    if(cumulative >= target){
+      uint64_t value = getBucketHighestValue(i);
+      return value < maxValue ? value : maxValue;
+    }
+  }
+  return maxValue;
+}
+
+/*
+ * Static Method: writeLogHeader
+ * -----------------------------
+ *
+ * Write the header of a histogram log, describing the bucket layout used by
+ * subsequent calls to writeLog. Their start timestamps are relative to startTime.
+ */
+void Histogram::writeLogHeader(FILE * fp, char const * procId, char const * units, long startTime){
+  fprintf(fp, "#[cph histogram log v1]\n");
+  fprintf(fp, "#[StartTime: %ld (seconds since epoch)]\n", startTime);
+  fprintf(fp, "#[id=%s,units=%s,subBucketBits=%u,bucketCount=%u]\n", procId, units, SUB_BUCKET_BITS, BUCKET_COUNT);
+  fprintf(fp, "#[Bucket i covers values [lowest(i),highest(i)]; merge by summing counts with equal i]\n");
+  fprintf(fp, "\"Tag\",\"StartTimestamp\",\"Interval_Length\",\"Count\",\"Max\",\"Buckets(index:count)\"\n");
+  fflush(fp);
+}
+
+/*
+ * Method: writeLog
+ * ----------------
+ *
+ * Append a line describing this histogram to a histogram log. Only non-empty buckets are written.
+ */
+void Histogram::writeLog(FILE * fp, char const * tag, double startSeconds, double lengthSeconds) const {
+  fprintf(fp, "Tag=%s,%.3f,%.3f,%" PRIu64 ",%" PRIu64 ",", tag, startSeconds, lengthSeconds, (uint64_t) totalCount, (uint64_t) maxValue);
+  bool first = true;
+  for(unsigned int i=0; i<BUCKET_COUNT; i++){
+    if(counts[i] > 0){
+      fprintf(fp, first ? "%u:%" PRIu64 : " %u:%" PRIu64, i, (uint64_t) counts[i]);
+      first = false;
+    }
+  }
+  fprintf(fp, "\n");
+  fflush(fp);
+}
+
+}
@@ -0,0 +1,122 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#ifndef HISTOGRAM_HPP_
+#define HISTOGRAM_HPP_
+
+#include <stdio.h>
+#include "cphAtomic.h"
+
+namespace cph {
+
+/*
+ * The different latency distributions a WorkerThread can collect.
+ */
+enum LatencyType {
+  /*Duration of each call to oneIteration.*/
+  LATENCY_ITERATION = 0,
+  /*Time between a message being put (by any thread or process on this machine) and it being got by this thread.*/
+  LATENCY_ONEWAY,
+  /*Time between the start the pacer intended for each iteration (when a rate is set) and its completion,
+    so that time spent behind schedule is not omitted (coordinated omission).*/
+  LATENCY_CORRECTED,
+  /*Difference (early or late) between the start the pacer intended for each iteration and its actual start.*/
+  LATENCY_JITTER,
+  LATENCY_TYPES
+};
+
+/*
+ * The prefix given to the statistics fields and histogram log tags of each LatencyType.
+ */
+extern char const * const latencyPrefixes[LATENCY_TYPES];
+
+/*
+ * Class: Histogram
+ * ----------------
+ *
+ * A log-linear bucketed histogram of (latency) values in the style of HdrHistogram.
+ *
+ * Values below 2^SUB_BUCKET_BITS are counted exactly; above that each power-of-two
+ * range is split into 2^(SUB_BUCKET_BITS-1) linear sub-buckets, giving a worst case
+ * relative error of 1/2^(SUB_BUCKET_BITS-1) (~1.6%) across the whole range.
+ *
+ * A histogram has a single writer (the thread calling record), which never blocks or
+ * takes a lock. Other threads take a consistent-enough copy with snapshot(), and obtain
+ * per-interval distributions by subtracting the previous snapshot from the current one,
+ * so the writer never needs to be reset.
+ *
+ * Bucket indices depend only on SUB_BUCKET_BITS, so histograms (and the bucket counts
+ * written by writeLog) from different threads or processes can be merged by adding
+ * the counts of matching indices.
+ */
+class Histogram {
+public:
+  static unsigned int const SUB_BUCKET_BITS = 7;
+  static unsigned int const SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+  static unsigned int const SUB_BUCKET_HALF_COUNT = SUB_BUCKET_COUNT >> 1;
+  /*Values at or above 2^MAX_VALUE_BITS are counted in the last bucket.*/
+  static unsigned int const MAX_VALUE_BITS = 40;
+  static unsigned int const BUCKET_COUNT = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 2) * SUB_BUCKET_HALF_COUNT;
+
+  Histogram();
+  Histogram(Histogram const &other);
+  Histogram & operator=(Histogram const &other);
+
+  void record(uint64_t value);
+  void snapshot(Histogram &into) const;
+  void reset();
+  void add(Histogram const &other);
+  void subtract(Histogram const &other);
+
+  uint64_t getTotalCount() const;
+  uint64_t getTotalValue() const;
+  uint64_t getCount(unsigned int index) const;
+  uint64_t getMinValue() const;
+  uint64_t getMaxValue() const;
+  double getMean() const;
+  uint64_t getValueAtPercentile(double percentile) const;
+
+  void writeLog(FILE * fp, char const * tag, double startSeconds, double lengthSeconds) const;
+  static void writeLogHeader(FILE * fp, char const * procId, char const * units, long startTime);
+
+  static unsigned int getBucketIndex(uint64_t value);
+  static uint64_t getBucketLowestValue(unsigned int index);
+  static uint64_t getBucketHighestValue(unsigned int index);
+
+private:
+  volatile uint64_t counts[BUCKET_COUNT];
+  volatile uint64_t totalCount;
+  volatile uint64_t totalValue;
+  volatile uint64_t minValue;
+  volatile uint64_t maxValue;
+
+  void recalcMinMax();
+};
+
+}
+
+#endif /* HISTOGRAM_HPP_ */
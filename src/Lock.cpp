@@ -155,6 +155,20 @@ void Lock::notify(){
 #endif
 }
 
+/*
+ * Method: notifyAll
+ * -----------------
+ *
+ * Wake up all threads that are currently waiting on this Lock.
+ */
+void Lock::notifyAll(){
+#ifdef ISUPPORT_CPP11
+  cv.notify_all();
+#else
+  pthread_cond_broadcast(&cv);
+#endif
+}
+
 /*
  * Function: durationToAbs
  * -----------------------
@@ -82,6 +82,7 @@ public:
   void wait();
   bool wait(absTime const &until);
   void notify();
+  void notifyAll();
 
 private:
 
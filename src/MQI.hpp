@@ -34,6 +34,7 @@ class MQITopic;
 class MQISubscription;
 class MQIMessage;
 class MQIException;
+class ReceiveBuffer;
 }
 
 #ifndef MQOBJECT_H_
@@ -73,11 +74,19 @@ private:
 
   MQHCONN hConn;
   bool ownsConnection;
+  /*Non-zero while messages are being delivered to a consumer callback (see startConsuming).*/
+  volatile uint64_t consuming;
+
+  /*Where to record the MQI calls made on this connection, or NULL if not collected.*/
+  CallStats * const pCallStats;
 
   mutable char msg[CPH_MQC_MSG_LEN];
 
+  MQCNO getCNO();
+
 public:
   MQIConnection(MQIWorkerThread * const pOwner, bool reconnect);
+  MQIConnection(Thread const * const pThread, CPH_CONFIG * const pConfig, MQIOpts const * const pOpts, char const * const name);
 
   MQHMSG createPutMessageHandle(MQMD* md, char* propsBuffer, MQLONG bufferLength) const;
   MQHMSG createGetMessageHandle() const;
@@ -89,6 +98,12 @@ public:
   MQLONG commitTransaction_try() const;
   void rollbackTransaction() const;
 
+  void registerConsumer(MQIObject const * const pObject, MQCB_FUNCTION * callback, void * context, MQMD & md, MQGMO & gmo) const;
+  void suspendConsumer(MQIObject const * const pObject) const;
+  void startConsuming();
+  bool stopConsuming();
+  void getAsyncStatus(MQSTS & sts) const;
+
   virtual ~MQIConnection();
 };
 
@@ -107,10 +122,14 @@ public:
   MQLONG bufferLen;
   /*The length of the message on the buffer.*/
   MQLONG messageLen;
+  /*Decides the size of the buffer as messages are got into it, or NULL to fit it to each message too big for it.*/
+  ReceiveBuffer * pReceiveBuffer;
 
   MQIMessage(size_t size);
   MQIMessage(MQIOpts const * const pOpts, bool empty);
   void resize(MQLONG newSize);
+  void grow(MQLONG needed, MQIObject const * const pObj);
+  bool received();
   ~MQIMessage();
 };
 
@@ -162,6 +181,7 @@ protected:
 
   inline void checkOpen() const;
   inline void checkNotOpen() const;
+  inline void recordGet(MQINT64 callStart, MQLONG mqcc, MQLONG mqrc) const;
 
 public:
   char const * const desc;
@@ -175,12 +195,14 @@ public:
   virtual void setName(char const * const format, ...) = 0;
   void setQMName(char const * const format, ...);
   void setQMName(MQCHAR48 const * qmName);
+  virtual MQLONG getMaxMsgLength() const;
 
   void put(MQIMessage const * const msg, MQMD& md, MQPMO& pmo);
   MQLONG put_try(MQIMessage const * const msg, MQMD& md, MQPMO& pmo);
   void put1(MQIMessage const * const msg, MQMD& md, MQPMO& pmo);
   void get(MQIMessage * const msg, MQMD& md, MQGMO& gmo) const;
   MQLONG get_try(MQIMessage * const msg, MQMD& md, MQGMO& gmo) const;
+  bool poll(MQIMessage * const msg, MQMD& md, MQGMO& gmo) const;
 
   void createSelector(CPH_TRACE * pTrc, MQBYTE24 correlId, char * customSelector);
   void createMsgHandleSelector(CPH_TRACE * pTrc, MQBYTE24 correlId);
@@ -203,6 +225,7 @@ public:
   virtual char const * getName() const;
   virtual void setName(char const * const format, ...);
   void setName(MQCHAR48 const * name);
+  virtual MQLONG getMaxMsgLength() const;
 };
 
 /*
@@ -333,6 +356,28 @@ inline void cphTraceId(CPH_TRACE * const pTrc, char const * const label, MQBYTE2
     throw cph::MQIException(#F, mqcc, mqrc);\
   }\
 
+/*
+ * Macro: CPHCALLMQSTATS
+ * ---------------------
+ *
+ * As CPHCALLMQ, additionally recording the elapsed time and outcome
+ * of the call in the given CallStats, unless it is NULL.
+ */
+#define CPHCALLMQSTATS(S, T, F, ...) \
+  MQLONG mqcc=0, mqrc=0;\
+  CPHTRACEMSG(T, (char*) "About to call %s.", #F)\
+  if((S)==NULL) {\
+    F(__VA_ARGS__, &mqcc, &mqrc);\
+  } else {\
+    MQINT64 cphCallStart = cphUtilGetTimestampNs();\
+    F(__VA_ARGS__, &mqcc, &mqrc);\
+    (S)->record(CALL_##F, (uint64_t) (cphUtilGetTimestampNs() - cphCallStart), mqcc==MQCC_FAILED);\
+  }\
+  if(mqrc!=MQRC_NONE) {\
+    CPHTRACEMSG(T, (char*) "Exception from call: Comp Code:%ld ;Reason: %ld", mqcc, mqrc)\
+    throw cph::MQIException(#F, mqcc, mqrc);\
+  }\
+
 } /* Namespace */
 
 #endif /* MQOBJECT_H_ */
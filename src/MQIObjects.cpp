@@ -173,7 +173,7 @@ MQIObject::~MQIObject() {
   CPHTRACEENTRY(pConn->pTrc)
   if(hObj!=MQHO_NONE && hObj!=MQHO_UNUSABLE_HOBJ){
     try {
-      CPHCALLMQ(pConn->pTrc, MQCLOSE, pConn->hConn, &hObj, MQCO_NONE)
+      CPHCALLMQSTATS(pConn->pCallStats, pConn->pTrc, MQCLOSE, pConn->hConn, &hObj, MQCO_NONE)
     } catch (cph::MQIException &e) {
       (void)e;
       CPHTRACEMSG(pConn->pTrc, "OOPS! MQIException in ~MQIObject()!")
@@ -200,6 +200,23 @@ inline void MQIObject::checkNotOpen() const{
       throw logic_error("Cannot alter MQI object properties: already opened.");
 }
 
+/*
+ * Method: recordGet
+ * -----------------
+ *
+ * Record an MQGET started at the given time (from cphUtilGetTimestampNs) in the connection's CallStats.
+ * MQRC_NO_MSG_AVAILABLE and MQRC_TRUNCATED_MSG_FAILED are counted as events rather than failures.
+ */
+inline void MQIObject::recordGet(MQINT64 callStart, MQLONG mqcc, MQLONG mqrc) const {
+  CallStats * const pCallStats = pConn->pCallStats;
+  bool retry = mqrc==MQRC_NO_MSG_AVAILABLE || mqrc==MQRC_TRUNCATED_MSG_FAILED;
+  pCallStats->record(CALL_MQGET, (uint64_t) (cphUtilGetTimestampNs() - callStart), mqcc==MQCC_FAILED && !retry);
+  if(mqrc==MQRC_NO_MSG_AVAILABLE)
+    pCallStats->count(EVENT_GET_NO_MSG);
+  else if(mqrc==MQRC_TRUNCATED_MSG_FAILED)
+    pCallStats->count(EVENT_GET_TRUNCATED);
+}
+
 char const * MQIObject::getQMName() const {
   return od.ObjectQMgrName;
 }
@@ -239,6 +256,16 @@ void MQIObject::setQMName(MQCHAR48 const * qmName){
   CPHTRACEEXIT(pConn->pTrc)
 }
 
+/*
+ * Method: getMaxMsgLength
+ * -----------------------
+ *
+ * The maximum message length of the object, or 0 if it isn't known, as it isn't for topics and subscriptions.
+ */
+MQLONG MQIObject::getMaxMsgLength() const {
+  return 0;
+}
+
 /*
  * Method: open
  * ------------
@@ -274,7 +301,7 @@ void MQIObject::open(bool log) {
       cphLogPrintLn(pConn->pLog, LOG_VERBOSE, pConn->msg);
     }
 
-    CPHCALLMQ(pConn->pTrc, MQOPEN, pConn->hConn, &od, opts, &hObj)
+    CPHCALLMQSTATS(pConn->pCallStats, pConn->pTrc, MQOPEN, pConn->hConn, &od, opts, &hObj)
   }
   CPHTRACEEXIT(pConn->pTrc)
 }
@@ -293,7 +320,7 @@ void MQIObject::put(MQIMessage const * const msg, MQMD& md, MQPMO& pmo) {
     put1(msg, md, pmo);
   else if(hObj!=MQHO_NONE && hObj!=MQHO_UNUSABLE_HOBJ){
     CPHTRACEMSG(pConn->pTrc, "Putting message:\n[%.*s]", msg->bufferLen ,msg->buffer)
-    CPHCALLMQ(pConn->pTrc, MQPUT, pConn->hConn, hObj, &md, &pmo, msg->messageLen, msg->buffer)
+    CPHCALLMQSTATS(pConn->pCallStats, pConn->pTrc, MQPUT, pConn->hConn, hObj, &md, &pmo, msg->messageLen, msg->buffer)
   } else
     throw logic_error("Cannot put to non-open object handle if put1 is not specified.");
 
@@ -316,7 +343,7 @@ MQLONG MQIObject::put_try(MQIMessage const * const msg, MQMD& md, MQPMO& pmo) {
   else if(hObj!=MQHO_NONE && hObj!=MQHO_UNUSABLE_HOBJ){
     CPHTRACEMSG(pConn->pTrc, "Putting message:\n[%.*s]", msg->bufferLen, msg->buffer)
     try{
-      CPHCALLMQ(pConn->pTrc, MQPUT, pConn->hConn, hObj, &md, &pmo, msg->messageLen, msg->buffer)
+      CPHCALLMQSTATS(pConn->pCallStats, pConn->pTrc, MQPUT, pConn->hConn, hObj, &md, &pmo, msg->messageLen, msg->buffer)
     } catch (cph::MQIException &e){
       rc = e.reasonCode;
     }
@@ -337,7 +364,7 @@ MQLONG MQIObject::put_try(MQIMessage const * const msg, MQMD& md, MQPMO& pmo) {
 void MQIObject::put1(MQIMessage const * const msg, MQMD& md, MQPMO& pmo) {
   CPHTRACEENTRY(pConn->pTrc)
   CPHTRACEMSG(pConn->pTrc, "Put-1-ing message:\n[%s]", msg->buffer)
-  CPHCALLMQ(pConn->pTrc, MQPUT1, pConn->hConn, &od, &md, &pmo, msg->messageLen, msg->buffer)
+  CPHCALLMQSTATS(pConn->pCallStats, pConn->pTrc, MQPUT1, pConn->hConn, &od, &md, &pmo, msg->messageLen, msg->buffer)
   CPHTRACEEXIT(pConn->pTrc)
 }
 
@@ -372,7 +399,13 @@ void MQIObject::get(MQIMessage * const msg, MQMD& md, MQGMO& gmo) const {
 
     if(waitUnlimited) gmo.WaitInterval = CPH_TIMEOUT_UNLIMITED;
     CPHTRACEMSG(pConn->pTrc, "About to call MQGET.")
-    MQGET(pConn->hConn, hObj, &md, &gmo, msg->bufferLen, msg->buffer, &msg->messageLen, &mqcc, &mqrc);
+    if(pConn->pCallStats == NULL) {
+      MQGET(pConn->hConn, hObj, &md, &gmo, msg->bufferLen, msg->buffer, &msg->messageLen, &mqcc, &mqrc);
+    } else {
+      MQINT64 callStart = cphUtilGetTimestampNs();
+      MQGET(pConn->hConn, hObj, &md, &gmo, msg->bufferLen, msg->buffer, &msg->messageLen, &mqcc, &mqrc);
+      recordGet(callStart, mqcc, mqrc);
+    }
     // Reset WaitInterval in case we return.
     if(waitUnlimited) gmo.WaitInterval = MQWI_UNLIMITED;
 
@@ -387,12 +420,14 @@ void MQIObject::get(MQIMessage * const msg, MQMD& md, MQGMO& gmo) const {
 
     case MQRC_NONE:
       CPHTRACEMSG(pConn->pTrc, "Got message:\n[%.*s]", msg->bufferLen, msg->buffer)
+      if(msg->received() && pConn->pCallStats!=NULL)
+        pConn->pCallStats->count(EVENT_GET_BUFFER_SHRUNK);
       CPHTRACEEXIT(pConn->pTrc)
       return;
 
     case MQRC_TRUNCATED_MSG_FAILED:
-      CPHTRACEMSG(pConn->pTrc, "Message buffer to small. Growing buffer to %ld bytes and retrying.", msg->messageLen)
-      msg->resize(msg->messageLen);
+      CPHTRACEMSG(pConn->pTrc, "Message buffer to small for %ld bytes. Growing buffer and retrying.", msg->messageLen)
+      msg->grow(msg->messageLen, this);
       msg->messageLen = 0;
 
       md = mdCopy;
@@ -454,7 +489,13 @@ MQLONG MQIObject::get_try(MQIMessage * const msg, MQMD& md, MQGMO& gmo) const {
 
     if(waitUnlimited) gmo.WaitInterval = CPH_TIMEOUT_UNLIMITED;
     CPHTRACEMSG(pConn->pTrc, "About to call MQGET.")
-    MQGET(pConn->hConn, hObj, &md, &gmo, msg->bufferLen, msg->buffer, &msg->messageLen, &mqcc, &mqrc);
+    if(pConn->pCallStats == NULL) {
+      MQGET(pConn->hConn, hObj, &md, &gmo, msg->bufferLen, msg->buffer, &msg->messageLen, &mqcc, &mqrc);
+    } else {
+      MQINT64 callStart = cphUtilGetTimestampNs();
+      MQGET(pConn->hConn, hObj, &md, &gmo, msg->bufferLen, msg->buffer, &msg->messageLen, &mqcc, &mqrc);
+      recordGet(callStart, mqcc, mqrc);
+    }
     // Reset WaitInterval in case we return.
     if(waitUnlimited) gmo.WaitInterval = MQWI_UNLIMITED;
 
@@ -469,12 +510,14 @@ MQLONG MQIObject::get_try(MQIMessage * const msg, MQMD& md, MQGMO& gmo) const {
 
     case MQRC_NONE:
       CPHTRACEMSG(pConn->pTrc, "Got message:\n[%.*s]", msg->bufferLen, msg->buffer)
+      if(msg->received() && pConn->pCallStats!=NULL)
+        pConn->pCallStats->count(EVENT_GET_BUFFER_SHRUNK);
       CPHTRACEEXIT(pConn->pTrc)
       return mqrc;
 
     case MQRC_TRUNCATED_MSG_FAILED:
-      CPHTRACEMSG(pConn->pTrc, "Message buffer to small. Growing buffer to %ld bytes and retrying.", msg->messageLen)
-      msg->resize(msg->messageLen);
+      CPHTRACEMSG(pConn->pTrc, "Message buffer to small for %ld bytes. Growing buffer and retrying.", msg->messageLen)
+      msg->grow(msg->messageLen, this);
       msg->messageLen = 0;
 
       md = mdCopy;
@@ -506,6 +549,60 @@ MQLONG MQIObject::get_try(MQIMessage * const msg, MQMD& md, MQGMO& gmo) const {
   }
 }
 
+/*
+ * Method: poll
+ * ------------
+ *
+ * Get a message from this MQIObject, if one arrives within the wait interval of the given options.
+ *
+ * Returns: false if none did (MQRC_NO_MSG_AVAILABLE), which is not treated as an error as it is by get.
+ */
+bool MQIObject::poll(MQIMessage * const msg, MQMD& md, MQGMO& gmo) const {
+  CPHTRACEENTRY(pConn->pTrc)
+  if(!canGet)
+    throw logic_error("An attempt was made to get from an MQ object that was not open for input.");
+  checkOpen();
+
+  MQMD const mdCopy = md;
+  MQGMO const gmoCopy = gmo;
+  MQLONG mqcc=0, mqrc=0;
+
+  while(true){
+    if(pConn->pCallStats == NULL) {
+      MQGET(pConn->hConn, hObj, &md, &gmo, msg->bufferLen, msg->buffer, &msg->messageLen, &mqcc, &mqrc);
+    } else {
+      MQINT64 callStart = cphUtilGetTimestampNs();
+      MQGET(pConn->hConn, hObj, &md, &gmo, msg->bufferLen, msg->buffer, &msg->messageLen, &mqcc, &mqrc);
+      recordGet(callStart, mqcc, mqrc);
+    }
+
+    switch(mqrc){
+    case MQRC_NONE:
+      if(msg->received() && pConn->pCallStats!=NULL)
+        pConn->pCallStats->count(EVENT_GET_BUFFER_SHRUNK);
+      CPHTRACEEXIT(pConn->pTrc)
+      return true;
+
+    case MQRC_TRUNCATED_MSG_FAILED:
+      CPHTRACEMSG(pConn->pTrc, "Message buffer to small for %ld bytes. Growing buffer and retrying.", msg->messageLen)
+      msg->grow(msg->messageLen, this);
+      msg->messageLen = 0;
+
+      md = mdCopy;
+      gmo = gmoCopy;
+      continue;
+
+    case MQRC_NO_MSG_AVAILABLE:
+      CPHTRACEEXIT(pConn->pTrc)
+      return false;
+
+    default:
+      CPHTRACEEXIT(pConn->pTrc)
+      throw MQIException("MQGET", mqcc, mqrc, md.CorrelId, getName());
+    }
+  }
+}
+
 
 #define f_id4 "%02X"
 
@@ -637,6 +734,37 @@ void MQIQueue::setName(MQCHAR48 const * name){
   CPHTRACEEXIT(pConn->pTrc)
 }
 
+/*
+ * Method: getMaxMsgLength
+ * -----------------------
+ *
+ * Inquire the maximum message length (MAXMSGL) of the queue, through a handle opened just for this.
+ *
+ * Returns: the MAXMSGL, or 0 if it couldn't be inquired (which is traced, but otherwise not an error).
+ */
+MQLONG MQIQueue::getMaxMsgLength() const {
+  CPHTRACEENTRY(pConn->pTrc)
+  MQOD inqOD = od;
+  MQHOBJ hInq = MQHO_NONE;
+  MQLONG mqcc = 0, mqrc = 0;
+  MQLONG selector = MQIA_MAX_MSG_LENGTH;
+  MQLONG maxMsgLength = 0;
+
+  MQOPEN(pConn->hConn, &inqOD, MQOO_INQUIRE | MQOO_FAIL_IF_QUIESCING, &hInq, &mqcc, &mqrc);
+  if(mqcc!=MQCC_FAILED){
+    MQINQ(pConn->hConn, hInq, 1, &selector, 1, &maxMsgLength, 0, NULL, &mqcc, &mqrc);
+    if(mqcc==MQCC_FAILED) maxMsgLength = 0;
+    MQLONG closeCC = 0, closeRC = 0;
+    MQCLOSE(pConn->hConn, &hInq, MQCO_NONE, &closeCC, &closeRC);
+  }
+  if(mqcc==MQCC_FAILED){
+    CPHTRACEMSG(pConn->pTrc, "Could not inquire MAXMSGL: Comp Code:%ld ;Reason: %ld", mqcc, mqrc)
+  }
+
+  CPHTRACEEXIT(pConn->pTrc)
+  return maxMsgLength;
+}
+
 
 
 /*
@@ -684,7 +812,7 @@ MQISubscription::~MQISubscription() {
   CPHTRACEENTRY(pConn->pTrc)
   if(hSub!=MQHO_NONE && hSub!=MQHO_UNUSABLE_HOBJ){
     try {
-      CPHCALLMQ(pConn->pTrc, MQCLOSE, pConn->hConn, &hSub, unsubscribeOnClose ? MQCO_REMOVE_SUB : MQCO_NONE)
+      CPHCALLMQSTATS(pConn->pCallStats, pConn->pTrc, MQCLOSE, pConn->hConn, &hSub, unsubscribeOnClose ? MQCO_REMOVE_SUB : MQCO_NONE)
     } catch (cph::MQIException &e) {
       (void)e;
       CPHTRACEMSG(pConn->pTrc, "OOPS! MQIException in ~MQISubscription()!")
@@ -718,7 +846,7 @@ void MQISubscription::open(bool log) {
     snprintf(pConn->msg, CPH_MQC_MSG_LEN, "[%s] Subscribing to topic string: %s", pConn->name, getTopicString());
     cphLogPrintLn(pConn->pLog, LOG_VERBOSE, pConn->msg);
   }
-  CPHCALLMQ(pConn->pTrc, MQSUB, pConn->hConn, &sd, &hObj, &hSub)
+  CPHCALLMQSTATS(pConn->pCallStats, pConn->pTrc, MQSUB, pConn->hConn, &sd, &hObj, &hSub)
   CPHTRACEEXIT(pConn->pTrc)
 }
 
@@ -417,6 +417,9 @@ MQIOpts::MQIOpts(CPH_CONFIG* pConfig, bool putter, bool getter, bool reconnector
    * -----------
    */
 
+  asyncPut = false;
+  asyncStatusCount = asyncStatusInterval = 0;
+
   if (putter) {
     //Persistence
     if (CPHTRUE != cphConfigGetBoolean(pConfig, &tempInt, "pp"))
@@ -438,6 +441,20 @@ MQIOpts::MQIOpts(CPH_CONFIG* pConfig, bool putter, bool getter, bool reconnector
     put1 = tempInt==CPHTRUE;
     CPHTRACEMSG(pConfig->pTrc, "Use PUT1: %s", put1 ? "yes" : "no")
 
+    //Asynchronous put
+    if (CPHTRUE != cphConfigGetBoolean(pConfig, &tempInt, "ap"))
+      configError(pConfig, "(ap) Cannot determine whether to put asynchronously.");
+    asyncPut = tempInt==CPHTRUE;
+    CPHTRACEMSG(pTrc, "Asynchronous put: %s", asyncPut ? "yes" : "no")
+
+    if (asyncPut) {
+      if (CPHTRUE != cphConfigGetInt(pConfig, (int *) &asyncStatusCount, "apc"))
+        configError(pConfig, "(apc) Cannot retrieve number of asynchronous puts between status checks.");
+      if (CPHTRUE != cphConfigGetInt(pConfig, (int *) &asyncStatusInterval, "api"))
+        configError(pConfig, "(api) Cannot retrieve interval between asynchronous put status checks.");
+      CPHTRACEMSG(pTrc, "Asynchronous put status checked every %u puts, %ums", asyncStatusCount, asyncStatusInterval)
+    }
+
     MQPMO protoPMO = {MQPMO_DEFAULT};
     protoPMO.Version = MQPMO_VERSION_3;
     protoPMO.Options |= MQPMO_NEW_MSG_ID | MQPMO_NEW_CORREL_ID;
@@ -446,6 +463,7 @@ MQIOpts::MQIOpts(CPH_CONFIG* pConfig, bool putter, bool getter, bool reconnector
     } else if (noSyncOverride) {
       protoPMO.Options |= MQPMO_NO_SYNCPOINT;
     }
+    if (asyncPut) protoPMO.Options |= MQPMO_ASYNC_RESPONSE;
     pmo = protoPMO;
 
     putMD = protoMD;
@@ -476,6 +494,28 @@ MQIOpts::MQIOpts(CPH_CONFIG* pConfig, bool putter, bool getter, bool reconnector
     }
     CPHTRACEMSG(pTrc, "Receive Message buffer size: %d", receiveSize)
 
+    //Adaptive receive buffer
+    if (CPHTRUE != cphConfigGetBoolean(pConfig, &tempInt, "ra"))
+      configError(pConfig, "(ra) Cannot retrieve adaptive receive buffer option.");
+    adaptiveReceive = tempInt==CPHTRUE;
+    CPHTRACEMSG(pTrc, "Adaptive receive buffer: %s", adaptiveReceive ? "yes" : "no")
+    if (adaptiveReceive) {
+      if (CPHTRUE != cphConfigGetInt(pConfig, &tempInt, "rh"))
+        configError(pConfig, "(rh) Cannot retrieve receive buffer high-water percentile.");
+      if (tempInt<1 || tempInt>100)
+        configError(pConfig, "(rh) Receive buffer high-water percentile must be between 1 and 100.");
+      receivePercentile = tempInt;
+      CPHTRACEMSG(pTrc, "Receive buffer high-water percentile: %u", receivePercentile)
+
+      if (CPHTRUE != cphConfigGetBoolean(pConfig, &tempInt, "rx"))
+        configError(pConfig, "(rx) Cannot retrieve whether to size the receive buffer from MAXMSGL.");
+      receiveToMaxMsgLength = tempInt==CPHTRUE;
+      CPHTRACEMSG(pTrc, "Grow receive buffer to MAXMSGL: %s", receiveToMaxMsgLength ? "yes" : "no")
+    } else {
+      receivePercentile = 100;
+      receiveToMaxMsgLength = false;
+    }
+
     //Read-ahead
     if (connType==REMOTE) {
       if (CPHTRUE != cphConfigGetBoolean(pConfig, &tempInt, "jy"))
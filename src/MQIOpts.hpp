@@ -96,11 +96,17 @@ public:
   bool ppnOverride;
   bool noSyncOverride;
   bool populateMsgCompList;
+  bool asyncPut;                    //Put with MQPMO_ASYNC_RESPONSE
+  unsigned int asyncStatusCount;    //Asynchronous puts between calls to MQSTAT (0 = not by count)
+  unsigned int asyncStatusInterval; //Milliseconds between calls to MQSTAT (0 = not by time)
 
   //Get options
   MQLONG timeout;
   bool readAhead;
   MQLONG receiveSize;
+  bool adaptiveReceive;              //Size the receive buffer from the messages received (see ReceiveBuffer)
+  unsigned int receivePercentile;    //Percentile of message sizes the receive buffer is kept at
+  bool receiveToMaxMsgLength;        //Grow the receive buffer straight to the queue's MAXMSGL
 
   //Put & Get options
   char destinationPrefix[MQ_Q_NAME_LENGTH];
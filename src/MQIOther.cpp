@@ -31,6 +31,7 @@
 #include <cstdlib>
 
 #include "MQI.hpp"
+#include "ReceiveBuffer.hpp"
 
 using namespace std;
 
@@ -53,34 +54,28 @@ MQIConnection::MQIConnection(MQIWorkerThread * const pOwner, bool reconnect) :
     pTrc(pOwner->pConfig->pTrc),
     pLog(pOwner->pConfig->pLog),
     pOpts(pOwner->pOpts),
-    name(pOwner->name.data()) {
+    name(pOwner->name.data()),
+    consuming(0),
+    pCallStats(pOwner->pCallStats) {
   CPHTRACEENTRY(pTrc)
 
-  snprintf(msg, CPH_MQC_MSG_LEN, "[%s] Connecting to QM: %s", name, pOpts->QMName);
-
-  MQCNO cno;
   //char procId[80];
 
   CPH_TIME reconnectStart;
   //long reconnectTime_ms=0;
 
-  cno = pOpts->getCNO();
-
-  // If application name hasnt already been set, use thread name
-  #if MQCNO_CURRENT_VERSION > 6
-  if (cno.ApplName[0] == ' ') {
-    cno.Version = MQCNO_VERSION_7;
-    strcpy(cno.ApplName, name);
-  }
-  #endif
+  MQCNO cno = getCNO();
 
-  if(pOpts->connType==REMOTE && !pOpts->useChannelTable){
-    snprintf(msg+strlen(msg), CPH_MQC_MSG_LEN-strlen(msg), " (connection: %s; channel: %s)\n", ((MQCD*) cno.ClientConnPtr)->ConnectionName, ((MQCD*) cno.ClientConnPtr)->ChannelName);
-    cphLogPrintLn(pLog, LOG_VERBOSE, msg);
-  }
+  /*
+   * A WorkerPool (np) thread connects for each of the workers it drives, and a thread can only hold
+   * one unshared connection handle, so pooled workers' handles (including on reconnection) are shared
+   * (usable on any thread, one at a time). The option is valid from MQCNO_VERSION_1.
+   */
+  if(pOwner->isPooled())
+    cno.Options |= MQCNO_HANDLE_SHARE_BLOCK;
 
   if(!reconnect) {
-	  CPHCALLMQ(pTrc, MQCONNX, (PMQCHAR) pOpts->QMName, &cno, &hConn)
+	  CPHCALLMQSTATS(pCallStats, pTrc, MQCONNX, (PMQCHAR) pOpts->QMName, &cno, &hConn)
 	  ownsConnection = mqrc!=MQRC_ALREADY_CONNECTED;
   } else {
 	  int cc;
@@ -92,7 +87,7 @@ MQIConnection::MQIConnection(MQIWorkerThread * const pOwner, bool reconnect) :
 		cc = 0;
 		rc = 0;
 	  try {
-	    CPHCALLMQ(pTrc, MQCONNX, (PMQCHAR) pOpts->QMName, &cno, &hConn)
+	    CPHCALLMQSTATS(pCallStats, pTrc, MQCONNX, (PMQCHAR) pOpts->QMName, &cno, &hConn)
 	  } catch (cph::MQIException &e) {
 	    cc = e.compCode;
 		  rc = e.reasonCode;
@@ -109,13 +104,62 @@ MQIConnection::MQIConnection(MQIWorkerThread * const pOwner, bool reconnect) :
   CPHTRACEEXIT(pTrc)
 }
 
+/*
+ * Constructor: MQIConnection
+ * --------------------------
+ *
+ * Connect on behalf of a thread other than a worker (such as the ReplyDispatcher),
+ * whose calls aren't recorded in any CallStats.
+ */
+MQIConnection::MQIConnection(Thread const * const pThread, CPH_CONFIG * const pConfig, MQIOpts const * const pOpts, char const * const name) :
+    pCurrentThread(pThread),
+    pTrc(pConfig->pTrc),
+    pLog(pConfig->pLog),
+    pOpts(pOpts),
+    name(name),
+    consuming(0),
+    pCallStats(NULL) {
+  CPHTRACEENTRY(pTrc)
+  MQCNO cno = getCNO();
+  CPHCALLMQSTATS(pCallStats, pTrc, MQCONNX, (PMQCHAR) pOpts->QMName, &cno, &hConn)
+  ownsConnection = mqrc!=MQRC_ALREADY_CONNECTED;
+  CPHTRACEEXIT(pTrc)
+}
+
+/*
+ * Method: getCNO
+ * --------------
+ *
+ * The connect options for this connection, with the application name defaulting to the connection's name.
+ * The connection is logged (if client-connected without a channel table).
+ */
+MQCNO MQIConnection::getCNO(){
+  snprintf(msg, CPH_MQC_MSG_LEN, "[%s] Connecting to QM: %s", name, pOpts->QMName);
+
+  MQCNO cno = pOpts->getCNO();
+
+  // If application name hasnt already been set, use thread name
+  #if MQCNO_CURRENT_VERSION > 6
+  if (cno.ApplName[0] == ' ') {
+    cno.Version = MQCNO_VERSION_7;
+    strcpy(cno.ApplName, name);
+  }
+  #endif
+
+  if(pOpts->connType==REMOTE && !pOpts->useChannelTable){
+    snprintf(msg+strlen(msg), CPH_MQC_MSG_LEN-strlen(msg), " (connection: %s; channel: %s)\n", ((MQCD*) cno.ClientConnPtr)->ConnectionName, ((MQCD*) cno.ClientConnPtr)->ChannelName);
+    cphLogPrintLn(pLog, LOG_VERBOSE, msg);
+  }
+  return cno;
+}
+
 MQIConnection::~MQIConnection() {
   CPHTRACEENTRY(pTrc)
   if(ownsConnection){
     snprintf(msg, CPH_MQC_MSG_LEN, "[%s] Disconnecting from QM: %s", name, pOpts->QMName);
     cphLogPrintLn(pLog, LOG_VERBOSE, msg);
     try {
-      CPHCALLMQ(pTrc, MQDISC, &hConn)
+      CPHCALLMQSTATS(pCallStats, pTrc, MQDISC, &hConn)
     } catch (cph::MQIException &e) {
       (void)e;
       CPHTRACEMSG(pTrc, "OOPS! MQIException in ~MQIConnection()!")
@@ -133,7 +177,7 @@ MQIConnection::~MQIConnection() {
 MQHMSG MQIConnection::createGetMessageHandle() const {
   CPHTRACEENTRY(pTrc)
   MQHMSG rc = MQHM_NONE;
-  CPHCALLMQ(pTrc, MQCRTMH, hConn, (PMQVOID) &CrtMHOpts, &rc)
+  CPHCALLMQSTATS(pCallStats, pTrc, MQCRTMH, hConn, (PMQVOID) &CrtMHOpts, &rc)
   CPHTRACEEXIT(pTrc)
   return rc;
 }
@@ -146,7 +190,7 @@ MQHMSG MQIConnection::createGetMessageHandle() const {
  */
 void MQIConnection::setMessageProperties(MQHMSG messageHandle, MQCHARV* vs, MQPD* pd, MQLONG valuelen, char* value) const {
   CPHTRACEENTRY(pTrc)
-  CPHCALLMQ(pTrc, MQSETMP, hConn, messageHandle, (PMQVOID) &SetMHOpts, &vs, &pd, MQTYPE_STRING, valuelen, value)
+  CPHCALLMQSTATS(pCallStats, pTrc, MQSETMP, hConn, messageHandle, (PMQVOID) &SetMHOpts, &vs, &pd, MQTYPE_STRING, valuelen, value)
   CPHTRACEEXIT(pTrc)
   return;
 }
@@ -162,7 +206,7 @@ MQHMSG MQIConnection::createPutMessageHandle(MQMD* md, char* propsBuffer, MQLONG
   CPHTRACEENTRY(pTrc)
   MQHMSG rc = createGetMessageHandle();
   MQLONG dataLen;
-  CPHCALLMQ(pTrc, MQBUFMH, hConn, rc, (PMQVOID) &BufMHOpts, md, bufferLength, propsBuffer, &dataLen)
+  CPHCALLMQSTATS(pCallStats, pTrc, MQBUFMH, hConn, rc, (PMQVOID) &BufMHOpts, md, bufferLength, propsBuffer, &dataLen)
   CPHTRACEEXIT(pTrc)
   return rc;
 }
@@ -175,7 +219,7 @@ MQHMSG MQIConnection::createPutMessageHandle(MQMD* md, char* propsBuffer, MQLONG
  */
 void MQIConnection::destroyMessageHandle(MQHMSG& handle) const {
   CPHTRACEENTRY(pTrc)
-  CPHCALLMQ(pTrc, MQDLTMH, hConn, &handle, (PMQVOID) &DltMHOpts)
+  CPHCALLMQSTATS(pCallStats, pTrc, MQDLTMH, hConn, &handle, (PMQVOID) &DltMHOpts)
   handle = MQHM_NONE;
   CPHTRACEEXIT(pTrc)
 }
@@ -189,7 +233,7 @@ void MQIConnection::destroyMessageHandle(MQHMSG& handle) const {
  */
 void MQIConnection::commitTransaction() const{
   CPHTRACEENTRY(pTrc)
-  CPHCALLMQ(pTrc, MQCMIT, hConn)
+  CPHCALLMQSTATS(pCallStats, pTrc, MQCMIT, hConn)
   CPHTRACEEXIT(pTrc)
 }
 
@@ -204,7 +248,7 @@ MQLONG MQIConnection::commitTransaction_try() const{
   CPHTRACEENTRY(pTrc)
 	MQLONG rc =0;
   try {
-    CPHCALLMQ(pTrc, MQCMIT, hConn)
+    CPHCALLMQSTATS(pCallStats, pTrc, MQCMIT, hConn)
   } catch (cph::MQIException &e) {
     rc = e.reasonCode;
   }
@@ -221,7 +265,96 @@ MQLONG MQIConnection::commitTransaction_try() const{
  */
 void MQIConnection::rollbackTransaction() const {
   CPHTRACEENTRY(pTrc)
-  CPHCALLMQ(pTrc, MQBACK, hConn)
+  CPHCALLMQSTATS(pCallStats, pTrc, MQBACK, hConn)
+  CPHTRACEEXIT(pTrc)
+}
+
+/*
+ * Method: registerConsumer
+ * ------------------------
+ *
+ * Register a callback to be given the messages got from the given object (as if by MQGET with the given
+ * message descriptor and options) once startConsuming is called. The callback is called on a thread
+ * belonging to MQ, with the given context as the CallbackArea of its MQCBC, and the whole of each message.
+ */
+void MQIConnection::registerConsumer(MQIObject const * const pObject, MQCB_FUNCTION * callback, void * context, MQMD & md, MQGMO & gmo) const {
+  CPHTRACEENTRY(pTrc)
+  MQCBD cbd = {MQCBD_DEFAULT};
+  cbd.CallbackType = MQCBT_MESSAGE_CONSUMER;
+  cbd.CallbackFunction = (MQPTR) callback;
+  cbd.CallbackArea = context;
+  cbd.MaxMsgLength = MQCBD_FULL_MSG_LENGTH;
+  CPHCALLMQSTATS(pCallStats, pTrc, MQCB, hConn, MQOP_REGISTER, &cbd, pObject->hObj, &md, &gmo)
+  CPHTRACEEXIT(pTrc)
+}
+
+/*
+ * Method: suspendConsumer
+ * -----------------------
+ *
+ * Stop delivering messages from the given object to the callback registered for it, leaving any others
+ * running. May be called from within a callback, so that it is given no more messages once it returns.
+ */
+void MQIConnection::suspendConsumer(MQIObject const * const pObject) const {
+  CPHTRACEENTRY(pTrc)
+  MQCBD cbd = {MQCBD_DEFAULT};
+  CPHCALLMQSTATS(pCallStats, pTrc, MQCB, hConn, MQOP_SUSPEND, &cbd, pObject->hObj, NULL, NULL)
+  CPHTRACEEXIT(pTrc)
+}
+
+/*
+ * Method: startConsuming
+ * ----------------------
+ *
+ * Start delivering messages to the callbacks registered with registerConsumer. Until stopConsuming is
+ * called, no other MQI calls may be made on this connection, except from within a callback.
+ *
+ * Once MQCTL has started them, the callbacks (on MQ's thread) are the only writers of the worker's
+ * statistics, whose seqlocks allow only one. So this call is counted, untimed, before it's issued;
+ * if it fails, the MQIException thrown reports it.
+ */
+void MQIConnection::startConsuming() {
+  CPHTRACEENTRY(pTrc)
+  MQCTLO ctlo = {MQCTLO_DEFAULT};
+  if(pCallStats != NULL) pCallStats->record(CALL_MQCTL, 0, false);
+  CPHCALLMQ(pTrc, MQCTL, hConn, MQOP_START, &ctlo)
+  cphAtomicStore64(&consuming, 1);
+  CPHTRACEEXIT(pTrc)
+}
+
+/*
+ * Method: stopConsuming
+ * ---------------------
+ *
+ * Stop delivering messages to consumer callbacks, if startConsuming was called and they haven't already
+ * been stopped. This may be called from within a callback (taking effect when it returns), or from the
+ * thread that owns the connection, which waits for any callback in progress to complete.
+ *
+ * Returns: true if this call stopped the callbacks, false if they weren't running.
+ */
+bool MQIConnection::stopConsuming() {
+  CPHTRACEENTRY(pTrc)
+  bool stopped = cphAtomicCompareAndSwap64(&consuming, 1, 0);
+  if(stopped){
+    MQCTLO ctlo = {MQCTLO_DEFAULT};
+    CPHCALLMQSTATS(pCallStats, pTrc, MQCTL, hConn, MQOP_STOP, &ctlo)
+  }
+  CPHTRACEEXIT(pTrc)
+  return stopped;
+}
+
+/*
+ * Method: getAsyncStatus
+ * ----------------------
+ *
+ * Fill in the given MQSTS with the numbers of asynchronous puts made on this connection that have succeeded,
+ * completed with a warning, or failed since the last call, and the outcome of the first that didn't succeed.
+ */
+void MQIConnection::getAsyncStatus(MQSTS & sts) const {
+  CPHTRACEENTRY(pTrc)
+  MQSTS protoSTS = {MQSTS_DEFAULT};
+  sts = protoSTS;
+  CPHCALLMQSTATS(pCallStats, pTrc, MQSTAT, hConn, MQSTAT_TYPE_ASYNC_ERROR, &sts)
   CPHTRACEEXIT(pTrc)
 }
 
@@ -247,7 +380,7 @@ inline void freeMessage(MQIMessage* message){
  */
 MQIMessage::MQIMessage(size_t size) :
     buffer((MQBYTE*) malloc(size)),
-    bufferLen((MQLONG)size), messageLen(0) {
+    bufferLen((MQLONG)size), messageLen(0), pReceiveBuffer(NULL) {
   if(buffer==NULL)
     throw runtime_error("Could not allocate message buffer.");
 }
@@ -260,11 +393,14 @@ MQIMessage::MQIMessage(size_t size) :
  *
  * Input parameters:
  *    empty - If false, generates a message string (payload) and puts it in the buffer.
+ *            If true, the buffer is to receive messages, and is sized adaptively if pOpts say so (ra).
  *    pOpts - MQ messaging options. Used to determine message size and whether to generate an RFH2 header.
  */
-MQIMessage::MQIMessage(MQIOpts const * const pOpts, bool empty) {
+MQIMessage::MQIMessage(MQIOpts const * const pOpts, bool empty) : messageLen(0), pReceiveBuffer(NULL) {
   if(empty) {
     bufferLen = pOpts->receiveSize;
+    if(pOpts->adaptiveReceive)
+      pReceiveBuffer = new ReceiveBuffer(pOpts->receiveSize, pOpts->receivePercentile, pOpts->receiveToMaxMsgLength);
     if(NULL == (buffer = (MQBYTE*) malloc(bufferLen))) {
       throw runtime_error("Could not allocate message buffer.");
     } else {
@@ -306,8 +442,41 @@ void MQIMessage::resize(MQLONG newSize){
     messageLen = bufferLen;
 }
 
+/*
+ * Method: grow
+ * ------------
+ *
+ * Grow the buffer to receive a message of the given length from the given object, which didn't fit.
+ */
+void MQIMessage::grow(MQLONG needed, MQIObject const * const pObj){
+  if(pReceiveBuffer==NULL){
+    resize(needed);
+    return;
+  }
+  if(pReceiveBuffer->needsLimit())
+    pReceiveBuffer->setLimit(pObj->getMaxMsgLength());
+  resize(pReceiveBuffer->grow(bufferLen, needed));
+}
+
+/*
+ * Method: received
+ * ----------------
+ *
+ * Note that a message has been got into the buffer, which may shrink it.
+ *
+ * Returns: true if the buffer was shrunk.
+ */
+bool MQIMessage::received(){
+  if(pReceiveBuffer==NULL) return false;
+  MQLONG const size = pReceiveBuffer->received(bufferLen, messageLen);
+  if(size==bufferLen) return false;
+  resize(size);
+  return true;
+}
+
 MQIMessage::~MQIMessage(){
   freeMessage(this);
+  delete pReceiveBuffer;
 }
 
 /*
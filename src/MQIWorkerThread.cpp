@@ -46,18 +46,23 @@
 
 #include "cphMQSplitter.h"
 #include "cphUtil.h"
+#include "ReceiveBuffer.hpp"
 
 using namespace std;
 
 namespace cph {
 
 MQIOpts * MQIWorkerThread::pOpts;
+bool MQIWorkerThread::oneWayLatency = false;
+bool MQIWorkerThread::asyncConsume = false;
 
 MQIWorkerThread::MQIWorkerThread(ControlThread* pControlThread, string className, bool putter, bool getter, bool reconnector) :
     WorkerThread(pControlThread, className),
-    putter(putter), getter(getter), reconnector(reconnector), pConnection(NULL),
+    putter(putter), getter(getter), reconnector(reconnector),
+    stampSenderId(((MQINT64) cphUtilGetProcessId() << 32) | threadNum), stampSequence(0),
+    stampSequences(), stampGaps(0), stampReorders(0), warnedUnstamped(false), asyncPuts(0), nextAsyncStatus(0), pConnection(NULL),
     putMsgHandle(MQHM_NONE), putMessage(NULL),
-    getMsgHandle(MQHM_NONE), getMessage(NULL) {
+    getMsgHandle(MQHM_NONE), getMessage(NULL), pConsumer(NULL), callbackConsumer(false) {
   CPHTRACEENTRY(pConfig->pTrc)
 
   if(threadNum==0){
@@ -92,10 +97,42 @@ MQIWorkerThread::~MQIWorkerThread(){
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
+/*
+ * Function: copyMessage
+ * ---------------------
+ *
+ * Returns a copy of the given message in a buffer allocated (and first touched) by the calling thread,
+ * deleting the original.
+ */
+static MQIMessage * copyMessage(MQIMessage * const original){
+  MQIMessage * copy = new MQIMessage((size_t) original->bufferLen);
+  memcpy(copy->buffer, original->buffer, original->bufferLen);
+  copy->messageLen = original->messageLen;
+  copy->pReceiveBuffer = original->pReceiveBuffer;
+  original->pReceiveBuffer = NULL;
+  delete original;
+  return copy;
+}
+
+/*
+ * Method: allocateLocalBuffers
+ * ----------------------------
+ *
+ * Replace the put and get message buffers with copies allocated by this thread, so that they're on its NUMA node.
+ */
+void MQIWorkerThread::allocateLocalBuffers(){
+  CPHTRACEENTRY(pConfig->pTrc)
+  if(putMessage != NULL) putMessage = copyMessage(putMessage);
+  if(getMessage != NULL) getMessage = copyMessage(getMessage);
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
 void MQIWorkerThread::openSession(){
   CPHTRACEENTRY(pConfig->pTrc)
 
   pConnection = new MQIConnection(this, false);
+  asyncPuts = 0;
+  nextAsyncStatus = cphUtilGetMonotonicNs() + (MQINT64) pOpts->asyncStatusInterval * 1000000;
 
   if(getter && pOpts->useMessageHandle){
     getMsgHandle = pConnection->createGetMessageHandle();
@@ -129,6 +166,12 @@ void MQIWorkerThread::openSession(){
 void MQIWorkerThread::closeSession(){
   CPHTRACEENTRY(pConfig->pTrc)
 
+  // No other calls can be made on the connection while messages are being consumed by callback
+  pConnection->stopConsuming();
+
+  if(pOpts->asyncPut)
+    checkAsyncStatus(true);
+
   if(pOpts->commitFrequency>0)
     pConnection->rollbackTransaction();
 
@@ -140,13 +183,316 @@ void MQIWorkerThread::closeSession(){
   delete pConnection;
   pConnection = NULL;
 
+  if(getMessage != NULL && getMessage->pReceiveBuffer != NULL)
+    logReceiveBuffer();
+
+  if(stampGaps>0 || stampReorders>0){
+    char msgText[256];
+    snprintf(msgText, 256, "[%s] Timestamped messages so far: %llu gaps, %llu out of order, from %lu senders.", name.data(),
+        (unsigned long long) stampGaps, (unsigned long long) stampReorders, (unsigned long) stampSequences.size());
+    cphLogPrintLn(pConfig->pLog, LOG_VERBOSE, msgText);
+  }
+
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
+/*
+ * Method: logReceiveBuffer
+ * ------------------------
+ *
+ * Called as each session closes, when the receive buffer is sized adaptively (ra), to log (verbose) how
+ * often MQGET has been retried with a larger buffer, and the sizes of messages and buffer, to help choose rs.
+ */
+void MQIWorkerThread::logReceiveBuffer(){
+  ReceiveBuffer const * const pSizer = getMessage->pReceiveBuffer;
+  if(pSizer->getRetries()==0 && pSizer->getShrinks()==0) return;
+
+  char msgText[256];
+  snprintf(msgText, 256, "[%s] Receive buffer: %llu MQGET retries, %llu shrinks so far; p%u message size %ld bytes, buffer %ld bytes (rs=%ld).",
+      name.data(), (unsigned long long) pSizer->getRetries(), (unsigned long long) pSizer->getShrinks(),
+      pSizer->getPercentile(), (long) pSizer->getHighWater(), (long) getMessage->bufferLen, (long) pOpts->receiveSize);
+  cphLogPrintLn(pConfig->pLog, LOG_VERBOSE, msgText);
+}
+
 void MQIWorkerThread::oneIteration(){
   msgOneIteration();
   if(pOpts->commitFrequency>0 && (getIterations()+1)%pOpts->commitFrequency==0 && !reconnector)
     pConnection->commitTransaction();
+  if(pOpts->asyncPut)
+    checkAsyncStatus(false);
+}
+
+/*
+ * Method: checkAsyncStatus
+ * ------------------------
+ *
+ * Called after each iteration when putting asynchronously (ap), and before closing the session, to collect
+ * the outcomes of the puts with MQSTAT every apc puts or api milliseconds, whichever comes first (or now,
+ * if forced). Warnings and failures are counted in the call statistics (vs), and failures are logged.
+ */
+void MQIWorkerThread::checkAsyncStatus(bool force){
+  if(!force){
+    bool due = pOpts->asyncStatusCount>0 && ++asyncPuts>=pOpts->asyncStatusCount;
+    if(!due && pOpts->asyncStatusInterval>0)
+      due = cphUtilGetMonotonicNs() >= nextAsyncStatus;
+    if(!due) return;
+  }
+
+  MQSTS sts;
+  pConnection->getAsyncStatus(sts);
+  asyncPuts = 0;
+  if(pOpts->asyncStatusInterval>0)
+    nextAsyncStatus = cphUtilGetMonotonicNs() + (MQINT64) pOpts->asyncStatusInterval * 1000000;
+
+  if(pCallStats != NULL){
+    if(sts.PutWarningCount>0) pCallStats->count(EVENT_ASYNC_PUT_WARNING, (uint64_t) sts.PutWarningCount);
+    if(sts.PutFailureCount>0) pCallStats->count(EVENT_ASYNC_PUT_FAILURE, (uint64_t) sts.PutFailureCount);
+  }
+  if(sts.PutFailureCount>0){
+    char msgText[256];
+    snprintf(msgText, 256, "[%s] %d asynchronous puts failed; the first to %.48s with mqcc:%d, mqrc:%d.", name.data(),
+        (int) sts.PutFailureCount, sts.ObjectName, (int) sts.CompCode, (int) sts.Reason);
+    cphLogPrintLn(pConfig->pLog, LOG_WARNING, msgText);
+  }
+}
+
+/*
+ * Method: canRunPooled
+ * --------------------
+ *
+ * Inherited from class: WorkerThread
+ *
+ * A getter waits in MQGET for each message, which would hold up the other threads in a WorkerPool,
+ * so can only be pooled if it consumes its messages by callback instead.
+ */
+bool MQIWorkerThread::canRunPooled() const {
+  return !getter || callbackConsumer;
+}
+
+/*
+ * Method: startCallbacks
+ * ----------------------
+ *
+ * Inherited from class: WorkerThread
+ *
+ * If consuming messages by callback (ac), as getters always do in a WorkerPool, register consumerCallback
+ * for the messages of the current session (see prepareConsumer), and start the connection delivering them to it.
+ */
+bool MQIWorkerThread::startCallbacks(){
+  CPHTRACEENTRY(pConfig->pTrc)
+  if(!getter || !callbackConsumer || !(asyncConsume || isPooled())){
+    CPHTRACEEXIT(pConfig->pTrc)
+    return false;
+  }
+
+  MQMD md = pOpts->getGetMD();
+  MQGMO cbGmo = gmo;
+  pConsumer = prepareConsumer(md);
+  pConnection->registerConsumer(pConsumer, consumerCallback, this, md, cbGmo);
+  pConnection->startConsuming();
+  CPHTRACEEXIT(pConfig->pTrc)
+  return true;
+}
+
+/*
+ * Method: stopCallbacks
+ * ---------------------
+ *
+ * Inherited from class: WorkerThread
+ *
+ * Stop the connection delivering messages to consumerCallback, waiting for any call in progress to return.
+ */
+void MQIWorkerThread::stopCallbacks(){
+  if(pConnection != NULL)
+    pConnection->stopConsuming();
+}
+
+/*
+ * Method: consumeMessage
+ * ----------------------
+ *
+ * Called by consumerCallback with each message delivered, to do the work of an iteration with it.
+ * Unless overridden, records its one-way latency (if measured).
+ */
+void MQIWorkerThread::consumeMessage(MQMD & md, MQBYTE const * const buffer, MQLONG const length){
+  (void) md;
+  if(oneWayLatency) recordOneWayLatency(buffer, length);
+}
+
+/*
+ * Static Method: consumerCallback
+ * -------------------------------
+ *
+ * The MQCB message consumer registered by startCallbacks, called on a thread belonging to MQ. Each message
+ * delivered is an iteration of the MQIWorkerThread given as the CallbackArea; once the session has had all
+ * its iterations, or if the connection reports an error, the session is ended (see endCallbacks).
+ */
+void MQENTRY MQIWorkerThread::consumerCallback(MQHCONN hConn, PMQVOID pMsgDesc, PMQVOID pGetMsgOpts, PMQVOID pBuffer, PMQCBC pContext){
+  MQIWorkerThread * const pWorker = (MQIWorkerThread *) pContext->CallbackArea;
+  char errorString[128];
+  (void) hConn;
+  (void) pGetMsgOpts;
+
+  if(pContext->CompCode == MQCC_FAILED){
+    // As for MQGET, no message being available is expected once we've been asked to shut down
+    if(pContext->Reason == MQRC_NO_MSG_AVAILABLE && pWorker->shutdown)
+      return;
+    snprintf(errorString, 128, "Message consumer failed; mqcc:%d, mqrc:%d", (int) pContext->CompCode, (int) pContext->Reason);
+    pWorker->endCallbacks(errorString);
+    return;
+  }
+  if(pContext->CallType != MQCBCT_MSG_REMOVED && pContext->CallType != MQCBCT_MSG_NOT_REMOVED)
+    return;
+
+  try{
+    MQINT64 const start = cphUtilGetTimestampNs();
+    pWorker->consumeMessage(*(MQMD *) pMsgDesc, (MQBYTE const *) pBuffer, pContext->DataLength);
+    if(pOpts->commitFrequency>0 && (pWorker->getIterations()+1)%pOpts->commitFrequency==0)
+      pWorker->pConnection->commitTransaction();
+    if(pOpts->asyncPut)
+      pWorker->checkAsyncStatus(false);
+    if(pWorker->callbackIteration(start)) return;
+
+    // Take no more messages; the connection is stopped by the thread driving the session (see stopCallbacks)
+    pWorker->pConnection->suspendConsumer(pWorker->pConsumer);
+    pWorker->endCallbacks(NULL);
+  } catch (runtime_error &e) {
+    pWorker->endCallbacks(e.what());
+  }
+}
+
+/*
+ * Method: configureOneWayLatency
+ * ------------------------------
+ *
+ * Read the 'ow' option (if we're the first thread) and, if one-way latency is to be measured,
+ * prepare this thread to record it. Called from the constructors of implementations supporting
+ * the option.
+ */
+void MQIWorkerThread::configureOneWayLatency(){
+  CPHTRACEENTRY(pConfig->pTrc)
+  if(threadNum==0){
+    int temp;
+    if(CPHTRUE != cphConfigGetBoolean(pConfig, &temp, "ow"))
+      configError(pConfig, "(ow) Could not determine whether to measure one-way latency.");
+    oneWayLatency = temp==CPHTRUE;
+    CPHTRACEMSG(pConfig->pTrc, "Measure one-way latency: %s", oneWayLatency ? "yes" : "no")
+
+    if(oneWayLatency && putter && putMessage->messageLen < (MQLONG) sizeof(CPH_TRANSIT_STAMP)){
+      char errorString[128];
+      sprintf(errorString, "(ow) Messages must be at least %u bytes long to carry a timestamp.", (unsigned int) sizeof(CPH_TRANSIT_STAMP));
+      configError(pConfig, errorString);
+    }
+  }
+
+  if(oneWayLatency && getter)
+    enableLatencyStats(LATENCY_ONEWAY);
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+/*
+ * Method: configureCallbackConsumer
+ * ---------------------------------
+ *
+ * Read the 'ac' option (if we're the first thread), and mark this thread as able to consume its messages by
+ * callback, in a WorkerPool or if so configured. Called from the constructors of implementations supporting
+ * this, which must override prepareConsumer, and consumeMessage if they do more than record one-way latency.
+ */
+void MQIWorkerThread::configureCallbackConsumer(){
+  CPHTRACEENTRY(pConfig->pTrc)
+  if(threadNum==0){
+    int temp;
+    if(CPHTRUE != cphConfigGetBoolean(pConfig, &temp, "ac"))
+      configError(pConfig, "(ac) Could not determine whether to consume messages by callback.");
+    asyncConsume = temp==CPHTRUE;
+    CPHTRACEMSG(pConfig->pTrc, "Consume messages by callback: %s", asyncConsume ? "yes" : "no")
+  }
+  callbackConsumer = true;
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+/*
+ * Method: stampMessage
+ * --------------------
+ *
+ * Write a CPH_TRANSIT_STAMP, holding the current time and the next sequence number,
+ * over the end of the given message. Should be called immediately before putting it.
+ */
+void MQIWorkerThread::stampMessage(MQIMessage * const msg){
+  CPH_TRANSIT_STAMP stamp;
+  memcpy(stamp.StrucId, CPH_TRANSIT_STAMP_STRUC_ID, sizeof(stamp.StrucId));
+  stamp.Version = CPH_TRANSIT_STAMP_VERSION;
+  stamp.SenderId = stampSenderId;
+  stamp.SequenceNumber = ++stampSequence;
+  stamp.PutTime = cphUtilGetMonotonicNs();
+  memcpy(msg->buffer + msg->messageLen - sizeof(stamp), &stamp, sizeof(stamp));
+}
+
+/*
+ * Method: recordOneWayLatency
+ * ---------------------------
+ *
+ * Record the time since the given message was stamped by stampMessage, and check its sequence number
+ * (see checkStampSequence). Should be called immediately after getting it. Messages without a stamp
+ * (or truncated such that it is lost, or stamped by an incompatible version of cph) are ignored.
+ */
+void MQIWorkerThread::recordOneWayLatency(MQIMessage const * const msg){
+  recordOneWayLatency((MQBYTE const *) msg->buffer, msg->messageLen);
+}
+
+/*
+ * Method: recordOneWayLatency
+ * ---------------------------
+ *
+ * As above, for a message of the given length held in the given buffer.
+ */
+void MQIWorkerThread::recordOneWayLatency(MQBYTE const * const buffer, MQLONG const length){
+  MQINT64 now = cphUtilGetMonotonicNs();
+  CPH_TRANSIT_STAMP stamp;
+
+  if(length >= (MQLONG) sizeof(stamp)){
+    memcpy(&stamp, buffer + length - sizeof(stamp), sizeof(stamp));
+    if(0 == memcmp(stamp.StrucId, CPH_TRANSIT_STAMP_STRUC_ID, sizeof(stamp.StrucId))
+        && stamp.Version == CPH_TRANSIT_STAMP_VERSION){
+      recordLatency(LATENCY_ONEWAY, now > stamp.PutTime ? (uint64_t) (now - stamp.PutTime) / 1000 : 0);
+      checkStampSequence(stamp);
+      return;
+    }
+  }
+
+  if(!warnedUnstamped){
+    char msgText[256];
+    snprintf(msgText, 256, "[%s] Got a message without a timestamp; it will not be included in the one-way latency.", name.data());
+    cphLogPrintLn(pConfig->pLog, LOG_WARNING, msgText);
+    warnedUnstamped = true;
+  }
+}
+
+/*
+ * Method: checkStampSequence
+ * --------------------------
+ *
+ * Compare the sequence number of the given stamp with the highest got so far from the same sender,
+ * counting (as call statistics events, vs) a gap if any sequence numbers were skipped, or a reorder
+ * if it is no higher. The first message got from each sender only sets its starting point. Gaps
+ * are expected if other getters share the destination, or if a putter's messages are not all got.
+ */
+void MQIWorkerThread::checkStampSequence(CPH_TRANSIT_STAMP const &stamp){
+  std::pair<hashMap<MQINT64, MQINT64>::iterator, bool> const entry =
+      stampSequences.insert(std::make_pair(stamp.SenderId, stamp.SequenceNumber));
+  if(entry.second) return;
+
+  MQINT64 &highest = entry.first->second;
+  if(stamp.SequenceNumber <= highest){
+    stampReorders++;
+    if(pCallStats != NULL) pCallStats->count(EVENT_ONEWAY_REORDERED);
+  } else {
+    if(stamp.SequenceNumber > highest + 1){
+      stampGaps++;
+      if(pCallStats != NULL) pCallStats->count(EVENT_ONEWAY_GAP);
+    }
+    highest = stamp.SequenceNumber;
+  }
 }
 
 static inline uint32_t getCorrelIdBase(CPH_TRACE * pTrc){
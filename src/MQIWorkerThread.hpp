@@ -49,6 +49,29 @@ extern "C"{
 
 namespace cph {
 
+/*
+ * Struct: CPH_TRANSIT_STAMP
+ * -------------------------
+ *
+ * Written over the last bytes of each message put when measuring one-way latency (ow),
+ * so that it is found at the same place by the getter irrespective of any headers
+ * at the start of the message.
+ */
+typedef struct {
+  /*Eye-catcher, CPH_TRANSIT_STAMP_STRUC_ID*/
+  char StrucId[4];
+  MQLONG Version;
+  /*Identifies the putting thread: its process identifier (high 32 bits) and threadNum (low 32 bits)*/
+  MQINT64 SenderId;
+  /*Number of messages stamped by the putting thread, including this one*/
+  MQINT64 SequenceNumber;
+  /*Time of the put, as given by cphUtilGetMonotonicNs*/
+  MQINT64 PutTime;
+} CPH_TRANSIT_STAMP;
+
+#define CPH_TRANSIT_STAMP_STRUC_ID "CPHT"
+#define CPH_TRANSIT_STAMP_VERSION 2
+
 /*
  * Class: MQIWorkerThread
  * ---------------------
@@ -66,6 +89,23 @@ private:
   bool const getter;
   bool const reconnector;
 
+  /*The identifier and sequence number of the last CPH_TRANSIT_STAMP written by this thread.*/
+  MQINT64 const stampSenderId;
+  MQINT64 stampSequence;
+  /*The highest sequence number got from each sender, and the gaps and reorders seen in them so far.*/
+  hashMap<MQINT64, MQINT64> stampSequences;
+  uint64_t stampGaps, stampReorders;
+  /*Whether we've already warned about getting a message without a CPH_TRANSIT_STAMP.*/
+  bool warnedUnstamped;
+
+  /*The number of asynchronous puts (ap) since their status was last checked, and when (from cphUtilGetMonotonicNs) it's next due.*/
+  unsigned int asyncPuts;
+  MQINT64 nextAsyncStatus;
+
+  void checkAsyncStatus(bool force);
+  void logReceiveBuffer();
+  void checkStampSequence(CPH_TRANSIT_STAMP const &stamp);
+
 protected:
   /*Command line configuration options, and tools to create derived MQI data structures.*/
   static MQIOpts * pOpts;
@@ -99,16 +139,47 @@ protected:
   MQIMessage * getMessage;
   /*Get message options.*/
   MQGMO gmo;
+  /*The object messages are being consumed from by consumerCallback, if started (see startCallbacks).*/
+  MQIObject * pConsumer;
 
   /*The correlId to associate with messages.*/
   MQBYTE24 correlId;
 
+  /*Whether to stamp messages put, and record the one-way latency of messages got (ow).*/
+  static bool oneWayLatency;
+  /*Whether to consume messages by callback (ac), if the implementation can.*/
+  static bool asyncConsume;
+  /*Whether this implementation can consume messages by callback (see configureCallbackConsumer).*/
+  bool callbackConsumer;
+
+  void configureOneWayLatency();
+  void configureCallbackConsumer();
+  void stampMessage(MQIMessage * const msg);
+  void recordOneWayLatency(MQIMessage const * const msg);
+  void recordOneWayLatency(MQBYTE const * const buffer, MQLONG const length);
+
   void generateCorrelID(MQBYTE24 & genCorrelId, char const * const procId);
   void generateCorrelID(MQBYTE24 & genCorrelId, char const * const procId, std::string const * const classNameOverride);
 
   virtual void openSession();
   virtual void closeSession();
   virtual void oneIteration();
+  virtual void allocateLocalBuffers();
+  virtual bool startCallbacks();
+  virtual void stopCallbacks();
+
+  /*
+   * Method: prepareConsumer
+   * -----------------------
+   *
+   * Implementations that can consume messages by callback (see configureCallbackConsumer) override this to return
+   * the object to consume from in the current session, filling in the message descriptor to match them with.
+   */
+  virtual MQIObject * prepareConsumer(MQMD & md) { (void) md; return NULL; }
+
+  virtual void consumeMessage(MQMD & md, MQBYTE const * const buffer, MQLONG const length);
+
+  static void MQENTRY consumerCallback(MQHCONN hConn, PMQVOID pMsgDesc, PMQVOID pGetMsgOpts, PMQVOID pBuffer, PMQCBC pContext);
 
   /*
    * Abstract Method: openDestination
@@ -150,6 +221,7 @@ public:
 
   MQIWorkerThread(ControlThread* pControlThread, std::string className, bool putter, bool getter, bool reconnector);
   virtual ~MQIWorkerThread();
+  virtual bool canRunPooled() const;
 };
 
 #define MQWTCLASSDEF(CLASS, ...) \
@@ -0,0 +1,360 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#include "MetricsServer.hpp"
+#include "ControlThread.hpp"
+#include "WorkerThread.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef CPH_WINDOWS
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#endif
+
+/*How long (ms) the server waits for a connection before checking whether it should shut down.*/
+#define METRICS_POLL_INTERVAL 250
+/*How long (s) a client has to send its request.*/
+#define METRICS_REQUEST_TIMEOUT 2
+#define METRICS_MAX_REQUEST 8192
+/*Number of latency histogram bucket boundaries (le) given, the powers of two from 1us.*/
+#define METRICS_LATENCY_BOUNDS 27
+
+#ifdef MSG_NOSIGNAL
+#define METRICS_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define METRICS_SEND_FLAGS 0
+#endif
+
+namespace cph {
+
+/*The state value names used for the cph_thread_state stateset, and the state flags they represent.*/
+static char const * const stateNames[] = {"created", "opening", "open", "running", "closing", "error", "ended", "started"};
+static unsigned int const stateFlags[] = {S_CREATED, S_OPENING, S_OPEN, S_RUNNING, S_CLOSING, S_ERROR, S_ENDED, S_STARTED};
+#define STATE_COUNT (sizeof(stateFlags)/sizeof(stateFlags[0]))
+
+/*
+ * Function: escapeLabel
+ * ---------------------
+ *
+ * Returns the given string escaped for use as an OpenMetrics label value.
+ */
+static std::string escapeLabel(char const * value){
+  std::string escaped;
+  for(; *value != '\0'; value++){
+    if(*value == '\\') escaped += "\\\\";
+    else if(*value == '"') escaped += "\\\"";
+    else if(*value == '\n') escaped += "\\n";
+    else escaped += *value;
+  }
+  return escaped;
+}
+
+/*
+ * Constructor: MetricsServer
+ * --------------------------
+ *
+ * Start listening on the given address, which is either a port number (on the loopback interface),
+ * <IPv4 address>:<port>, or unix:<path> for a Unix domain socket (any existing file at that path is replaced).
+ */
+MetricsServer::MetricsServer(ControlThread * pControlThread, char const * address) :
+    Thread(pControlThread->pConfig),
+    pControlThread(pControlThread),
+    address(address),
+    listenFd(-1),
+    threadStats(),
+    threadCpu(),
+    latency(),
+    snapshot(),
+    calls() {
+  CPHTRACEENTRY(pConfig->pTrc)
+
+#ifdef CPH_WINDOWS
+  configError(pConfig, "(mp) The metrics endpoint is only supported on Unix.");
+#else
+  int rc = -1;
+  if(0 == strncmp(address, "unix:", 5)){
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if(strlen(address + 5) >= sizeof(addr.sun_path))
+      configError(pConfig, std::string("(mp) Metrics endpoint socket path is too long: ") + (address + 5));
+    strcpy(addr.sun_path, address + 5);
+    unlink(addr.sun_path);
+    if(0 <= (listenFd = socket(AF_UNIX, SOCK_STREAM, 0)))
+      rc = bind(listenFd, (struct sockaddr *) &addr, sizeof(addr));
+  } else {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    char const * port = strrchr(address, ':');
+    if(port == NULL)
+      port = address;
+    else {
+      std::string host(address, port - address);
+      port++;
+      if(1 != inet_pton(AF_INET, host.c_str(), &addr.sin_addr))
+        configError(pConfig, std::string("(mp) Invalid metrics endpoint address: ") + address);
+    }
+    char * end;
+    long portNum = strtol(port, &end, 10);
+    if(*port == '\0' || *end != '\0' || portNum < 0 || portNum > 65535)
+      configError(pConfig, std::string("(mp) Invalid metrics endpoint port: ") + address);
+    addr.sin_port = htons((unsigned short) portNum);
+
+    if(0 <= (listenFd = socket(AF_INET, SOCK_STREAM, 0))){
+      int reuse = 1;
+      setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+      rc = bind(listenFd, (struct sockaddr *) &addr, sizeof(addr));
+    }
+  }
+  if(rc == 0)
+    rc = listen(listenFd, 8);
+  if(rc != 0){
+    std::string msg = std::string("Could not listen for metrics requests on ") + address + ": " + strerror(errno);
+    if(listenFd >= 0) close(listenFd);
+    listenFd = -1;
+    throw std::runtime_error(msg);
+  }
+#endif
+
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+MetricsServer::~MetricsServer(){
+#ifndef CPH_WINDOWS
+  if(listenFd >= 0){
+    close(listenFd);
+    if(0 == address.compare(0, 5, "unix:"))
+      unlink(address.c_str() + 5);
+  }
+#endif
+}
+
+void MetricsServer::run(){
+  CPHTRACEENTRY(pConfig->pTrc)
+#ifndef CPH_WINDOWS
+  struct pollfd pfd;
+  pfd.fd = listenFd;
+  pfd.events = POLLIN;
+
+  while(!shutdown){
+    pfd.revents = 0;
+    if(poll(&pfd, 1, METRICS_POLL_INTERVAL) <= 0 || (pfd.revents & POLLIN) == 0)
+      continue;
+    int fd = accept(listenFd, NULL, NULL);
+    if(fd < 0) continue;
+    handle(fd);
+    close(fd);
+  }
+#endif
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+/*
+ * Method: handle
+ * --------------
+ *
+ * Read an HTTP request from the given connection, and answer it. GET or HEAD requests
+ * for / or /metrics are given the current metrics; anything else is an error.
+ */
+void MetricsServer::handle(int fd){
+#ifndef CPH_WINDOWS
+  struct timeval timeout;
+  timeout.tv_sec = METRICS_REQUEST_TIMEOUT;
+  timeout.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+  char request[METRICS_MAX_REQUEST];
+  size_t length = 0;
+  while(length < sizeof(request) - 1){
+    ssize_t n = recv(fd, request + length, sizeof(request) - 1 - length, 0);
+    if(n <= 0) break;
+    length += n;
+    request[length] = '\0';
+    if(NULL != strstr(request, "\r\n\r\n") || NULL != strstr(request, "\n\n")) break;
+  }
+  request[length] = '\0';
+
+  char const * status = "200 OK";
+  char const * contentType = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+  std::string body;
+  bool head = 0 == strncmp(request, "HEAD ", 5);
+  char const * path = head ? request + 5 : 0 == strncmp(request, "GET ", 4) ? request + 4 : NULL;
+  size_t pathLength = path == NULL ? 0 : strcspn(path, " ?\r\n");
+
+  if(path == NULL){
+    status = "405 Method Not Allowed";
+    contentType = "text/plain";
+    body = "Only GET and HEAD are supported.\n";
+  } else if((pathLength == 1 && *path == '/') || (pathLength == 8 && 0 == strncmp(path, "/metrics", 8))){
+    body = format();
+  } else {
+    status = "404 Not Found";
+    contentType = "text/plain";
+    body = "Metrics are served at /metrics.\n";
+  }
+
+  std::stringstream ss;
+  ss << "HTTP/1.0 " << status << "\r\nContent-Type: " << contentType
+     << "\r\nContent-Length: " << body.size() << "\r\nConnection: close\r\n\r\n";
+  if(!head) ss << body;
+
+  std::string response = ss.str();
+  char const * data = response.data();
+  size_t remaining = response.size();
+  while(remaining > 0){
+    ssize_t n = send(fd, data, remaining, METRICS_SEND_FLAGS);
+    if(n <= 0) break;
+    data += n;
+    remaining -= n;
+  }
+#else
+  (void) fd;
+#endif
+}
+
+/*
+ * Method: format
+ * --------------
+ *
+ * Take a snapshot of the statistics of every worker thread, and return them as an OpenMetrics exposition.
+ *
+ * Thread states and iteration counts are given per thread; latency histograms and MQI call statistics
+ * are totals across all threads. The latency histograms always give the same coarse bucket boundaries (le),
+ * the powers of two from 1us to 2^26us (~67s) in seconds, followed by +Inf, so that series stay the same from
+ * one scrape to the next. Each count is of the Histogram buckets wholly at or below the boundary, so values
+ * within the Histogram's resolution (~1.6%) above a power of two are counted under the next boundary.
+ */
+std::string MetricsServer::format(){
+  CPHTRACEENTRY(pConfig->pTrc)
+  std::stringstream ss;
+  size_t i;
+  unsigned int j;
+  ss.precision(15);
+
+  unsigned int running = pControlThread->getThreadStats(threadStats);
+  unsigned int failed = 0;
+  for(i = 0; i < threadStats.size(); i++)
+    if(threadStats[i].state & S_ERROR) failed++;
+
+  if(0 < strlen(pControlThread->procId))
+    ss << "# TYPE cph info\n# HELP cph The cph process identifier (id).\n"
+       << "cph_info{id=\"" << escapeLabel(pControlThread->procId) << "\"} 1\n";
+
+  ss << "# TYPE cph_running_threads gauge\n# HELP cph_running_threads Number of worker threads running.\n"
+     << "cph_running_threads " << running << "\n";
+  ss << "# TYPE cph_failed_threads gauge\n# HELP cph_failed_threads Number of worker threads stopped by an error.\n"
+     << "cph_failed_threads " << failed << "\n";
+
+  ss << "# TYPE cph_thread_state stateset\n# HELP cph_thread_state The state of each worker thread.\n";
+  for(i = 0; i < threadStats.size(); i++){
+    std::string thread = escapeLabel(threadStats[i].name);
+    for(j = 0; j < STATE_COUNT; j++)
+      ss << "cph_thread_state{thread=\"" << thread << "\",cph_thread_state=\"" << stateNames[j] << "\"} "
+         << ((threadStats[i].state & stateFlags[j]) ? 1 : 0) << "\n";
+  }
+
+  ss << "# TYPE cph_iterations counter\n# HELP cph_iterations Iterations completed by each worker thread.\n";
+  for(i = 0; i < threadStats.size(); i++)
+    ss << "cph_iterations_total{thread=\"" << escapeLabel(threadStats[i].name) << "\"} " << threadStats[i].iterations << "\n";
+
+  if(pControlThread->isCollectingCpuStats()){
+    pControlThread->getThreadCpuTimes(threadCpu);
+    ss << "# TYPE cph_cpu_seconds counter\n# UNIT cph_cpu_seconds seconds\n"
+       << "# HELP cph_cpu_seconds CPU time used by each worker thread, in user and system mode.\n";
+    for(i = 0; i < threadCpu.size() && i < threadStats.size(); i++){
+      std::string thread = escapeLabel(threadStats[i].name);
+      ss << "cph_cpu_seconds_total{thread=\"" << thread << "\",mode=\"user\"} " << threadCpu[i].user / 1e9 << "\n"
+         << "cph_cpu_seconds_total{thread=\"" << thread << "\",mode=\"system\"} " << threadCpu[i].system / 1e9 << "\n";
+    }
+  }
+
+  bool headerWritten = false;
+  for(int type = 0; type < LATENCY_TYPES; type++){
+    if(!pControlThread->isCollectingLatencyStats((LatencyType) type)) continue;
+    pControlThread->getTotalLatencyStats(latency, snapshot, (LatencyType) type);
+
+    if(!headerWritten){
+      ss << "# TYPE cph_latency_seconds histogram\n# UNIT cph_latency_seconds seconds\n"
+         << "# HELP cph_latency_seconds Latency of all worker threads (iteration, oneway or corrected - see ls and ow).\n";
+      headerWritten = true;
+    }
+    std::string prefix(latencyPrefixes[type]);
+    std::string label = prefix.empty() ? "iteration" : prefix.substr(0, prefix.size() - 1);
+
+    uint64_t cumulative = 0;
+    unsigned int bucket = 0;
+    for(j = 0; j < METRICS_LATENCY_BOUNDS; j++){
+      uint64_t bound = (uint64_t) 1 << j;
+      for(; bucket < Histogram::BUCKET_COUNT && Histogram::getBucketHighestValue(bucket) <= bound; bucket++)
+        cumulative += latency.getCount(bucket);
+      ss << "cph_latency_seconds_bucket{type=\"" << label << "\",le=\"" << bound / 1e6
+         << "\"} " << cumulative << "\n";
+    }
+    ss << "cph_latency_seconds_bucket{type=\"" << label << "\",le=\"+Inf\"} " << latency.getTotalCount() << "\n"
+       << "cph_latency_seconds_count{type=\"" << label << "\"} " << latency.getTotalCount() << "\n"
+       << "cph_latency_seconds_sum{type=\"" << label << "\"} " << latency.getTotalValue() / 1e6 << "\n";
+  }
+
+  if(pControlThread->isCollectingCallStats()){
+    pControlThread->getTotalCallStats(calls);
+
+    ss << "# TYPE cph_mqi_calls counter\n# HELP cph_mqi_calls MQI calls made by all worker threads.\n";
+    for(j = 0; j < CALL_TYPES; j++)
+      ss << "cph_mqi_calls_total{call=\"" << CallStats::callNames[j] << "\"} " << calls.getCalls((CallType) j) << "\n";
+    ss << "# TYPE cph_mqi_call_failures counter\n# HELP cph_mqi_call_failures MQI calls that failed.\n";
+    for(j = 0; j < CALL_TYPES; j++)
+      ss << "cph_mqi_call_failures_total{call=\"" << CallStats::callNames[j] << "\"} " << calls.getFailures((CallType) j) << "\n";
+    ss << "# TYPE cph_mqi_call_seconds counter\n# UNIT cph_mqi_call_seconds seconds\n"
+       << "# HELP cph_mqi_call_seconds Total time spent in MQI calls.\n";
+    for(j = 0; j < CALL_TYPES; j++)
+      ss << "cph_mqi_call_seconds_total{call=\"" << CallStats::callNames[j] << "\"} " << calls.getTotalTime((CallType) j) / 1e9 << "\n";
+    ss << "# TYPE cph_mqi_call_max_seconds gauge\n# UNIT cph_mqi_call_max_seconds seconds\n"
+       << "# HELP cph_mqi_call_max_seconds Longest single MQI call.\n";
+    for(j = 0; j < CALL_TYPES; j++)
+      ss << "cph_mqi_call_max_seconds{call=\"" << CallStats::callNames[j] << "\"} " << calls.getMaxTime((CallType) j) / 1e9 << "\n";
+    ss << "# TYPE cph_mqi_events counter\n# HELP cph_mqi_events Counts of notable MQI and workload events (see CallStats::eventNames).\n";
+    for(j = 0; j < EVENT_TYPES; j++)
+      ss << "cph_mqi_events_total{event=\"" << CallStats::eventNames[j] << "\"} " << calls.getEvents((CallEvent) j) << "\n";
+  }
+
+  ss << "# EOF\n";
+  CPHTRACEEXIT(pConfig->pTrc)
+  return ss.str();
+}
+
+}
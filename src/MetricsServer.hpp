@@ -0,0 +1,84 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#ifndef METRICSSERVER_HPP_
+#define METRICSSERVER_HPP_
+
+#include <string>
+#include <vector>
+
+#include "Thread.hpp"
+#include "Histogram.hpp"
+#include "CallStats.hpp"
+#include "WorkerCounters.hpp"
+
+namespace cph {
+class ControlThread;
+
+/*
+ * Class: MetricsServer
+ * --------------------
+ *
+ * Extends: Thread
+ *
+ * Serves the current worker thread states and counters, MQI call statistics and latency
+ * histograms in OpenMetrics text format to HTTP requests on a local TCP port or Unix socket,
+ * so that they can be collected by a scraper (e.g. Prometheus) during a run.
+ *
+ * Each request is answered by this thread from snapshots taken as for the StatsThread,
+ * so a scrape never takes a lock shared with, or blocks, the worker threads.
+ */
+class MetricsServer : public Thread {
+public:
+  MetricsServer(ControlThread * pControlThread, char const * address);
+  virtual ~MetricsServer();
+
+protected:
+  virtual void run();
+
+private:
+  ControlThread * const pControlThread;
+  std::string const address;
+  int listenFd;
+
+  /*Snapshots reused between scrapes.*/
+  std::vector<WorkerCountersSnapshot> threadStats;
+  std::vector<CpuTime> threadCpu;
+  Histogram latency;
+  Histogram snapshot;
+  CallStats calls;
+
+  void handle(int fd);
+  std::string format();
+
+  MetricsServer(MetricsServer const &);
+  MetricsServer & operator=(MetricsServer const &);
+};
+
+}
+
+#endif /* METRICSSERVER_HPP_ */
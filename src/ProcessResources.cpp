@@ -0,0 +1,153 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#include "ProcessResources.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(WIN32) || defined(WIN64)
+#include <Windows.h>
+#include <psapi.h>
+#include "msint.h"
+#pragma comment(lib, "psapi.lib")
+#else
+#include <inttypes.h>
+#include <dirent.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
+namespace cph {
+
+ProcessResources::ProcessResources() :
+    rss(0), peakRss(0), virtualSize(0), openFiles(0), threads(0),
+    voluntarySwitches(0), involuntarySwitches(0), minorFaults(0), majorFaults(0) {
+}
+
+#if !defined(WIN32) && !defined(WIN64)
+/*
+ * Function: countFiles
+ * --------------------
+ *
+ * Returns the number of open file descriptors listed in the given directory (/proc/self/fd or /dev/fd),
+ * not counting the one used to read it, or 0 if it can't be read.
+ */
+static uint64_t countFiles(char const * path){
+  uint64_t count = 0;
+  DIR * dir = opendir(path);
+  if(dir == NULL) return 0;
+  int const self = dirfd(dir);
+  struct dirent * entry;
+  while(NULL != (entry = readdir(dir)))
+    if(entry->d_name[0] != '.' && atoi(entry->d_name) != self) count++;
+  closedir(dir);
+  return count;
+}
+#endif
+
+/*
+ * Method: sample
+ * --------------
+ *
+ * Replace the values with the current resource usage of this process, from getrusage and
+ * (on Linux) /proc/self/status and /proc/self/fd, or the process memory counters on Windows.
+ *
+ * Returns: true if the values could be found, false otherwise.
+ */
+bool ProcessResources::sample(){
+  *this = ProcessResources();
+#if defined(WIN32) || defined(WIN64)
+  PROCESS_MEMORY_COUNTERS counters;
+  if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return false;
+  rss = counters.WorkingSetSize / 1024;
+  peakRss = counters.PeakWorkingSetSize / 1024;
+  virtualSize = counters.PagefileUsage / 1024;
+  minorFaults = counters.PageFaultCount;
+  DWORD handles;
+  if(GetProcessHandleCount(GetCurrentProcess(), &handles)) openFiles = handles;
+  return true;
+#else
+  struct rusage usage;
+  if(0 != getrusage(RUSAGE_SELF, &usage)) return false;
+  voluntarySwitches = usage.ru_nvcsw;
+  involuntarySwitches = usage.ru_nivcsw;
+  minorFaults = usage.ru_minflt;
+  majorFaults = usage.ru_majflt;
+#if defined(CPH_OSX)
+  peakRss = usage.ru_maxrss / 1024;
+  openFiles = countFiles("/dev/fd");
+#else
+  peakRss = usage.ru_maxrss;
+  openFiles = countFiles("/proc/self/fd");
+#endif
+
+  FILE * fp = fopen("/proc/self/status", "r");
+  if(fp != NULL){
+    char line[256];
+    while(NULL != fgets(line, sizeof(line), fp)){
+      if(0 == strncmp(line, "VmRSS:", 6)) rss = strtoull(line + 6, NULL, 10);
+      else if(0 == strncmp(line, "VmHWM:", 6)) peakRss = strtoull(line + 6, NULL, 10);
+      else if(0 == strncmp(line, "VmSize:", 7)) virtualSize = strtoull(line + 7, NULL, 10);
+      else if(0 == strncmp(line, "Threads:", 8)) threads = strtoull(line + 8, NULL, 10);
+    }
+    fclose(fp);
+  }
+  return true;
+#endif
+}
+
+/*
+ * Method: subtract
+ * ----------------
+ *
+ * Remove the context switches and page faults counted by an earlier sample from this one,
+ * leaving those in between. The memory, file and thread values are left as sampled.
+ */
+void ProcessResources::subtract(ProcessResources const &other){
+  voluntarySwitches = voluntarySwitches >= other.voluntarySwitches ? voluntarySwitches - other.voluntarySwitches : 0;
+  involuntarySwitches = involuntarySwitches >= other.involuntarySwitches ? involuntarySwitches - other.involuntarySwitches : 0;
+  minorFaults = minorFaults >= other.minorFaults ? minorFaults - other.minorFaults : 0;
+  majorFaults = majorFaults >= other.majorFaults ? majorFaults - other.majorFaults : 0;
+}
+
+/*
+ * Method: append
+ * --------------
+ *
+ * Append these values to a statistics line.
+ */
+void ProcessResources::append(std::stringstream &ss) const {
+  char buff[512];
+  sprintf(buff, "rss(KB)=%" PRIu64 ",peak_rss(KB)=%" PRIu64 ",vsz(KB)=%" PRIu64 ",fds=%" PRIu64 ",os_threads=%" PRIu64
+      ",vol_cs=%" PRIu64 ",invol_cs=%" PRIu64 ",minor_faults=%" PRIu64 ",major_faults=%" PRIu64,
+      rss, peakRss, virtualSize, openFiles, threads,
+      voluntarySwitches, involuntarySwitches, minorFaults, majorFaults);
+  ss << buff;
+}
+
+}
@@ -0,0 +1,67 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#ifndef PROCESSRESOURCES_HPP_
+#define PROCESSRESOURCES_HPP_
+
+#include <sstream>
+#include "cphAtomic.h"
+
+namespace cph {
+
+/*
+ * Struct: ProcessResources
+ * ------------------------
+ *
+ * A sample of the operating system resources used by the whole cph process.
+ * Values the platform doesn't provide are left at zero.
+ */
+struct ProcessResources {
+  /*Resident set size now, and at its peak (KB).*/
+  uint64_t rss;
+  uint64_t peakRss;
+  /*Virtual memory size (KB).*/
+  uint64_t virtualSize;
+  /*Open file descriptors (handles on Windows).*/
+  uint64_t openFiles;
+  /*Operating system threads.*/
+  uint64_t threads;
+  /*Context switches and page faults since the process started.*/
+  uint64_t voluntarySwitches;
+  uint64_t involuntarySwitches;
+  uint64_t minorFaults;
+  uint64_t majorFaults;
+
+  ProcessResources();
+  bool sample();
+  void subtract(ProcessResources const &other);
+  void append(std::stringstream &ss) const;
+};
+
+}
+
+#endif /* PROCESSRESOURCES_HPP_ */
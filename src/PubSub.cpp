@@ -36,8 +36,10 @@ using namespace std;
 namespace cph {
 
 bool Publisher::topicPerMsg;
+unsigned int Publisher::topicCacheSize;
 
-MQWTCONSTRUCTOR(Publisher, true, false, false), pDestFactory(pControlThread->pDestinationFactory) {
+MQWTCONSTRUCTOR(Publisher, true, false, false), pDestFactory(pControlThread->pDestinationFactory),
+    pTopic(NULL), cacheBase(0) {
   CPHTRACEENTRY(pConfig->pTrc)
   if(threadNum==0){
 
@@ -46,7 +48,15 @@ MQWTCONSTRUCTOR(Publisher, true, false, false), pDestFactory(pControlThread->pDe
       configError(pConfig, "(tp) Could not determine whether to use one topic per publisher.");
     topicPerMsg = temp!=CPHTRUE;
     CPHTRACEMSG(pConfig->pTrc, (char*) "Publish to a new topic every iteration: %s", topicPerMsg ? "yes" : "no")
+
+    if(CPHTRUE != cphConfigGetInt(pConfig, &temp, (char*) "tk"))
+      configError(pConfig, "(tk) Could not determine the number of topics to keep open.");
+    if(temp<0)
+      configError(pConfig, "(tk) The number of topics to keep open cannot be negative.");
+    topicCacheSize = temp;
+    CPHTRACEMSG(pConfig->pTrc, (char*) "Topics kept open: %u", topicCacheSize)
   }
+  configureOneWayLatency();
   CPHTRACEEXIT(pConfig->pTrc)
 }
 Publisher::~Publisher(){}
@@ -57,26 +67,71 @@ void Publisher::openDestination(){
     pTopic = new MQITopic(pConnection);
     CPH_DESTINATIONFACTORY_CALL_PRINTF(pTopic->setName, pOpts->destinationPrefix, destinationIndex)
     pTopic->open(true);
+  } else {
+    /*
+     * Topics are opened as first published to, and the first tk of the destination range are kept open.
+     * Iterations cycle through the range, so keeping a fixed part of it open does as well as any
+     * replacement policy could, without the open and close every iteration that replacing would cost.
+     */
+    unsigned int range = 1;
+    cacheBase = -1;
+    if(pDestFactory->mode == CPH_DESTINATIONFACTORY_MODE_DIST){
+      range = pDestFactory->destNumber;
+      cacheBase = pDestFactory->destBase;
+    }
+    topicCache.assign(range<topicCacheSize ? range : topicCacheSize, (MQITopic *) NULL);
   }
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
 void Publisher::closeDestination(){
   CPHTRACEENTRY(pConfig->pTrc)
+  for(vector<MQITopic *>::iterator it = topicCache.begin(); it != topicCache.end(); ++it)
+    delete *it;
+  topicCache.clear();
   delete pTopic;
   pTopic = NULL;
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
+/*
+ * Method: cachedTopic
+ * -------------------
+ *
+ * Get the open topic for the current destinationIndex from topicCache, opening it if this is
+ * its first use. Returns NULL if the index is outside the part of the range that is kept open.
+ */
+MQITopic * Publisher::cachedTopic(){
+  unsigned int const slot = (unsigned int) (destinationIndex - cacheBase);
+  if(slot >= topicCache.size()) return NULL;
+
+  MQITopic * pCached = topicCache[slot];
+  if(pCached==NULL){
+    pCached = new MQITopic(pConnection);
+    CPH_DESTINATIONFACTORY_CALL_PRINTF(pCached->setName, pOpts->destinationPrefix, destinationIndex)
+    try {
+      pCached->open(false);
+    } catch (...) {
+      delete pCached;
+      throw;
+    }
+    topicCache[slot] = pCached;
+  }
+  return pCached;
+}
+
 void Publisher::msgOneIteration(){
   CPHTRACEENTRY(pConfig->pTrc)
-  if(topicPerMsg){
+  MQITopic * pPublishTo = pTopic;
+  if(topicPerMsg && (pPublishTo = cachedTopic())==NULL){
     pTopic = new MQITopic(pConnection);
     CPH_DESTINATIONFACTORY_CALL_PRINTF(pTopic->setName, pOpts->destinationPrefix, destinationIndex)
     pTopic->open(false);
+    pPublishTo = pTopic;
   }
 
-  pTopic->put(putMessage, putMD, pmo);
+  if(oneWayLatency) stampMessage(putMessage);
+  pPublishTo->put(putMessage, putMD, pmo);
 
   if(topicPerMsg){
     delete pTopic;
@@ -112,6 +167,9 @@ MQWTCONSTRUCTOR(Subscriber, false, true, false) {
   if(durable)
     sprintf(subName, "%s_%s", pControlThread->procId, name.data());
 
+  configureOneWayLatency();
+  configureCallbackConsumer();
+
   CPHTRACEEXIT(pConfig->pTrc)
 }
 Subscriber::~Subscriber(){}
@@ -137,7 +195,20 @@ void Subscriber::msgOneIteration(){
   CPHTRACEENTRY(pConfig->pTrc)
   MQMD md = {MQMD_DEFAULT};
   pSubscription->get(getMessage, md, gmo);
+  if(oneWayLatency) recordOneWayLatency(getMessage);
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
+/*
+ * Method: prepareConsumer
+ * -----------------------
+ *
+ * Messages consumed by callback are those delivered to the subscription, as got by msgOneIteration.
+ */
+MQIObject * Subscriber::prepareConsumer(MQMD & md){
+  MQMD protoMD = {MQMD_DEFAULT};
+  md = protoMD;
+  return pSubscription;
+}
+
 }
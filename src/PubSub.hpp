@@ -31,14 +31,21 @@
 
 #include "MQIWorkerThread.hpp"
 #include "cphDestinationFactory.h"
+#include <vector>
 
 namespace cph {
 
 MQWTCLASSDEF(Publisher,
   static bool topicPerMsg;
+  static unsigned int topicCacheSize;
   CPH_DESTINATIONFACTORY * const pDestFactory;
 
   MQITopic * pTopic;
+  /*Topics kept open between iterations (tp=false), by destination index from cacheBase; NULL until first used.*/
+  std::vector<MQITopic *> topicCache;
+  int cacheBase;
+
+  MQITopic * cachedTopic();
 )
 
 MQWTCLASSDEF(Subscriber,
@@ -47,6 +54,8 @@ MQWTCLASSDEF(Subscriber,
 
   char subName[MQ_SUB_IDENTITY_LENGTH];
   MQISubscription * pSubscription;
+
+  virtual MQIObject * prepareConsumer(MQMD & md);
 )
 
 }
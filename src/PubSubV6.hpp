@@ -32,18 +32,25 @@
 #include "MQIWorkerThread.hpp"
 #include "cphDestinationFactory.h"
 #include <cmqpsc.h>   /* WMQ V6 MQI Publish/Subscribe */
+#include <vector>
 
 namespace cph {
 
 MQWTCLASSDEF(PublisherV6,
   static bool topicPerMsg;
   static char streamQName[MQ_Q_NAME_LENGTH];
+  static unsigned int headerCacheSize;
   CPH_DESTINATIONFACTORY * const pDestFactory;
 
   MQIQueue * pStreamQueue;
   MQLONG headerLen;
+  /*Prebuilt RFH headers (tp=false) of headerLen bytes each, by destination index from cacheBase, and which have been built.*/
+  std::vector<MQBYTE> headerCache;
+  std::vector<bool> headerCached;
+  int cacheBase;
 
   inline void buildMQRFHeader(PMQRFH pStart, PMQLONG pDataLength);
+  void setHeader();
 )
 
 MQWTCLASSDEF(SubscriberV6,
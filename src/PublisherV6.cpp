@@ -41,10 +41,11 @@ namespace cph {
 
 bool PublisherV6::topicPerMsg;
 char PublisherV6::streamQName[MQ_Q_NAME_LENGTH];
+unsigned int PublisherV6::headerCacheSize;
 
 MQWTCONSTRUCTOR(PublisherV6, true, false, false),
     pDestFactory(pControlThread->pDestinationFactory),
-    headerLen(CPH_PUBLISHERV6_INITIAL_BUFFER_LENGTH) {
+    pStreamQueue(NULL), headerLen(CPH_PUBLISHERV6_INITIAL_BUFFER_LENGTH), cacheBase(0) {
   CPHTRACEENTRY(pConfig->pTrc)
 
   if(threadNum==0){
@@ -64,6 +65,13 @@ MQWTCONSTRUCTOR(PublisherV6, true, false, false),
       configError(pConfig, "(tp) Could not determine whether to use one topic per publisher.");
     topicPerMsg = temp!=CPHTRUE;
     CPHTRACEMSG(pConfig->pTrc, "Publish to a new topic every iteration: %s", topicPerMsg ? "yes" : "no")
+
+    if(CPHTRUE != cphConfigGetInt(pConfig, &temp, "tk"))
+      configError(pConfig, "(tk) Could not determine the number of topic headers to keep.");
+    if(temp<0)
+      configError(pConfig, "(tk) The number of topic headers to keep cannot be negative.");
+    headerCacheSize = temp;
+    CPHTRACEMSG(pConfig->pTrc, "Topic headers kept: %u", headerCacheSize)
   }
 
   /*
@@ -85,6 +93,18 @@ MQWTCONSTRUCTOR(PublisherV6, true, false, false),
   strcpy((char*) putMessage->buffer + headerLen, (char*) buffer);
   putMessage->messageLen = putMessage->bufferLen;
 
+  if(topicPerMsg){
+    unsigned int range = 1;
+    cacheBase = -1;
+    if(pDestFactory->mode == CPH_DESTINATIONFACTORY_MODE_DIST){
+      range = pDestFactory->destNumber;
+      cacheBase = pDestFactory->destBase;
+    }
+    if(range>headerCacheSize) range = headerCacheSize;
+    headerCache.resize((size_t) range * headerLen);
+    headerCached.assign(range, false);
+  }
+
   CPHTRACEEXIT(pConfig->pTrc)
 }
 PublisherV6::~PublisherV6(){}
@@ -203,6 +223,33 @@ inline void PublisherV6::buildMQRFHeader(PMQRFH pRFHeader, PMQLONG pDataLength){
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
+/*
+ * Method: setHeader
+ * -----------------
+ *
+ * Put the RFH header for the current destinationIndex at the start of the message buffer,
+ * copying it from headerCache if it has been built before. The first tk indexes of the
+ * destination range are kept, as iterations cycle through the range.
+ */
+void PublisherV6::setHeader(){
+  unsigned int const slot = (unsigned int) (destinationIndex - cacheBase);
+  bool const cacheable = slot < headerCached.size();
+  if(cacheable && headerCached[slot]){
+    memcpy(putMessage->buffer, &headerCache[(size_t) slot * headerLen], headerLen);
+    return;
+  }
+
+  MQLONG newHeaderLen = headerLen;
+  buildMQRFHeader((PMQRFH)putMessage->buffer, &newHeaderLen);
+  if(newHeaderLen!=headerLen)
+    throw runtime_error("Length of new RFH header does not match space originally allocated.");
+
+  if(cacheable){
+    memcpy(&headerCache[(size_t) slot * headerLen], putMessage->buffer, headerLen);
+    headerCached[slot] = true;
+  }
+}
+
 void PublisherV6::openDestination(){
   CPHTRACEENTRY(pConfig->pTrc)
 
@@ -223,12 +270,7 @@ void PublisherV6::closeDestination(){
 
 void PublisherV6::msgOneIteration(){
   CPHTRACEENTRY(pConfig->pTrc)
-  if(topicPerMsg){
-    MQLONG newHeaderLen = headerLen;
-    buildMQRFHeader((PMQRFH)putMessage->buffer, &newHeaderLen);
-    if(newHeaderLen!=headerLen)
-      throw runtime_error("Length of new RFH header does not match space originally allocated.");
-  }
+  if(topicPerMsg) setHeader();
 
   pStreamQueue->put(putMessage, putMD, pmo);
 
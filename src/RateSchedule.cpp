@@ -0,0 +1,272 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#include "RateSchedule.hpp"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/*The longest line accepted in a schedule file.*/
+#define MAX_SCHEDULE_LINE 256
+
+namespace cph {
+
+RateSchedule::RateSchedule() : segments() {}
+
+/*
+ * Method: load
+ * ------------
+ *
+ * Append the segments read from the given file to the schedule.
+ *
+ * Throws: std::runtime_error if the file can't be read, or a line isn't a valid segment.
+ */
+void RateSchedule::load(char const * fileName){
+  FILE * fp = fopen(fileName, "r");
+  if(fp == NULL)
+    throw std::runtime_error(std::string("Could not open rate schedule file: ") + fileName);
+
+  char line[MAX_SCHEDULE_LINE];
+  unsigned int lineNumber = 0;
+  try {
+    while(fgets(line, sizeof(line), fp) != NULL){
+      lineNumber++;
+      char type[16];
+      double values[4];
+      int fields = sscanf(line, " %15s %lf %lf %lf %lf", type, &values[0], &values[1], &values[2], &values[3]);
+      if(fields <= 0 || type[0] == '#') continue;
+
+      if(0 == strcmp(type, "constant") && fields == 3)
+        addConstant(values[0], values[1]);
+      else if(0 == strcmp(type, "ramp") && fields == 4)
+        addRamp(values[0], values[1], values[2]);
+      else if(0 == strcmp(type, "pause") && fields == 2)
+        addConstant(values[0], 0);
+      else if(0 == strcmp(type, "burst") && fields == 3)
+        addBurst(values[0], values[1]);
+      else if(0 == strcmp(type, "sine") && fields == 5)
+        addSine(values[0], values[1], values[2], values[3]);
+      else
+        throw std::runtime_error("Expected one of: constant <seconds> <rate>, ramp <seconds> <from rate> <to rate>, "
+            "pause <seconds>, burst <iterations> <seconds>, sine <seconds> <mean rate> <amplitude> <period>");
+    }
+  } catch (std::runtime_error &e) {
+    fclose(fp);
+    std::stringstream ss;
+    ss << fileName << ":" << lineNumber << ": " << e.what();
+    throw std::runtime_error(ss.str());
+  }
+  fclose(fp);
+
+  if(segments.empty())
+    throw std::runtime_error(std::string("No segments in rate schedule file: ") + fileName);
+}
+
+/*
+ * Method: addConstant
+ * -------------------
+ *
+ * Append a segment of the given length (seconds, which may be HUGE_VAL) at a steady rate.
+ */
+void RateSchedule::addConstant(double duration, double rate){
+  if(!(duration >= 0) || !(rate >= 0))
+    throw std::runtime_error("The duration and rate of a segment must not be negative.");
+  Segment segment = {CONSTANT, 0, duration, 0, 0, rate, rate, 0};
+  add(segment);
+}
+
+/*
+ * Method: addRamp
+ * ---------------
+ *
+ * Append a segment of the given length (seconds) in which the rate changes linearly between the given rates.
+ */
+void RateSchedule::addRamp(double duration, double fromRate, double toRate){
+  if(!(duration >= 0) || !(fromRate >= 0) || !(toRate >= 0) || duration == HUGE_VAL)
+    throw std::runtime_error("The duration and rates of a ramp must not be negative.");
+  Segment segment = {RAMP, 0, duration, 0, 0, fromRate, toRate, 0};
+  add(segment);
+}
+
+/*
+ * Method: addBurst
+ * ----------------
+ *
+ * Append a segment in which the given number of iterations are all due at its start,
+ * followed by a pause of the given length (seconds).
+ */
+void RateSchedule::addBurst(double iterations, double pause){
+  if(!(iterations >= 0) || !(pause >= 0) || pause == HUGE_VAL)
+    throw std::runtime_error("The size and pause of a burst must not be negative.");
+  Segment segment = {BURST, 0, pause, 0, floor(iterations), 0, 0, 0};
+  add(segment);
+}
+
+/*
+ * Method: addSine
+ * ---------------
+ *
+ * Append a segment of the given length (seconds) in which the rate is mean + amplitude * sin(2*pi*t/period),
+ * where t is the time since the start of the segment.
+ */
+void RateSchedule::addSine(double duration, double mean, double amplitude, double period){
+  if(!(duration >= 0) || duration == HUGE_VAL || !(period > 0) || !(fabs(amplitude) <= mean))
+    throw std::runtime_error("A sine must have a positive period, and an amplitude no greater than its mean rate.");
+  Segment segment = {SINE, 0, duration, 0, 0, mean, amplitude, period};
+  add(segment);
+}
+
+/*
+ * Method: add
+ * -----------
+ *
+ * Append a segment, setting its start time and iterations from those of the segments before it.
+ */
+void RateSchedule::add(Segment &segment){
+  if(!segments.empty()){
+    Segment const &last = segments.back();
+    if(last.duration == HUGE_VAL)
+      throw std::runtime_error("No segment can follow one that never ends.");
+    segment.start = last.start + last.duration;
+    segment.firstIteration = last.firstIteration + last.iterations;
+  }
+  if(segment.type != BURST)
+    segment.iterations = segment.rate == 0 && segment.rate2 == 0 ? 0 : getSegmentIterations(segment, segment.duration);
+  segments.push_back(segment);
+}
+
+/*
+ * Method: empty
+ * -------------
+ *
+ * Returns true if the schedule has no segments.
+ */
+bool RateSchedule::empty() const {
+  return segments.empty();
+}
+
+/*
+ * Static Method: getSegmentIterations
+ * -----------------------------------
+ *
+ * Returns the number of iterations of a segment due by the given time (seconds) since its start.
+ */
+double RateSchedule::getSegmentIterations(Segment const &segment, double time){
+  switch(segment.type){
+  case CONSTANT:
+    return segment.rate * time;
+  case RAMP:
+    return segment.rate * time + (segment.rate2 - segment.rate) * time * time / (2 * segment.duration);
+  case BURST:
+    return segment.iterations;
+  case SINE:
+    return segment.rate * time + segment.rate2 * segment.period / (2 * M_PI) * (1 - cos(2 * M_PI * time / segment.period));
+  }
+  return 0;
+}
+
+/*
+ * Method: getIterations
+ * ---------------------
+ *
+ * Returns the (fractional) number of iterations due by the given time (seconds since the start of the schedule).
+ */
+double RateSchedule::getIterations(double time) const {
+  if(time < 0) return 0;
+  for(std::vector<Segment>::const_iterator it = segments.begin(); it != segments.end(); ++it){
+    if(time < it->start + it->duration)
+      return it->firstIteration + (it->iterations == 0 ? 0 : getSegmentIterations(*it, time - it->start));
+  }
+  return segments.empty() ? 0 : segments.back().firstIteration + segments.back().iterations;
+}
+
+/*
+ * Method: getTime
+ * ---------------
+ *
+ * Returns the time (seconds since the start of the schedule) at which the given (fractional)
+ * iteration is due, or a negative value if the schedule ends before it.
+ */
+double RateSchedule::getTime(double iteration) const {
+  if(iteration < 0) iteration = 0;
+
+  // Find the first segment that ends after the iteration
+  size_t low = 0, high = segments.size();
+  while(low < high){
+    size_t mid = (low + high) / 2;
+    if(segments[mid].firstIteration + segments[mid].iterations > iteration) high = mid;
+    else low = mid + 1;
+  }
+  if(low == segments.size()) return -1;
+
+  Segment const &segment = segments[low];
+  double const n = iteration - segment.firstIteration;
+  double time = 0;
+
+  switch(segment.type){
+  case CONSTANT:
+    time = n / segment.rate;
+    break;
+  case RAMP: {
+    // The positive root of the quadratic, in a form that doesn't lose precision when the rate barely changes
+    double const root = segment.rate * segment.rate + 2 * (segment.rate2 - segment.rate) * n / segment.duration;
+    double const denominator = segment.rate + sqrt(root > 0 ? root : 0);
+    time = denominator > 0 ? 2 * n / denominator : 0;
+    break;
+  }
+  case BURST:
+    time = 0;
+    break;
+  case SINE: {
+    // Newton's method, falling back to bisection when a step would leave the bracket (e.g. where the rate is 0)
+    double lower = 0, upper = segment.duration;
+    time = n / segment.rate;
+    if(time > upper) time = upper;
+    for(int i = 0; i < 64; i++){
+      double const error = getSegmentIterations(segment, time) - n;
+      if(fabs(error) < 1e-9) break;
+      if(error > 0) upper = time;
+      else lower = time;
+      double const rate = segment.rate + segment.rate2 * sin(2 * M_PI * time / segment.period);
+      double next = rate > 0 ? time - error / rate : lower - 1;
+      time = next > lower && next < upper ? next : (lower + upper) / 2;
+    }
+    break;
+  }
+  }
+
+  if(time > segment.duration) time = segment.duration;
+  return segment.start + time;
+}
+
+}
@@ -0,0 +1,95 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#ifndef RATESCHEDULE_HPP_
+#define RATESCHEDULE_HPP_
+
+#include <vector>
+
+namespace cph {
+
+/*
+ * Class: RateSchedule
+ * -------------------
+ *
+ * A target iteration rate for a WorkerThread that varies over the course of a run, made up of a
+ * sequence of segments, each of which is one of:
+ *
+ *   constant <seconds> <rate>                        - a steady rate
+ *   ramp <seconds> <from rate> <to rate>             - a rate changing linearly (up or down)
+ *   pause <seconds>                                  - no iterations
+ *   burst <iterations> <seconds>                     - iterations all due at once, then a pause
+ *   sine <seconds> <mean rate> <amplitude> <period>  - a rate varying sinusoidally about the mean
+ *
+ * Rates are in iterations/second. A schedule is either read from a file, with one segment per
+ * line (blank lines and lines starting with # are ignored), or built up with the add methods.
+ *
+ * The schedule is used by mapping between the time since it started and the (fractional) number
+ * of iterations due by then: getIterations gives the number due at a time, and getTime the time
+ * at which a given iteration is due.
+ */
+class RateSchedule {
+public:
+  RateSchedule();
+
+  void load(char const * fileName);
+  void addConstant(double duration, double rate);
+  void addRamp(double duration, double fromRate, double toRate);
+  void addBurst(double iterations, double pause);
+  void addSine(double duration, double mean, double amplitude, double period);
+
+  bool empty() const;
+  double getIterations(double time) const;
+  double getTime(double iteration) const;
+
+private:
+  enum SegmentType { CONSTANT, RAMP, BURST, SINE };
+
+  struct Segment {
+    SegmentType type;
+    /*Time (s) at which the segment starts, and its length.*/
+    double start;
+    double duration;
+    /*The number of iterations due before the segment starts, and during it.*/
+    double firstIteration;
+    double iterations;
+    /*The (initial) rate, and the final rate of a ramp or the amplitude of a sine.*/
+    double rate;
+    double rate2;
+    /*The period of a sine.*/
+    double period;
+  };
+
+  std::vector<Segment> segments;
+
+  void add(Segment &segment);
+  static double getSegmentIterations(Segment const &segment, double time);
+};
+
+}
+
+#endif /* RATESCHEDULE_HPP_ */
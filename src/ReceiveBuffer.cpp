@@ -0,0 +1,141 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+
+#include "ReceiveBuffer.hpp"
+#include <string.h>
+
+namespace cph {
+
+/*
+ * Function: sizeClass
+ * -------------------
+ *
+ * The smallest size class (power of two) that holds the given length.
+ */
+static inline unsigned int sizeClass(MQLONG len){
+  unsigned int c = 0;
+  while(c<CPH_RECEIVEBUFFER_CLASSES-1 && ((MQLONG) 1<<c) < len) c++;
+  return c;
+}
+
+ReceiveBuffer::ReceiveBuffer(MQLONG minSize, unsigned int percentile, bool useMaxMsgLength) :
+    minSize(minSize), percentile(percentile), useMaxMsgLength(useMaxMsgLength),
+    limitKnown(false), limit(0), highWater(minSize), shrinkTo(0),
+    windowCount(0), smallWindows(0), retries(0), shrinks(0) {
+  memset(counts, 0, sizeof(counts));
+}
+
+/*
+ * Method: setLimit
+ * ----------------
+ *
+ * Set the MAXMSGL of the queue being got from, or 0 if it couldn't be found, in which case
+ * the buffer grows as if not sizing from MAXMSGL.
+ */
+void ReceiveBuffer::setLimit(MQLONG maxMsgLength){
+  limit = maxMsgLength;
+  limitKnown = true;
+}
+
+/*
+ * Method: grow
+ * ------------
+ *
+ * Returns the size to grow a buffer of the given size to, when a message of the given length didn't fit.
+ * Each call is counted as a retry of MQGET.
+ */
+MQLONG ReceiveBuffer::grow(MQLONG bufferLen, MQLONG needed){
+  retries++;
+  shrinkTo = 0;
+  smallWindows = 0;
+
+  MQLONG size;
+  if(limit>0){
+    size = limit;
+  } else {
+    size = (MQLONG) 1<<sizeClass(needed);
+    MQLONG doubled = bufferLen < CPH_RECEIVEBUFFER_MAX_SIZE/2 ? bufferLen*2 : CPH_RECEIVEBUFFER_MAX_SIZE;
+    if(doubled>highWater) doubled = highWater;
+    if(doubled>size) size = doubled;
+    if(size>CPH_RECEIVEBUFFER_MAX_SIZE) size = CPH_RECEIVEBUFFER_MAX_SIZE;
+  }
+  return size<needed ? needed : size;
+}
+
+/*
+ * Method: received
+ * ----------------
+ *
+ * Record a message of the given length got into a buffer of the given size.
+ * Returns the size to shrink the buffer to, or bufferLen if it's to be left as it is.
+ * A buffer is only shrunk when the message just received still fits.
+ */
+MQLONG ReceiveBuffer::received(MQLONG bufferLen, MQLONG messageLen){
+  counts[sizeClass(messageLen)]++;
+  if(++windowCount==CPH_RECEIVEBUFFER_WINDOW) endWindow(bufferLen);
+
+  if(shrinkTo==0 || messageLen>shrinkTo) return bufferLen;
+  MQLONG size = shrinkTo;
+  shrinkTo = 0;
+  shrinks++;
+  return size;
+}
+
+/*
+ * Method: endWindow
+ * -----------------
+ *
+ * Find the high-water size of the window of messages just received, and decide whether to shrink a
+ * buffer of the given size: when it's been more than one size class above the high-water size for
+ * CPH_RECEIVEBUFFER_SHRINK_WINDOWS windows in a row.
+ */
+void ReceiveBuffer::endWindow(MQLONG bufferLen){
+  unsigned int const rank = (CPH_RECEIVEBUFFER_WINDOW*percentile + 99)/100;
+  unsigned int seen = 0;
+  unsigned int c = 0;
+  for(; c<CPH_RECEIVEBUFFER_CLASSES-1; c++){
+    seen += counts[c];
+    if(seen>=rank) break;
+  }
+  highWater = (MQLONG) 1<<c;
+  if(highWater<minSize) highWater = minSize;
+
+  memset(counts, 0, sizeof(counts));
+  windowCount = 0;
+
+  if(bufferLen/2 > highWater){
+    if(++smallWindows>=CPH_RECEIVEBUFFER_SHRINK_WINDOWS){
+      shrinkTo = highWater;
+      smallWindows = 0;
+    }
+  } else {
+    smallWindows = 0;
+  }
+}
+
+}
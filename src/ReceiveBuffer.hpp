@@ -0,0 +1,100 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+
+#ifndef RECEIVEBUFFER_HPP_
+#define RECEIVEBUFFER_HPP_
+
+#include <cmqc.h>
+
+#include "cphUtil.h"
+
+/*The number of message size classes: powers of two from 1 byte.*/
+#define CPH_RECEIVEBUFFER_CLASSES 28
+/*The number of messages received over which the high-water size is found.*/
+#define CPH_RECEIVEBUFFER_WINDOW 1024
+/*The number of consecutive windows of small messages after which the buffer is shrunk.*/
+#define CPH_RECEIVEBUFFER_SHRINK_WINDOWS 8
+/*The largest message MQ allows.*/
+#define CPH_RECEIVEBUFFER_MAX_SIZE 104857600
+
+namespace cph {
+
+/*
+ * Class: ReceiveBuffer
+ * --------------------
+ *
+ * Decides the size of a single thread's receive buffer (rs) as messages are got into it (see MQIMessage).
+ *
+ * Buffer sizes are powers of two (size classes), so that messages of similar sizes share a buffer size.
+ * When a message doesn't fit, the buffer grows to the size class of the message, or geometrically up
+ * to the high-water size if that's larger - or, if sizing from MAXMSGL (rx), straight to the queue's
+ * MAXMSGL. The high-water size is the size class of a percentile (rh) of the last window of messages
+ * received. Once several windows in a row have been well below the buffer size, it shrinks back to
+ * the high-water size, though never below the initial size.
+ */
+class ReceiveBuffer {
+public:
+  ReceiveBuffer(MQLONG minSize, unsigned int percentile, bool useMaxMsgLength);
+
+  /*Whether the queue's MAXMSGL is to be supplied (by setLimit) before the buffer next grows.*/
+  bool needsLimit() const { return useMaxMsgLength && !limitKnown; }
+  void setLimit(MQLONG maxMsgLength);
+
+  MQLONG grow(MQLONG bufferLen, MQLONG needed);
+  MQLONG received(MQLONG bufferLen, MQLONG messageLen);
+
+  uint64_t getRetries() const { return retries; }
+  uint64_t getShrinks() const { return shrinks; }
+  MQLONG getHighWater() const { return highWater; }
+  unsigned int getPercentile() const { return percentile; }
+
+private:
+  MQLONG const minSize;
+  unsigned int const percentile;
+  bool const useMaxMsgLength;
+  bool limitKnown;
+  /*The queue's MAXMSGL, or 0 if not known.*/
+  MQLONG limit;
+
+  /*The size class (in bytes) of the percentile of the last full window, at least minSize.*/
+  MQLONG highWater;
+  /*The size to shrink to once a message fits it, or 0 if not shrinking.*/
+  MQLONG shrinkTo;
+  unsigned int counts[CPH_RECEIVEBUFFER_CLASSES];
+  unsigned int windowCount;
+  unsigned int smallWindows;
+
+  uint64_t retries;
+  uint64_t shrinks;
+
+  void endWindow(MQLONG bufferLen);
+};
+
+}
+
+#endif /* RECEIVEBUFFER_HPP_ */
@@ -0,0 +1,275 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+
+#include "ReplyDispatcher.hpp"
+#include "MQI.hpp"
+#include "cphLog.h"
+#include "cphTrace.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdexcept>
+
+/*The longest (ms) the dispatcher waits in MQGET, so that it notices promptly when it's asked to stop.*/
+#define DISPATCH_POLL_INTERVAL 100
+
+namespace cph {
+
+/*
+ * ---------------------------------------
+ * Method implementations for ReplyMailbox
+ * ---------------------------------------
+ */
+
+ReplyMailbox::ReplyMailbox() : mask(0), head(0), tail(0), dropped(0), waiting(0) {}
+
+/*
+ * Method: init
+ * ------------
+ *
+ * Make room for (at least) the given number of replies not yet taken. Must be called before the mailbox is used.
+ */
+void ReplyMailbox::init(unsigned int capacity){
+  size_t size = 2;
+  while(size < capacity) size <<= 1;
+  slots.resize(size);
+  mask = size - 1;
+}
+
+/*
+ * Method: post
+ * ------------
+ *
+ * Pass on a reply, waking the consumer if it's waiting for one. Must only be called by the producer.
+ *
+ * Returns: false if the mailbox is full, in which case the reply is dropped.
+ */
+bool ReplyMailbox::post(MQBYTE24 const correlId){
+  uint64_t const t = tail;
+  if(t - cphAtomicLoad64(&head) > mask){
+    cphAtomicInc64(&dropped);
+    return false;
+  }
+  memcpy(slots[t & mask].correlId, correlId, sizeof(MQBYTE24));
+
+  // A full read-modify-write, so that the consumer can't be missed starting to wait before it's seen
+  cphAtomicAdd64(&tail, 1);
+  if(cphAtomicLoad64(&waiting) != 0){
+    lock.lock();
+    lock.notify();
+    lock.unlock();
+  }
+  return true;
+}
+
+/*
+ * Method: take
+ * ------------
+ *
+ * Take the next reply, waiting up to the given number of milliseconds for one if there
+ * are none already. Must only be called by the consumer.
+ *
+ * Returns: false if there was no reply in time.
+ */
+bool ReplyMailbox::take(MQBYTE24 correlId, int millis){
+  uint64_t const h = head;
+  bool ready = cphAtomicLoad64(&tail) != h;
+
+  if(!ready && millis > 0){
+    absTime const until = durationToAbs(millis);
+    lock.lock();
+    // Announce we're waiting before looking again, so the producer will notify us of anything we miss
+    cphAtomicAdd64(&waiting, 1);
+    while(!(ready = cphAtomicLoad64(&tail) != h) && !lock.wait(until));
+    cphAtomicStore64(&waiting, 0);
+    lock.unlock();
+  }
+  if(!ready) return false;
+
+  memcpy(correlId, slots[h & mask].correlId, sizeof(MQBYTE24));
+  cphAtomicStore64(&head, h + 1);
+  return true;
+}
+
+/*
+ * ------------------------------------------
+ * Method implementations for ReplyDispatcher
+ * ------------------------------------------
+ */
+
+/*
+ * Constructor: ReplyDispatcher
+ * ----------------------------
+ *
+ * Create a dispatcher getting replies from the named queue for the given number of Requester
+ * threads, each of which has at most window requests in flight. It isn't started until attach is called.
+ */
+ReplyDispatcher::ReplyDispatcher(CPH_CONFIG * pConfig, MQIOpts const * pOpts, char const * queueName, unsigned int mailboxCount, unsigned int window) :
+    Thread(pConfig), pOpts(pOpts), queueName(queueName),
+    mailboxes(new ReplyMailbox[mailboxCount]), mailboxCount(mailboxCount),
+    runId((uint64_t) cphUtilGetMonotonicNs() ^ (uint64_t) (size_t) this), unroutable(0),
+    startLock(), started(false), failed(0), failure() {
+  CPHTRACEENTRY(pConfig->pTrc)
+  // Leave room for late replies, to requests that have already been given up on, as well as those in flight
+  for(unsigned int i = 0; i < mailboxCount; i++)
+    mailboxes[i].init(window < 8 ? 16 : 2 * window);
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+ReplyDispatcher::~ReplyDispatcher(){
+  delete [] mailboxes;
+}
+
+/*
+ * Method: attach
+ * --------------
+ *
+ * Called by each Requester as it opens a session, to start the dispatcher if it's not already running.
+ */
+void ReplyDispatcher::attach(){
+  startLock.lock();
+  if(!started){
+    started = true;
+    if(!start()){
+      failure = "Could not start the reply dispatcher thread.";
+      cphAtomicStore64(&failed, 1);
+    }
+  }
+  startLock.unlock();
+  checkFailed();
+}
+
+/*
+ * Method: getMailbox
+ * ------------------
+ *
+ * Returns: the mailbox with the given index (the Requester's threadNum), to which its replies are passed.
+ */
+ReplyMailbox & ReplyDispatcher::getMailbox(unsigned int index){
+  if(index >= mailboxCount)
+    throw std::logic_error("No reply mailbox for this thread.");
+  return mailboxes[index];
+}
+
+/*
+ * Method: makeId
+ * --------------
+ *
+ * Make the message ID for a request whose reply is to be passed to the given mailbox:
+ * this dispatcher's runId, then the mailbox index, then the request's sequence number.
+ */
+void ReplyDispatcher::makeId(MQBYTE24 id, unsigned int mailbox, uint64_t sequence) const {
+  uint32_t const index = mailbox;
+  memcpy(id, &runId, sizeof(runId));
+  memcpy(id + 8, &index, sizeof(index));
+  memset(id + 12, 0, 4);
+  memcpy(id + 16, &sequence, sizeof(sequence));
+}
+
+/*
+ * Method: checkFailed
+ * -------------------
+ *
+ * Throw an exception if the dispatcher has stopped because of an error, so that the Requesters stop too.
+ */
+void ReplyDispatcher::checkFailed() const {
+  if(cphAtomicLoad64(&failed) != 0)
+    throw std::runtime_error("Reply dispatcher failed: " + failure);
+}
+
+/*
+ * Method: route
+ * -------------
+ *
+ * Pass a reply to the mailbox its correlation ID identifies.
+ */
+void ReplyDispatcher::route(MQBYTE24 const correlId){
+  uint32_t index;
+  memcpy(&index, correlId + 8, sizeof(index));
+  if(memcmp(correlId, &runId, sizeof(runId)) != 0 || index >= mailboxCount){
+    cphTraceId(pConfig->pTrc, "Unroutable reply with correlation ID", correlId);
+    unroutable++;
+    return;
+  }
+  mailboxes[index].post(correlId);
+}
+
+/*
+ * Method: run
+ * -----------
+ *
+ * Inherited from class: Thread
+ *
+ * Connect, and get replies from the shared reply queue, routing each to its mailbox, until asked to stop.
+ */
+void ReplyDispatcher::run(){
+  CPHTRACEENTRY(pConfig->pTrc)
+  char msg[512];
+  MQIConnection * pConnection = NULL;
+  MQIQueue * pQueue = NULL;
+  MQIMessage * pMessage = NULL;
+
+  try{
+    pConnection = new MQIConnection(this, pConfig, pOpts, "ReplyDispatcher");
+    pQueue = new MQIQueue(pConnection, false, true);
+    pQueue->setName("%s", queueName.data());
+    pQueue->open(true);
+    pMessage = new MQIMessage(pOpts, true);
+
+    MQGMO gmo = {MQGMO_DEFAULT};
+    gmo.Options = MQGMO_WAIT | MQGMO_NO_SYNCPOINT | MQGMO_FAIL_IF_QUIESCING;
+    gmo.WaitInterval = DISPATCH_POLL_INTERVAL;
+
+    snprintf(msg, 512, "[ReplyDispatcher] Dispatching replies from queue: %s", queueName.data());
+    cphLogPrintLn(pConfig->pLog, LOG_VERBOSE, msg);
+
+    while(!shutdown){
+      MQMD md = {MQMD_DEFAULT};
+      if(pQueue->poll(pMessage, md, gmo))
+        route(md.CorrelId);
+    }
+  } catch(std::runtime_error &e){
+    failure = e.what();
+    cphAtomicStore64(&failed, 1);
+    snprintf(msg, 512, "[ReplyDispatcher] Caught exception: %s", e.what());
+    cphLogPrintLn(pConfig->pLog, LOG_ERROR, msg);
+  }
+
+  if(unroutable > 0){
+    snprintf(msg, 512, "[ReplyDispatcher] %llu replies on %s were not to requests from this process, and were discarded.",
+        (unsigned long long) unroutable, queueName.data());
+    cphLogPrintLn(pConfig->pLog, LOG_WARNING, msg);
+  }
+
+  delete pMessage;
+  delete pQueue;
+  delete pConnection;
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+}
@@ -0,0 +1,141 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+
+#ifndef REPLYDISPATCHER_HPP_
+#define REPLYDISPATCHER_HPP_
+
+#include <string>
+#include <vector>
+#include <cmqc.h>
+
+#include "Thread.hpp"
+#include "Lock.hpp"
+#include "MQIOpts.hpp"
+#include "WorkerCounters.hpp"
+#include "cphAtomic.h"
+
+namespace cph {
+
+/*
+ * Class: ReplyMailbox
+ * -------------------
+ *
+ * The correlation IDs of the replies for a single Requester thread, passed to it by the ReplyDispatcher.
+ *
+ * This is a ring buffer with a single producer (the dispatcher) and a single consumer (the Requester),
+ * each of which only writes its own index, so neither takes a lock while the Requester has replies to
+ * take. Only when its mailbox is empty does the Requester wait on the lock, and only then (signalled by
+ * waiting) does the dispatcher take it to notify it of the next reply.
+ */
+class ReplyMailbox {
+public:
+  ReplyMailbox();
+
+  void init(unsigned int capacity);
+  bool post(MQBYTE24 const correlId);
+  bool take(MQBYTE24 correlId, int millis);
+
+  /*The number of replies discarded as the mailbox was full.*/
+  uint64_t getDropped() const { return cphAtomicLoad64(&dropped); }
+
+private:
+  struct Slot { MQBYTE24 correlId; };
+  std::vector<Slot> slots;
+  uint64_t mask;
+
+  /*The number of replies taken by the consumer, kept on a separate cache line to those the producer writes.*/
+  volatile uint64_t head;
+  char headPadding[CPH_CACHE_LINE_SIZE - sizeof(uint64_t)];
+  /*The number of replies posted by the producer.*/
+  volatile uint64_t tail;
+  volatile uint64_t dropped;
+  char tailPadding[CPH_CACHE_LINE_SIZE - 2 * sizeof(uint64_t)];
+  /*Non-zero while the consumer waits on lock for the next reply.*/
+  volatile uint64_t waiting;
+  Lock lock;
+
+  ReplyMailbox(ReplyMailbox const &);
+  ReplyMailbox & operator=(ReplyMailbox const &);
+};
+
+/*
+ * Class: ReplyDispatcher
+ * ----------------------
+ *
+ * Extends: Thread
+ *
+ * Gets the replies for all the Requester threads of this process from a reply queue they share,
+ * and passes each to the ReplyMailbox of the thread that put its request, rather than have each
+ * thread get its own replies with a selector or by correlation ID.
+ *
+ * Requests are put with IDs made by makeId, which hold the number of the requesting thread's
+ * mailbox, and replies are routed by their correlation IDs, which must be those of the requests
+ * (as Responders set them with co or cs). Replies with IDs not made by this dispatcher are discarded
+ * and counted, so the reply queue must not be shared with other processes.
+ */
+class ReplyDispatcher : public Thread {
+public:
+  ReplyDispatcher(CPH_CONFIG * pConfig, MQIOpts const * pOpts, char const * queueName, unsigned int mailboxCount, unsigned int window);
+  virtual ~ReplyDispatcher();
+
+  void attach();
+  ReplyMailbox & getMailbox(unsigned int index);
+  void makeId(MQBYTE24 id, unsigned int mailbox, uint64_t sequence) const;
+  void checkFailed() const;
+
+  /*The name of the shared reply queue.*/
+  char const * getQueueName() const { return queueName.data(); }
+
+protected:
+  virtual void run();
+
+private:
+  MQIOpts const * const pOpts;
+  std::string const queueName;
+  ReplyMailbox * const mailboxes;
+  unsigned int const mailboxCount;
+  /*Identifies the request IDs made by this dispatcher (their first 8 bytes).*/
+  uint64_t const runId;
+  /*The number of replies got that weren't to requests with IDs made by this dispatcher.*/
+  uint64_t unroutable;
+
+  Lock startLock;
+  bool started;
+  /*Set (non-zero) if the dispatcher has stopped because of an error, with failure set to its description.*/
+  volatile uint64_t failed;
+  std::string failure;
+
+  void route(MQBYTE24 const correlId);
+
+  ReplyDispatcher(ReplyDispatcher const &);
+  ReplyDispatcher & operator=(ReplyDispatcher const &);
+};
+
+}
+
+#endif /* REPLYDISPATCHER_HPP_ */
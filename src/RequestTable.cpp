@@ -0,0 +1,190 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+
+#include "RequestTable.hpp"
+#include <string.h>
+#include <stdexcept>
+
+namespace cph {
+
+/*
+ * Function: hashId
+ * ----------------
+ *
+ * FNV-1a over the whole of a message ID, as the parts of those generated by a queue manager
+ * that change from one message to the next aren't in the same place on every platform.
+ */
+static inline uint64_t hashId(MQBYTE24 const msgId){
+  uint64_t hash = 14695981039346656037ULL;
+  for(size_t i = 0; i < sizeof(MQBYTE24); i++){
+    hash ^= msgId[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+RequestTable::RequestTable() : mask(0), count(0) {}
+
+/*
+ * Method: init
+ * ------------
+ *
+ * Empty the table, and size it for at most window requests in flight at once.
+ */
+void RequestTable::init(unsigned int window){
+  size_t capacity = 2;
+  while(capacity < 2 * (size_t) window) capacity <<= 1;
+
+  RequestEntry empty;
+  memset(&empty, 0, sizeof(empty));
+  slots.assign(capacity, empty);
+  mask = capacity - 1;
+  count = 0;
+}
+
+/*
+ * Method: find
+ * ------------
+ *
+ * Returns: the slot holding the request with the given MsgId, or slots.size() if there isn't one.
+ */
+size_t RequestTable::find(MQBYTE24 const msgId) const {
+  for(size_t slot = (size_t) hashId(msgId) & mask; slots[slot].used; slot = (slot + 1) & mask){
+    if(memcmp(slots[slot].msgId, msgId, sizeof(MQBYTE24)) == 0)
+      return slot;
+  }
+  return slots.size();
+}
+
+/*
+ * Method: insert
+ * --------------
+ *
+ * Add a request, which must not be beyond the window the table was initialised with.
+ */
+void RequestTable::insert(MQBYTE24 const msgId, MQINT64 sent, uint64_t sequence){
+  if(2 * (size_t) (count + 1) > slots.size())
+    throw std::logic_error("Too many requests in flight for the request table.");
+
+  size_t slot = (size_t) hashId(msgId) & mask;
+  while(slots[slot].used) slot = (slot + 1) & mask;
+
+  RequestEntry &entry = slots[slot];
+  memcpy(entry.msgId, msgId, sizeof(MQBYTE24));
+  entry.sent = sent;
+  entry.sequence = sequence;
+  entry.used = true;
+  count++;
+}
+
+/*
+ * Method: removeAt
+ * ----------------
+ *
+ * Empty the given slot, moving back any later entries of the same probe sequence that
+ * would otherwise no longer be found from their home slot.
+ */
+void RequestTable::removeAt(size_t slot){
+  size_t hole = slot;
+  for(size_t next = (hole + 1) & mask; slots[next].used; next = (next + 1) & mask){
+    size_t home = (size_t) hashId(slots[next].msgId) & mask;
+    // Move the entry back unless its home lies cyclically after the hole, up to where it is now
+    if(((next - home) & mask) >= ((next - hole) & mask)){
+      slots[hole] = slots[next];
+      hole = next;
+    }
+  }
+  slots[hole].used = false;
+  count--;
+}
+
+/*
+ * Method: remove
+ * --------------
+ *
+ * Remove the request with the given MsgId, copying it to removed.
+ *
+ * Returns: false if there's no such request in flight.
+ */
+bool RequestTable::remove(MQBYTE24 const msgId, RequestEntry &removed){
+  size_t const slot = find(msgId);
+  if(slot == slots.size()) return false;
+  removed = slots[slot];
+  removeAt(slot);
+  return true;
+}
+
+/*
+ * Method: expire
+ * --------------
+ *
+ * Remove all requests sent before the given time, setting oldest to the time the
+ * oldest of those remaining was sent (or -1 if none remain).
+ *
+ * Returns: the number of requests removed.
+ */
+unsigned int RequestTable::expire(MQINT64 sentBefore, MQINT64 &oldest){
+  unsigned int expired = 0;
+  oldest = -1;
+
+  /*
+   * Removing an entry can move a later one back into its slot, so look at the same slot again
+   * after removing. Starting just after an empty slot means nothing is ever moved back past
+   * the start (and so missed) as we wrap around.
+   */
+  size_t start = 0;
+  while(slots[start].used) start = (start + 1) & mask;
+  for(size_t i = 1; i <= mask; i++){
+    size_t const slot = (start + i) & mask;
+    while(slots[slot].used && slots[slot].sent < sentBefore){
+      removeAt(slot);
+      expired++;
+    }
+    if(slots[slot].used && (oldest < 0 || slots[slot].sent < oldest))
+      oldest = slots[slot].sent;
+  }
+  return expired;
+}
+
+/*
+ * Method: clear
+ * -------------
+ *
+ * Remove all requests.
+ *
+ * Returns: the number of requests removed.
+ */
+unsigned int RequestTable::clear(){
+  unsigned int const cleared = count;
+  for(size_t slot = 0; slot < slots.size(); slot++)
+    slots[slot].used = false;
+  count = 0;
+  return cleared;
+}
+
+}
@@ -0,0 +1,89 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+
+#ifndef REQUESTTABLE_HPP_
+#define REQUESTTABLE_HPP_
+
+#include <vector>
+#include <cmqc.h>
+
+#include "cphUtil.h"
+
+namespace cph {
+
+/*
+ * Struct: RequestEntry
+ * --------------------
+ *
+ * A request awaiting its reply: the MsgId it was put with (which the reply carries as its CorrelId),
+ * when it was put (from cphUtilGetMonotonicNs), and its sequence number among the requests of its thread.
+ */
+struct RequestEntry {
+  MQBYTE24 msgId;
+  MQINT64 sent;
+  uint64_t sequence;
+  bool used;
+};
+
+/*
+ * Class: RequestTable
+ * -------------------
+ *
+ * The requests a single Requester thread has in flight, keyed by MsgId.
+ *
+ * This is an open-addressing hash table with linear probing, sized when the session is opened to at
+ * least twice the window of requests so probe sequences stay short, and never resized or allocated
+ * while requests are made. Removal shifts later entries of a probe sequence back, so there are no
+ * tombstones to accumulate over a long run.
+ */
+class RequestTable {
+public:
+  RequestTable();
+
+  void init(unsigned int window);
+  void insert(MQBYTE24 const msgId, MQINT64 sent, uint64_t sequence);
+  bool remove(MQBYTE24 const msgId, RequestEntry &removed);
+  unsigned int expire(MQINT64 sentBefore, MQINT64 &oldest);
+  unsigned int clear();
+
+  /*The number of requests in flight.*/
+  unsigned int size() const { return count; }
+
+private:
+  std::vector<RequestEntry> slots;
+  /*slots.size() - 1, which is one less than a power of two.*/
+  size_t mask;
+  unsigned int count;
+
+  size_t find(MQBYTE24 const msgId) const;
+  void removeAt(size_t slot);
+};
+
+}
+
+#endif /* REQUESTTABLE_HPP_ */
@@ -35,6 +35,9 @@
 #include "Requester.hpp"
 #include "cphLog.h"
 
+/*The longest (ms) a Requester waits for a dispatched reply at once, between checks that the dispatcher is still running.*/
+#define REPLY_WAIT_SLICE 1000
+
 namespace cph {
 
 bool Requester::useCorrelId = true;
@@ -45,6 +48,9 @@ char Requester::customSelector[MQ_SELECTOR_LENGTH];
 int Requester::dqChannels = 1;
 char Requester::iqPrefix[MQ_Q_NAME_LENGTH];
 char Requester::oqPrefix[MQ_Q_NAME_LENGTH];
+unsigned int Requester::window = 1;
+ReplyDispatcher * Requester::pDispatcher = NULL;
+unsigned int Requester::instances = 0;
 
 MQWTCONSTRUCTOR(Requester, true, true, false) {
   CPHTRACEENTRY(pConfig->pTrc)
@@ -90,14 +96,51 @@ MQWTCONSTRUCTOR(Requester, true, true, false) {
     if(CPHTRUE != cphConfigGetInt(pConfig, (int*) &dqChannels, "dq"))
       configError(pConfig, "(dq) Cannot determine number of dq channels");
     CPHTRACEMSG(pConfig->pTrc, "Number of DQ channels to configure: %d", dqChannels)
+
+    // Reply dispatcher
+    int dispatch = 0;
+    if(CPHTRUE != cphConfigGetBoolean(pConfig, &dispatch, "rd"))
+      configError(pConfig, "(rd) Cannot determine whether to dispatch replies from a shared reply queue.");
+    if(dispatch==CPHTRUE && (useSelector || dqChannels>1))
+      configError(pConfig, "(rd) Replies can't be dispatched from a shared reply queue with message selectors (cs) or DQ channels (dq).");
+    CPHTRACEMSG(pConfig->pTrc, "Dispatch replies from a shared reply queue: %s", dispatch==CPHTRUE ? "yes" : "no")
+
+    // Request window
+    if(CPHTRUE != cphConfigGetInt(pConfig, &temp, "rw"))
+      configError(pConfig, "(rw) Cannot determine the number of requests to keep in flight.");
+    if(temp<1)
+      configError(pConfig, "(rw) The number of requests to keep in flight must be at least 1.");
+    if(temp>1 && dispatch!=CPHTRUE && (!useCorrelId || useSelector))
+      configError(pConfig, "(rw) A window of requests needs replies matched by correlId (co), without message selectors (cs).");
+    window = (unsigned int) temp;
+    CPHTRACEMSG(pConfig->pTrc, "Requests in flight: %u", window)
+
+    if(dispatch==CPHTRUE){
+      if(CPHTRUE != cphConfigGetInt(pConfig, &temp, "nt"))
+        configError(pConfig, "(nt) Cannot determine the number of worker threads.");
+      pDispatcher = new ReplyDispatcher(pConfig, pOpts, oqPrefix, (unsigned int) temp, window);
+    }
   }
 
+  instances++;
+  pMailbox = pDispatcher==NULL ? NULL : &pDispatcher->getMailbox(threadNum);
+  mailboxDropped = 0;
+
   if (useSelector)
     generateCorrelID(correlId, pControlThread->procId);
 
   CPHTRACEEXIT(pConfig->pTrc)
 }
-Requester::~Requester() {}
+Requester::~Requester() {
+  // The last Requester to go stops the dispatcher
+  if(--instances==0 && pDispatcher!=NULL){
+    pDispatcher->signalShutdown();
+    while(pDispatcher->isAlive())
+      Thread::yield();
+    delete pDispatcher;
+    pDispatcher = NULL;
+  }
+}
 
 void Requester::openDestination(){
   CPHTRACEENTRY(pConfig->pTrc)
@@ -107,42 +150,61 @@ void Requester::openDestination(){
   CPH_DESTINATIONFACTORY_CALL_PRINTF(pInQueue->setName, iqPrefix, destinationIndex)
   pInQueue->open(true);
 
-  // Open reply queue
-  pOutQueue = new MQIQueue(pConnection, false, true);
-  CPH_DESTINATIONFACTORY_CALL_PRINTF(pOutQueue->setName, oqPrefix, destinationIndex)
-  if (useSelector){
-    if(pOpts->useMessageHandle) {
-      pOutQueue->createMsgHandleSelector(pConfig->pTrc, correlId);
-    } else {
-      pOutQueue->createSelector(pConfig->pTrc, correlId, useCustomSelector ? customSelector : NULL);
-    }
-  }
-  pOutQueue->open(true);
-
   // Set message type to request
   putMD.MsgType = MQMT_REQUEST;
 
-  //set correlId of message descriptor so requester can select message from reply queue
-  if (useSelector){
-    memcpy(putMD.CorrelId, correlId, sizeof(MQBYTE24));
-    pmo.Options &= ~MQPMO_NEW_CORREL_ID;
-  }
+  if(pDispatcher!=NULL){
+    // The dispatcher gets our replies from the shared reply queue, routing them by the IDs we make
+    pDispatcher->attach();
+    pOutQueue = NULL;
+    char const * const replyQName = pDispatcher->getQueueName();
+    size_t const replyQNameLength = strlen(replyQName);
+    memset(putMD.ReplyToQ, ' ', MQ_Q_NAME_LENGTH);
+    memcpy(putMD.ReplyToQ, replyQName, replyQNameLength < MQ_Q_NAME_LENGTH ? replyQNameLength : MQ_Q_NAME_LENGTH);
+    pmo.Options &= ~(MQPMO_NEW_MSG_ID | MQPMO_NEW_CORREL_ID);
+  } else {
+    // Open reply queue
+    pOutQueue = new MQIQueue(pConnection, false, true);
+    CPH_DESTINATIONFACTORY_CALL_PRINTF(pOutQueue->setName, oqPrefix, destinationIndex)
+    if (useSelector){
+      if(pOpts->useMessageHandle) {
+        pOutQueue->createMsgHandleSelector(pConfig->pTrc, correlId);
+      } else {
+        pOutQueue->createSelector(pConfig->pTrc, correlId, useCustomSelector ? customSelector : NULL);
+      }
+    }
+    pOutQueue->open(true);
 
-  // Set ReplyTo QM
-  // We should let the QM set the reply to QM as this will default to local QM, but will also allow us to override
-  // the ReplyTo QM using queue alias if required. This is the mechanism used to support multiple return channels
-  // strncpy(putMD.ReplyToQMgr, pOpts->QMName, MQ_Q_MGR_NAME_LENGTH);
+    //set correlId of message descriptor so requester can select message from reply queue
+    if (useSelector){
+      memcpy(putMD.CorrelId, correlId, sizeof(MQBYTE24));
+      pmo.Options &= ~MQPMO_NEW_CORREL_ID;
+    }
 
-  //If more than one DQ channel is in use, we need to fixup the replyToQ to a Q alias as defined on the client QM
-  //We are using QMX.REPLYZ syntax, i.e. PERF1.REPLY1
-  if (dqChannels > 1) {
-    snprintf(putMD.ReplyToQ, MQ_Q_NAME_LENGTH, "%s.%s", pOpts->QMName, pOutQueue->getName());
-  } else {
-    // Set ReplyTo queue
-    if(destinationIndex>=0)
-      snprintf(putMD.ReplyToQ, MQ_Q_NAME_LENGTH, "%s%d", oqPrefix, destinationIndex);
-    else
-      strncpy(putMD.ReplyToQ, oqPrefix, MQ_Q_NAME_LENGTH);
+    // Set ReplyTo QM
+    // We should let the QM set the reply to QM as this will default to local QM, but will also allow us to override
+    // the ReplyTo QM using queue alias if required. This is the mechanism used to support multiple return channels
+    // strncpy(putMD.ReplyToQMgr, pOpts->QMName, MQ_Q_MGR_NAME_LENGTH);
+
+    //If more than one DQ channel is in use, we need to fixup the replyToQ to a Q alias as defined on the client QM
+    //We are using QMX.REPLYZ syntax, i.e. PERF1.REPLY1
+    if (dqChannels > 1) {
+      snprintf(putMD.ReplyToQ, MQ_Q_NAME_LENGTH, "%s.%s", pOpts->QMName, pOutQueue->getName());
+    } else {
+      // Set ReplyTo queue
+      if(destinationIndex>=0)
+        snprintf(putMD.ReplyToQ, MQ_Q_NAME_LENGTH, "%s%d", oqPrefix, destinationIndex);
+      else
+        strncpy(putMD.ReplyToQ, oqPrefix, MQ_Q_NAME_LENGTH);
+    }
+  }
+
+  requestSequence = 0;
+  repliesOutOfOrder = repliesLate = repliesMissing = 0;
+  if(window>1){
+    requests.init(window);
+    highestReplied = 0;
+    nextExpiry = -1;
   }
 
   CPHTRACEEXIT(pConfig->pTrc)
@@ -150,6 +212,34 @@ void Requester::openDestination(){
 
 void Requester::closeDestination(){
   CPHTRACEENTRY(pConfig->pTrc)
+
+  if(window>1 && (pOutQueue != NULL || pDispatcher != NULL)){
+    // Collect the replies to the requests still in flight, so they aren't left for the next session
+    MQGMO drainGmo = gmo;
+    drainGmo.Options = (drainGmo.Options & ~MQGMO_SYNCPOINT) | MQGMO_NO_SYNCPOINT;
+    try{
+      while(requests.size()>0){
+        MQBYTE24 replyId;
+        RequestEntry entry;
+        getReply(replyId, drainGmo);
+        if(!requests.remove(replyId, entry))
+          countReplies(EVENT_REPLY_LATE, repliesLate, 1);
+      }
+    } catch(MQIException &e){
+      (void) e;
+    } catch(ShutdownException &e){
+      (void) e;
+    }
+    countReplies(EVENT_REPLY_MISSING, repliesMissing, requests.clear());
+
+    if(repliesOutOfOrder>0 || repliesLate>0 || repliesMissing>0){
+      char msg[256];
+      snprintf(msg, 256, "[%s] Replies this session: %llu out of order, %llu late, %llu missing.", name.data(),
+          (unsigned long long) repliesOutOfOrder, (unsigned long long) repliesLate, (unsigned long long) repliesMissing);
+      cphLogPrintLn(pConfig->pLog, repliesMissing>0 ? LOG_WARNING : LOG_VERBOSE, msg);
+    }
+  }
+
   delete pInQueue;
   pInQueue = NULL;
 
@@ -160,7 +250,17 @@ void Requester::closeDestination(){
 
 void Requester::msgOneIteration(){
   CPHTRACEENTRY(pConfig->pTrc)
+  if(window>1){
+    windowIteration();
+    CPHTRACEEXIT(pConfig->pTrc)
+    return;
+  }
+
   // Put request
+  if(pDispatcher!=NULL){
+    pDispatcher->makeId(putMD.MsgId, threadNum, ++requestSequence);
+    memcpy(putMD.CorrelId, putMD.MsgId, sizeof(MQBYTE24));
+  }
   pInQueue->put(putMessage, putMD, pmo);
 
   // Commit transaction if necessary,
@@ -168,6 +268,17 @@ void Requester::msgOneIteration(){
   if(pOpts->commitPGPut) pConnection->commitTransaction();
 
   // Get reply
+  if(pDispatcher!=NULL){
+    // Anything but the reply to this request is late, for one from a previous session
+    MQBYTE24 replyId;
+    takeReply(replyId, gmo.WaitInterval);
+    while(memcmp(replyId, putMD.MsgId, sizeof(MQBYTE24)) != 0){
+      countReplies(EVENT_REPLY_LATE, repliesLate, 1);
+      takeReply(replyId, gmo.WaitInterval);
+    }
+    CPHTRACEEXIT(pConfig->pTrc)
+    return;
+  }
   MQMD getMD = pOpts->getGetMD();
   if(useCorrelId && !useSelector){
     memcpy(getMD.CorrelId, putMD.MsgId, sizeof(MQBYTE24));
@@ -179,4 +290,160 @@ void Requester::msgOneIteration(){
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
+/*
+ * Method: putRequest
+ * ------------------
+ *
+ * Put a request, adding it to those in flight.
+ */
+void Requester::putRequest(){
+  uint64_t const sequence = ++requestSequence;
+  if(pDispatcher!=NULL){
+    pDispatcher->makeId(putMD.MsgId, threadNum, sequence);
+    memcpy(putMD.CorrelId, putMD.MsgId, sizeof(MQBYTE24));
+  }
+  pInQueue->put(putMessage, putMD, pmo);
+
+  MQINT64 const sent = cphUtilGetMonotonicNs();
+  requests.insert(putMD.MsgId, sent, sequence);
+  if(nextExpiry<0 && gmo.WaitInterval!=MQWI_UNLIMITED)
+    nextExpiry = sent + (MQINT64) gmo.WaitInterval * 1000000;
+}
+
+/*
+ * Method: windowIteration
+ * -----------------------
+ *
+ * An iteration with a window (rw) of requests: top up the requests in flight to the window,
+ * then get the next reply to arrive (whichever request it answers) from the reply queue.
+ *
+ * Replies are matched to their requests by correlId, which must be the request's message ID.
+ * A reply that arrives after one to a later request is counted as out of order. A request
+ * that has had no reply for the polling timeout (to) is counted as missing, and its reply,
+ * if it arrives after all (or any other reply that matches no request in flight), as late.
+ * Late replies aren't iterations; we go on to get the next reply instead.
+ *
+ * As replies are got without selecting them, the reply queue must not be shared with other
+ * Requesters (see the destination options), unless they're dispatched to us (rd).
+ */
+void Requester::windowIteration(){
+  bool putAny = false;
+  while(requests.size()<window){
+    putRequest();
+    putAny = true;
+  }
+  // Commit the requests if necessary, otherwise we won't get our replies.
+  if(putAny && pOpts->commitPGPut) pConnection->commitTransaction();
+
+  while(true){
+    if(nextExpiry>=0){
+      MQINT64 const now = cphUtilGetMonotonicNs();
+      if(now>=nextExpiry) expireRequests(now);
+    }
+
+    MQBYTE24 replyId;
+    try{
+      getReply(replyId, gmo);
+    } catch(MQIException &e){
+      // No reply at all for the whole timeout means none of those in flight will be answered in time
+      if(e.reasonCode==MQRC_NO_MSG_AVAILABLE){
+        countReplies(EVENT_REPLY_MISSING, repliesMissing, requests.clear());
+        nextExpiry = -1;
+      }
+      throw;
+    }
+
+    RequestEntry entry;
+    if(!requests.remove(replyId, entry)){
+      cphTraceId(pConfig->pTrc, "Late reply with correlation ID", replyId);
+      countReplies(EVENT_REPLY_LATE, repliesLate, 1);
+      continue;
+    }
+
+    if(entry.sequence<highestReplied)
+      countReplies(EVENT_REPLY_OUT_OF_ORDER, repliesOutOfOrder, 1);
+    else
+      highestReplied = entry.sequence;
+    return;
+  }
+}
+
+/*
+ * Method: getReply
+ * ----------------
+ *
+ * Get the next reply to arrive, with the given options, setting correlId to its correlation ID.
+ * As for MQIObject::get, an MQIException is thrown if none arrives within the wait interval.
+ */
+void Requester::getReply(MQBYTE24 correlId, MQGMO & getGmo){
+  if(pDispatcher!=NULL){
+    takeReply(correlId, getGmo.WaitInterval);
+    return;
+  }
+  MQMD getMD = pOpts->getGetMD();
+  pOutQueue->get(getMessage, getMD, getGmo);
+  memcpy(correlId, getMD.CorrelId, sizeof(MQBYTE24));
+}
+
+/*
+ * Method: takeReply
+ * -----------------
+ *
+ * Take the next reply passed to us by the ReplyDispatcher (rd), waiting up to the given interval
+ * (ms, or MQWI_UNLIMITED) for one. As when getting from a queue, if none arrives in time, a
+ * ShutdownException is thrown if we've been asked to shut down, or an MQIException otherwise.
+ * Replies the dispatcher dropped as our mailbox was full are counted as late.
+ */
+void Requester::takeReply(MQBYTE24 correlId, MQLONG waitInterval){
+  MQINT64 const deadline = waitInterval==MQWI_UNLIMITED ? -1 : cphUtilGetMonotonicNs() + (MQINT64) waitInterval * 1000000;
+  int slice = waitInterval==MQWI_UNLIMITED || waitInterval>REPLY_WAIT_SLICE ? REPLY_WAIT_SLICE : (int) waitInterval;
+
+  while(!pMailbox->take(correlId, slice)){
+    pDispatcher->checkFailed();
+    if(deadline<0){
+      checkShutdown();
+      continue;
+    }
+    MQINT64 const remaining = deadline - cphUtilGetMonotonicNs();
+    if(remaining<=0){
+      checkShutdown();
+      throw MQIException("MQGET", MQCC_FAILED, MQRC_NO_MSG_AVAILABLE, NULL, pDispatcher->getQueueName());
+    }
+    if(remaining < (MQINT64) REPLY_WAIT_SLICE * 1000000)
+      slice = (int) (remaining / 1000000) + 1;
+  }
+
+  uint64_t const dropped = pMailbox->getDropped();
+  if(dropped!=mailboxDropped){
+    countReplies(EVENT_REPLY_LATE, repliesLate, dropped - mailboxDropped);
+    mailboxDropped = dropped;
+  }
+}
+
+/*
+ * Method: expireRequests
+ * ----------------------
+ *
+ * Count the requests in flight that have waited longer than the polling timeout (to)
+ * for their replies as missing, and stop waiting for them.
+ */
+void Requester::expireRequests(MQINT64 now){
+  MQINT64 const timeout = (MQINT64) gmo.WaitInterval * 1000000;
+  MQINT64 oldest;
+  countReplies(EVENT_REPLY_MISSING, repliesMissing, requests.expire(now - timeout, oldest));
+  nextExpiry = oldest<0 ? -1 : oldest + timeout;
+}
+
+/*
+ * Method: countReplies
+ * --------------------
+ *
+ * Add to the given count of replies for this session, and to the call statistics (vs) if collected.
+ */
+void Requester::countReplies(CallEvent event, uint64_t &counter, uint64_t occurrences){
+  if(occurrences==0) return;
+  counter += occurrences;
+  if(pCallStats != NULL) pCallStats->count(event, occurrences);
+}
+
 }
@@ -30,6 +30,8 @@
 #define REQUESTER_HPP_
 
 #include "MQIWorkerThread.hpp"
+#include "RequestTable.hpp"
+#include "ReplyDispatcher.hpp"
 #include <cmqc.h>
 
 namespace cph {
@@ -41,6 +43,12 @@ namespace cph {
  * Extends: MQIWorkerThread
  *
  * Puts a message to a queue, then gets a response back from another queue.
+ *
+ * With a window (rw) of more than one, keeps that many requests in flight at once, each iteration
+ * getting the next reply to arrive and putting a new request in place of the one it answers.
+ *
+ * With rd, the replies for all the threads are got from a shared reply queue by a single
+ * ReplyDispatcher, which passes each to its thread's ReplyMailbox.
  */
 MQWTCLASSDEF(Requester,
   static bool useCorrelId;
@@ -49,11 +57,35 @@ MQWTCLASSDEF(Requester,
   static char iqPrefix[MQ_Q_NAME_LENGTH];
   static char oqPrefix[MQ_Q_NAME_LENGTH];
   static char customSelector[MQ_SELECTOR_LENGTH];
+  static unsigned int window;
+  static ReplyDispatcher * pDispatcher;
+  static unsigned int instances;
 
   /*The queue to put to.*/
   MQIObject * pInQueue;
   /*The queue to get from.*/
   MQIObject * pOutQueue;
+
+  /*Where the ReplyDispatcher (rd) passes our replies, and how many it had dropped when last checked.*/
+  ReplyMailbox * pMailbox;
+  uint64_t mailboxDropped;
+
+  /*The requests in flight, when using a window of them (rw).*/
+  RequestTable requests;
+  /*The sequence number given to the last request put, and the highest of those replied to.*/
+  uint64_t requestSequence;
+  uint64_t highestReplied;
+  /*When (from cphUtilGetMonotonicNs) the oldest request in flight will have waited the timeout (to), or -1.*/
+  MQINT64 nextExpiry;
+  /*Counts of replies for this thread: out of order, late, and never received (missing) - see windowIteration.*/
+  uint64_t repliesOutOfOrder, repliesLate, repliesMissing;
+
+  void putRequest();
+  void getReply(MQBYTE24 correlId, MQGMO & getGmo);
+  void takeReply(MQBYTE24 correlId, MQLONG waitInterval);
+  void windowIteration();
+  void expireRequests(MQINT64 now);
+  void countReplies(CallEvent event, uint64_t &counter, uint64_t occurrences);
 )
 
 }
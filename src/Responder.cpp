@@ -30,78 +30,10 @@
 #include <string.h>
 #include "cphLog.h"
 
-#define CPH_RESPONDER_OQ_CACHE_INITIAL_BUCKET_COUNT 10
-
 using namespace std;
 
 namespace cph {
 
-#ifdef tr1
-/*
- * Function: pobj_hash
- * -------------------
- *
- * Hash function for pointers to MQIObjects.
- * Hashes on the object and QM name in the OD.
- *
- * Used for locating MQIObject pointers in the ObjectCache hash set.
- */
-static size_t pobj_hash(MQIQueue * const pObj){
-  size_t rc = 5381;
-
-  char const * name = pObj->getQMName();
-  for(int i = 0; i<MQ_Q_MGR_NAME_LENGTH; i++){
-    char c = name[i];
-    if(c=='\0') break;
-    rc = ((rc<<5) + rc) ^ name[i];
-  }
-
-  name = pObj->getName();
-  for(int i = 0; i<MQ_Q_NAME_LENGTH; i++){
-    char c = name[i];
-    if(c=='\0') break;
-    rc = ((rc<<5) + rc) ^ name[i];
-  }
-
-  return rc;
-}
-
-/*
- * Function: pobj_eq
- * -----------------
- *
- * Determines whether MQIQueues pointed to by the two given pointers
- * represent the same queue, as determined by the object name and QM name of the OD.
- *
- * Used for determining the equality of members of the ObjectCache hash set.
- */
-static bool pobj_eq(MQIQueue * const a, MQIQueue * const b){
-  return
-      0==strncmp(a->getQMName(), b->getQMName(), MQ_Q_MGR_NAME_LENGTH) &&
-      0==strncmp(a->getName(), b->getName(), MQ_Q_NAME_LENGTH);
-}
-#else
-
-/*
- * Function: pobj_cmp
- * ------------------
- *
- * Determines whether an MQIQueue pointed at by the first given pointer
- * is lexicographically less than the one pointed at by the second given pointer.
- * Here, we define lexicographic ordering to be first by associated QM name,
- * and then by queue name.
- *
- * Used for determining the ordering and equality of members of the ObjectCache set.
- */
-static bool pobj_cmp(MQIQueue * const a, MQIQueue * const b){
-  if(strncmp(a->getQMName(), b->getQMName(), MQ_Q_MGR_NAME_LENGTH) < 0)
-    return true;
-  if(strncmp(a->getName(), b->getName(), MQ_Q_NAME_LENGTH) < 0)
-    return true;
-  return false;
-}
-#endif
-
 /*Whether to copy the request's message ID to the reply's correlation ID*/
 bool Responder::useCorrelId = true;
 /*Whether or not to send the request message back as the reply*/
@@ -117,13 +49,10 @@ bool Responder::useSelector = false;
  */
 bool Responder::commitBetween = false;
 
-MQWTCONSTRUCTOR(Responder, true, true, false), pInQueue(NULL),
-#ifdef tr1
-    oqCache(CPH_RESPONDER_OQ_CACHE_INITIAL_BUCKET_COUNT, &pobj_hash, &pobj_eq),
-#else
-    oqCache(&pobj_cmp),
-#endif
-    dummyOut(NULL) {
+/*The number of reply-to-queues to keep open, or 0 for no limit.*/
+unsigned int Responder::replyQCacheSize = 0;
+
+MQWTCONSTRUCTOR(Responder, true, true, false), pInQueue(NULL) {
   CPHTRACEENTRY(pConfig->pTrc)
 
   if(threadNum==0){
@@ -181,8 +110,18 @@ MQWTCONSTRUCTOR(Responder, true, true, false), pInQueue(NULL),
       commitBetween = temp==CPHTRUE;
       CPHTRACEMSG(pConfig->pTrc, "Commit between getting the request and putting the reply: %s", commitBetween ? "yes" : "no")
     }
+
+    // Reply-to-queues kept open
+    if(CPHTRUE != cphConfigGetInt(pConfig, &temp, "rq"))
+      configError(pConfig, "(rq) Cannot determine the number of reply-to-queues to keep open.");
+    if(temp<0)
+      configError(pConfig, "(rq) The number of reply-to-queues to keep open cannot be negative.");
+    replyQCacheSize = temp;
+    CPHTRACEMSG(pConfig->pTrc, "Reply-to-queues kept open: %u", replyQCacheSize)
   }
 
+  configureCallbackConsumer();
+
   CPHTRACEEXIT(pConfig->pTrc)
 }
 Responder::~Responder() {}
@@ -214,41 +153,96 @@ void Responder::closeDestination(){
 
   // Close cached output queues
   for(ReplyQCache::iterator it = oqCache.begin(); it!=oqCache.end(); it++)
-    delete *it;
+    delete it->pQueue;
   oqCache.clear();
-
-  // Delete dummy output queue object
-  delete dummyOut;
-  dummyOut = NULL;
+  oqIndex.clear();
 
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
+/*
+ * Method: getReplyQueue
+ * ---------------------
+ *
+ * Get the open reply-to-queue named by the given message descriptor.
+ * Consecutive requests usually name the same queue, which will be at the front of
+ * oqCache, so that is checked against the raw MQMD fields before the index is used.
+ */
 inline MQIQueue * Responder::getReplyQueue(MQMD const & md){
-  CPHTRACEENTRY(pConfig->pTrc)
-  if(dummyOut==NULL)
-    dummyOut = new MQIQueue(pConnection, true, false);
+  if(!oqCache.empty()){
+    ReplyQEntry const & last = oqCache.front();
+    if(0==memcmp(last.qName, md.ReplyToQ, sizeof(MQCHAR48)) && 0==memcmp(last.qmName, md.ReplyToQMgr, sizeof(MQCHAR48))){
+      countReplyQ(EVENT_REPLYQ_HIT);
+      return last.pQueue;
+    }
+  }
+  return openReplyQueue(md);
+}
 
+/*
+ * Method: openReplyQueue
+ * ----------------------
+ *
+ * Get the reply-to-queue named by the given message descriptor when it isn't the one last used:
+ * from oqCache, moving it to the front, or else by opening it. If that takes oqCache beyond
+ * replyQCacheSize, the least recently used queue is closed.
+ */
+MQIQueue * Responder::openReplyQueue(MQMD const & md){
+  CPHTRACEENTRY(pConfig->pTrc)
   CPHTRACEMSG(pConfig->pTrc, "Reply-to-Q-Mgr [%*.*s]", MQ_Q_MGR_NAME_LENGTH, MQ_Q_MGR_NAME_LENGTH, md.ReplyToQMgr)
   CPHTRACEMSG(pConfig->pTrc, "Reply-to-queue [%*.*s]", MQ_Q_NAME_LENGTH, MQ_Q_NAME_LENGTH, md.ReplyToQ)
-  dummyOut->setQMName(&md.ReplyToQMgr);
-  dummyOut->setName(&md.ReplyToQ);
-
-  pair<ReplyQCache::iterator, bool> result = oqCache.insert(dummyOut);
-  if(result.second){
-    /*
-     * If we successfully made an insertion,
-     * then this is the first time we're replying to this queue,
-     * so we need to open it.
-     *
-     * Also, nullify dummyOut to make sure we create a new instance next time.
-     */
-    dummyOut->open(true);
-    dummyOut = NULL;
+
+  string key(md.ReplyToQ, sizeof(MQCHAR48));
+  key.append(md.ReplyToQMgr, sizeof(MQCHAR48));
+
+  ReplyQIndex::iterator found = oqIndex.find(key);
+  if(found!=oqIndex.end()){
+    countReplyQ(EVENT_REPLYQ_HIT);
+    oqCache.splice(oqCache.begin(), oqCache, found->second);
+    CPHTRACEEXIT(pConfig->pTrc)
+    return oqCache.front().pQueue;
+  }
+
+  countReplyQ(EVENT_REPLYQ_MISS);
+  MQIQueue * pQueue = new MQIQueue(pConnection, true, false);
+  pQueue->setQMName(&md.ReplyToQMgr);
+  pQueue->setName(&md.ReplyToQ);
+  try {
+    pQueue->open(oqIndex.empty());
+  } catch (...) {
+    delete pQueue;
+    throw;
+  }
+
+  ReplyQEntry entry;
+  memcpy(entry.qName, md.ReplyToQ, sizeof(MQCHAR48));
+  memcpy(entry.qmName, md.ReplyToQMgr, sizeof(MQCHAR48));
+  entry.pQueue = pQueue;
+  oqCache.push_front(entry);
+  oqIndex[key] = oqCache.begin();
+
+  if(replyQCacheSize>0 && oqIndex.size()>replyQCacheSize){
+    ReplyQEntry & lru = oqCache.back();
+    key.assign(lru.qName, sizeof(MQCHAR48));
+    key.append(lru.qmName, sizeof(MQCHAR48));
+    oqIndex.erase(key);
+    delete lru.pQueue;
+    oqCache.pop_back();
+    countReplyQ(EVENT_REPLYQ_EVICTED);
   }
 
   CPHTRACEEXIT(pConfig->pTrc)
-  return *(result.first);
+  return pQueue;
+}
+
+/*
+ * Method: countReplyQ
+ * -------------------
+ *
+ * Count a reply-to-queue cache event in this thread's call statistics, if they're collected.
+ */
+inline void Responder::countReplyQ(CallEvent event){
+  if(pCallStats != NULL) pCallStats->count(event);
 }
 
 void Responder::msgOneIteration(){
@@ -259,6 +253,19 @@ void Responder::msgOneIteration(){
   getMessage->messageLen = 0;
 
   pInQueue->get(getMessage, getMD, gmo);
+  reply(getMD);
+
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+/*
+ * Method: reply
+ * -------------
+ *
+ * Put the reply to the request with the given message descriptor, which is in getMessage if it's to be copied.
+ */
+void Responder::reply(MQMD const & getMD){
+  CPHTRACEENTRY(pConfig->pTrc)
 
   if(pOpts->commitFrequency>0 && commitBetween && (getIterations()+1)%pOpts->commitFrequency==0)
     pConnection->commitTransaction();
@@ -280,4 +287,31 @@ void Responder::msgOneIteration(){
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
+/*
+ * Method: prepareConsumer
+ * -----------------------
+ *
+ * Requests consumed by callback are those got by msgOneIteration.
+ */
+MQIObject * Responder::prepareConsumer(MQMD & md){
+  (void) md;
+  return pInQueue;
+}
+
+/*
+ * Method: consumeMessage
+ * ----------------------
+ *
+ * Reply to a request delivered by callback, copying it into getMessage first if it's to be sent back.
+ */
+void Responder::consumeMessage(MQMD & md, MQBYTE const * const buffer, MQLONG const length){
+  if(copyRequest){
+    if(getMessage->bufferLen < length)
+      getMessage->resize(length);
+    memcpy(getMessage->buffer, buffer, length);
+    getMessage->messageLen = length;
+  }
+  reply(md);
+}
+
 }
@@ -32,65 +32,41 @@
 #include "cphdefs.h"
 #include "MQIWorkerThread.hpp"
 
-#ifdef tr1_inc
-#include tr1_inc(unordered_set)
-#else
-#include <set>
-#endif
+#include <list>
+#include <string>
 
 #include <cmqc.h>
 
 namespace cph {
 
-#ifdef tr1
-
 /*
- * Typedef: MQIQueueHash
- * ---------------------
- *
- * A pointer to a function that generates a hash code from a pointer
- * to an MQIQueue.
- */
-typedef size_t (*MQIQueueHash)(MQIQueue * const);
-
-/*
- * Typedef: MQIQueueEq
+ * Struct: ReplyQEntry
  * -------------------
  *
- * A pointer to a function that determines whether two given pointers
- * to MQIQueues point to equivalent structures.
+ * An open reply-to-queue, with the ReplyToQ and ReplyToQMgr (as found in the MQMD) it was opened for.
  */
-typedef bool (*MQIQueueEq)(MQIQueue * const, MQIQueue * const);
+struct ReplyQEntry {
+  MQCHAR48 qName;
+  MQCHAR48 qmName;
+  MQIQueue * pQueue;
+};
 
 /*
  * Typedef: ReplyQCache
  * --------------------
  *
- * An unordered set of pointers to MQIQueues.
- * Used to cache open reply-to-queues.
- */
-typedef tr1(unordered_set)<MQIQueue *, MQIQueueHash, MQIQueueEq> ReplyQCache;
-
-#else
-
-/*
- * Typedef: MQIQueueCmp
- * --------------------
- *
- * A pointer to a function that determines the relative ordering
- * of two queues referred to by given pointers.
+ * A list of open reply-to-queues, most recently used first.
  */
-typedef bool (*MQIQueueCmp)(MQIQueue * const, MQIQueue * const);
+typedef std::list<ReplyQEntry> ReplyQCache;
 
 /*
- * Typedef: ReplyQCache
+ * Typedef: ReplyQIndex
  * --------------------
  *
- * A set of pointers to MQIQueues.
- * Used to cache open reply-to-queues.
+ * A mapping from the ReplyToQ and ReplyToQMgr of a reply-to-queue (concatenated)
+ * to its entry in a ReplyQCache.
  */
-typedef std::set<MQIQueue *, MQIQueueCmp> ReplyQCache;
-#endif
+typedef hashMap<std::string, ReplyQCache::iterator> ReplyQIndex;
 
 /*
  * Class: Responder
@@ -106,16 +82,21 @@ MQWTCLASSDEF(Responder,
   static bool copyRequest;
   static char iqPrefix[MQ_Q_NAME_LENGTH];
   static bool commitBetween;
+  static unsigned int replyQCacheSize;
 
   /*The queue to get requests from.*/
   MQIObject * pInQueue;
-  /*Cache of reply-to-queues already opened*/
+  /*Cache of reply-to-queues already opened, most recently used first, and its index.*/
   ReplyQCache oqCache;
-
-  /*Dummy object used for querying outCache.*/
-  mutable MQIQueue * dummyOut;
+  ReplyQIndex oqIndex;
 
   inline MQIQueue * getReplyQueue(MQMD const & md);
+  MQIQueue * openReplyQueue(MQMD const & md);
+  inline void countReplyQ(CallEvent event);
+  void reply(MQMD const & getMD);
+
+  virtual MQIObject * prepareConsumer(MQMD & md);
+  virtual void consumeMessage(MQMD & md, MQBYTE const * const buffer, MQLONG const length);
 )
 
 }
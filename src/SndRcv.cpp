@@ -72,6 +72,8 @@ MQWTCONSTRUCTOR(Sender, true, false, false) {
     generateCorrelID(correlId, pControlThread->procId);
   }
 
+  configureOneWayLatency();
+
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
@@ -100,6 +102,7 @@ void Sender::closeDestination() {
 
 void Sender::msgOneIteration() {
   CPHTRACEENTRY(pConfig->pTrc)
+  if(oneWayLatency) stampMessage(putMessage);
   pQueue->put(putMessage, putMD, pmo);
   CPHTRACEEXIT(pConfig->pTrc)
 }
@@ -147,6 +150,9 @@ MQWTCONSTRUCTOR(Receiver, false, true, false) {
     generateCorrelID(correlId, pControlThread->procId, &adjustedClassName);
   }
 
+  configureOneWayLatency();
+  configureCallbackConsumer();
+
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
@@ -188,7 +194,21 @@ void Receiver::msgOneIteration(){
     memcpy(getMD.CorrelId, correlId, sizeof(MQBYTE24));
   }
   pQueue->get(getMessage, getMD, gmo);
+  if(oneWayLatency) recordOneWayLatency(getMessage);
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
+/*
+ * Method: prepareConsumer
+ * -----------------------
+ *
+ * Messages consumed by callback are matched in the same way as those got by msgOneIteration.
+ */
+MQIObject * Receiver::prepareConsumer(MQMD & md){
+  if (useCorrelId && !useSelector) {
+    memcpy(md.CorrelId, correlId, sizeof(MQBYTE24));
+  }
+  return pQueue;
+}
+
 }
@@ -50,6 +50,8 @@ MQWTCLASSDEF(Receiver,
 
   /*The queue to receive messages from*/
   MQIQueue * pQueue;
+
+  virtual MQIObject * prepareConsumer(MQMD & md);
 )
 
 }
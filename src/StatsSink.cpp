@@ -0,0 +1,372 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#include "StatsSink.hpp"
+#include "cphLog.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef CPH_WINDOWS
+#include <io.h>
+#define fdopen _fdopen
+#else
+#include <inttypes.h>
+#endif
+
+/*Size of the stdio buffer used for the output stream.*/
+#define STATS_SINK_BUFFER_SIZE 65536
+
+namespace cph {
+
+/*The percentiles included in each record for each latency distribution.*/
+static double const percentiles[] = {50, 90, 99, 99.9};
+static char const * const percentileNames[] = {"p50", "p90", "p99", "p99.9"};
+#define PERCENTILE_COUNT (sizeof(percentiles)/sizeof(percentiles[0]))
+
+/*
+ * Constructor: StatsSink
+ * ----------------------
+ *
+ * Open the destination, which is either the name of a file (which will be overwritten),
+ * "stdout", "stderr", or "fd:<n>" for an already-open file descriptor.
+ */
+StatsSink::StatsSink(CPH_CONFIG * pConfig, char const * destination, Format format, char const * procId) :
+    Thread(pConfig),
+    fp(NULL),
+    ownsFile(true),
+    format(format),
+    procId(procId),
+    headerWritten(false),
+    closing(false),
+    dropped(0),
+    queueLock(),
+    queue() {
+  CPHTRACEENTRY(pConfig->pTrc)
+
+  if(0 == strcmp(destination, "stdout")){
+    fp = stdout;
+    ownsFile = false;
+  } else if(0 == strcmp(destination, "stderr")){
+    fp = stderr;
+    ownsFile = false;
+  } else if(0 == strncmp(destination, "fd:", 3)){
+    fp = fdopen(atoi(destination + 3), "w");
+  } else {
+    fp = fopen(destination, "w");
+  }
+
+  if(fp == NULL)
+    throw std::runtime_error(std::string("Could not open statistics output: ") + destination);
+  if(ownsFile)
+    setvbuf(fp, NULL, _IOFBF, STATS_SINK_BUFFER_SIZE);
+
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+StatsSink::~StatsSink(){
+  if(fp != NULL){
+    if(ownsFile) fclose(fp);
+    else fflush(fp);
+  }
+}
+
+/*
+ * Method: write
+ * -------------
+ *
+ * Format the given record and queue it to be written. Never waits for the output itself.
+ */
+void StatsSink::write(StatsRecord const &record){
+  std::string line = format == CSV ? formatCsv(record) : formatJson(record);
+
+  queueLock.lock();
+  if(queue.size() < MAX_QUEUED){
+    queue.push_back(line);
+    queueLock.notify();
+  } else {
+    dropped++;
+  }
+  queueLock.unlock();
+}
+
+/*
+ * Method: close
+ * -------------
+ *
+ * Write out any queued records, then stop this thread and wait for it to end.
+ */
+void StatsSink::close(){
+  CPHTRACEENTRY(pConfig->pTrc)
+  queueLock.lock();
+  closing = true;
+  queueLock.notify();
+  queueLock.unlock();
+
+  while(isAlive())
+    Thread::yield();
+
+  if(dropped > 0){
+    char msg[128];
+    snprintf(msg, sizeof(msg), "Statistics output could not keep up: %lu records dropped.", dropped);
+    cphLogPrintLn(pConfig->pLog, LOG_WARNING, msg);
+  }
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+void StatsSink::run(){
+  CPHTRACEENTRY(pConfig->pTrc)
+  std::vector<std::string> batch;
+  bool done = false;
+
+  while(!done){
+    queueLock.lock();
+    while(queue.empty() && !closing)
+      queueLock.wait();
+    batch.swap(queue);
+    done = closing;
+    queueLock.unlock();
+
+    for(std::vector<std::string>::const_iterator it = batch.begin(); it != batch.end(); ++it)
+      fputs(it->c_str(), fp);
+    fflush(fp);
+    batch.clear();
+  }
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+/*
+ * Function: cpuPerIteration
+ * -------------------------
+ *
+ * Returns the CPU time (microseconds) used per iteration in the given record's interval.
+ */
+static double cpuPerIteration(StatsRecord const &record){
+  if(record.iterations == 0) return 0;
+  return (double) (record.cpu->user + record.cpu->system) / 1000 / record.iterations;
+}
+
+/*
+ * Method: formatCsv
+ * -----------------
+ *
+ * Format a record as a CSV row, preceded by a header row for the first record.
+ * The set of columns is fixed by the first record, as the statistics collected
+ * and the number of worker threads don't change during a run.
+ */
+std::string StatsSink::formatCsv(StatsRecord const &record){
+  std::stringstream ss;
+  char buff[256];
+  unsigned int i, type;
+
+  if(!headerWritten){
+    ss << "time,id,duration,threads,failedThreads,rate";
+    if(record.targetRate != NULL) ss << ",targetRate";
+    for(type = 0; type < LATENCY_TYPES; type++){
+      if(record.latency[type] == NULL) continue;
+      char const * prefix = latencyPrefixes[type];
+      ss << "," << prefix << "avg_latency(uSec)";
+      for(i = 0; i < PERCENTILE_COUNT; i++)
+        ss << "," << prefix << percentileNames[i] << "_latency(uSec)";
+      ss << "," << prefix << "max_latency(uSec)," << prefix << "min_latency(uSec)";
+    }
+    if(record.calls != NULL){
+      ss << ",callFailures";
+      for(i = 0; i < EVENT_TYPES; i++)
+        ss << "," << CallStats::eventNames[i];
+    }
+    if(record.cpu != NULL) ss << ",cpu_user(sec),cpu_system(sec),cpu_per_iteration(uSec)";
+    if(record.resources != NULL)
+      ss << ",rss(KB),peak_rss(KB),vsz(KB),fds,os_threads,vol_cs,invol_cs,minor_faults,major_faults";
+    for(i = 0; i < record.threadRates.size(); i++)
+      ss << ",rate" << i;
+    ss << "\n";
+    headerWritten = true;
+  }
+
+  /* Quote the id, in case it contains a comma */
+  std::string id;
+  for(std::string::const_iterator it = procId.begin(); it != procId.end(); ++it){
+    if(*it == '"') id += '"';
+    id += *it;
+  }
+
+  snprintf(buff, sizeof(buff), "%" PRId64 ",\"%s\",%.3f,%u,%u,%.2f",
+      (int64_t) record.time, id.data(), record.duration, record.running, record.failed, record.rate);
+  ss << buff;
+
+  if(record.targetRate != NULL){
+    snprintf(buff, sizeof(buff), ",%.2f", *record.targetRate);
+    ss << buff;
+  }
+
+  for(type = 0; type < LATENCY_TYPES; type++){
+    Histogram const * h = record.latency[type];
+    if(h == NULL) continue;
+    snprintf(buff, sizeof(buff), ",%.0f", h->getMean());
+    ss << buff;
+    for(i = 0; i < PERCENTILE_COUNT; i++){
+      snprintf(buff, sizeof(buff), ",%" PRIu64, h->getValueAtPercentile(percentiles[i]));
+      ss << buff;
+    }
+    snprintf(buff, sizeof(buff), ",%" PRIu64 ",%" PRIu64, h->getMaxValue(), h->getMinValue());
+    ss << buff;
+  }
+
+  if(record.calls != NULL){
+    uint64_t failures = 0;
+    for(type = 0; type < CALL_TYPES; type++)
+      failures += record.calls->getFailures((CallType) type);
+    snprintf(buff, sizeof(buff), ",%" PRIu64, failures);
+    ss << buff;
+    for(i = 0; i < EVENT_TYPES; i++){
+      snprintf(buff, sizeof(buff), ",%" PRIu64, record.calls->getEvents((CallEvent) i));
+      ss << buff;
+    }
+  }
+
+  if(record.cpu != NULL){
+    snprintf(buff, sizeof(buff), ",%.3f,%.3f,%.2f", (double) record.cpu->user / 1000000000,
+        (double) record.cpu->system / 1000000000, cpuPerIteration(record));
+    ss << buff;
+  }
+
+  if(record.resources != NULL){
+    ProcessResources const * r = record.resources;
+    snprintf(buff, sizeof(buff), ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64,
+        r->rss, r->peakRss, r->virtualSize, r->openFiles, r->threads,
+        r->voluntarySwitches, r->involuntarySwitches, r->minorFaults, r->majorFaults);
+    ss << buff;
+  }
+
+  for(i = 0; i < record.threadRates.size(); i++){
+    snprintf(buff, sizeof(buff), ",%.2f", record.threadRates[i]);
+    ss << buff;
+  }
+  ss << "\n";
+  return ss.str();
+}
+
+/*
+ * Method: formatJson
+ * ------------------
+ *
+ * Format a record as a single-line JSON object.
+ */
+std::string StatsSink::formatJson(StatsRecord const &record) const {
+  std::stringstream ss;
+  char buff[256];
+  unsigned int i, type;
+
+  std::string id;
+  for(std::string::const_iterator it = procId.begin(); it != procId.end(); ++it){
+    if(*it == '"' || *it == '\\') id += '\\';
+    if((unsigned char) *it >= 0x20) id += *it;
+  }
+
+  snprintf(buff, sizeof(buff),
+      "{\"time\":%" PRId64 ",\"id\":\"%s\",\"duration\":%.3f,\"threads\":%u,\"failedThreads\":%u,\"rate\":%.2f",
+      (int64_t) record.time, id.data(), record.duration, record.running, record.failed, record.rate);
+  ss << buff;
+
+  if(record.targetRate != NULL){
+    snprintf(buff, sizeof(buff), ",\"targetRate\":%.2f", *record.targetRate);
+    ss << buff;
+  }
+
+  ss << ",\"threadRates\":[";
+  for(i = 0; i < record.threadRates.size(); i++){
+    snprintf(buff, sizeof(buff), i == 0 ? "%.2f" : ",%.2f", record.threadRates[i]);
+    ss << buff;
+  }
+  ss << "]";
+
+  for(type = 0; type < LATENCY_TYPES; type++){
+    Histogram const * h = record.latency[type];
+    if(h == NULL) continue;
+    snprintf(buff, sizeof(buff), ",\"%slatency\":{\"count\":%" PRIu64 ",\"avg\":%.0f",
+        latencyPrefixes[type], h->getTotalCount(), h->getMean());
+    ss << buff;
+    for(i = 0; i < PERCENTILE_COUNT; i++){
+      snprintf(buff, sizeof(buff), ",\"%s\":%" PRIu64, percentileNames[i], h->getValueAtPercentile(percentiles[i]));
+      ss << buff;
+    }
+    snprintf(buff, sizeof(buff), ",\"max\":%" PRIu64 ",\"min\":%" PRIu64 "}", h->getMaxValue(), h->getMinValue());
+    ss << buff;
+  }
+
+  if(record.calls != NULL){
+    ss << ",\"calls\":{";
+    bool first = true;
+    uint64_t failures = 0;
+    for(type = 0; type < CALL_TYPES; type++){
+      uint64_t calls = record.calls->getCalls((CallType) type);
+      if(calls == 0) continue;
+      snprintf(buff, sizeof(buff), "%s\"%s\":{\"count\":%" PRIu64 ",\"failed\":%" PRIu64 ",\"avg\":%.1f}",
+          first ? "" : ",", CallStats::callNames[type], calls, record.calls->getFailures((CallType) type),
+          (double) record.calls->getTotalTime((CallType) type) / calls / 1000);
+      ss << buff;
+      first = false;
+      failures += record.calls->getFailures((CallType) type);
+    }
+    snprintf(buff, sizeof(buff), "},\"callFailures\":%" PRIu64, failures);
+    ss << buff;
+
+    ss << ",\"events\":{";
+    first = true;
+    for(i = 0; i < EVENT_TYPES; i++){
+      uint64_t events = record.calls->getEvents((CallEvent) i);
+      if(events == 0) continue;
+      snprintf(buff, sizeof(buff), "%s\"%s\":%" PRIu64, first ? "" : ",", CallStats::eventNames[i], events);
+      ss << buff;
+      first = false;
+    }
+    ss << "}";
+  }
+
+  if(record.cpu != NULL){
+    snprintf(buff, sizeof(buff), ",\"cpu\":{\"user\":%.3f,\"system\":%.3f,\"perIteration\":%.2f}",
+        (double) record.cpu->user / 1000000000, (double) record.cpu->system / 1000000000, cpuPerIteration(record));
+    ss << buff;
+  }
+
+  if(record.resources != NULL){
+    ProcessResources const * r = record.resources;
+    snprintf(buff, sizeof(buff), ",\"process\":{\"rss\":%" PRIu64 ",\"peakRss\":%" PRIu64 ",\"vsz\":%" PRIu64
+        ",\"fds\":%" PRIu64 ",\"threads\":%" PRIu64 ",\"voluntarySwitches\":%" PRIu64 ",\"involuntarySwitches\":%" PRIu64
+        ",\"minorFaults\":%" PRIu64 ",\"majorFaults\":%" PRIu64 "}",
+        r->rss, r->peakRss, r->virtualSize, r->openFiles, r->threads,
+        r->voluntarySwitches, r->involuntarySwitches, r->minorFaults, r->majorFaults);
+    ss << buff;
+  }
+
+  ss << "}\n";
+  return ss.str();
+}
+
+}
@@ -0,0 +1,120 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#ifndef STATSSINK_HPP_
+#define STATSSINK_HPP_
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "Thread.hpp"
+#include "Lock.hpp"
+#include "Histogram.hpp"
+#include "CallStats.hpp"
+#include "ProcessResources.hpp"
+
+namespace cph {
+
+/*
+ * Struct: StatsRecord
+ * -------------------
+ *
+ * The statistics for a single reporting interval, as passed to a StatsSink.
+ */
+struct StatsRecord {
+  /*Time at the end of the interval (milliseconds since the epoch).*/
+  MQINT64 time;
+  /*Length of the interval (seconds).*/
+  double duration;
+  /*Number of worker threads running, and that have stopped with an error.*/
+  unsigned int running;
+  unsigned int failed;
+  /*Total and per-thread iteration rates (iterations/second).*/
+  double rate;
+  std::vector<double> threadRates;
+  /*Total rate (iterations/second) called for by the threads' target rates (rt, pf or gr), or NULL if not pacing.*/
+  double const * targetRate;
+  /*Total iterations completed in the interval.*/
+  uint64_t iterations;
+  /*CPU time used by all worker threads in the interval, or NULL if not collected.*/
+  CpuTime const * cpu;
+  /*Resource usage of the process (with context switches and page faults for the interval), or NULL if not collected.*/
+  ProcessResources const * resources;
+  /*Latency distributions for the interval, by LatencyType, or NULL if not collected.*/
+  Histogram const * latency[LATENCY_TYPES];
+  /*MQI call statistics for the interval, or NULL if not collected.*/
+  CallStats const * calls;
+};
+
+/*
+ * Class: StatsSink
+ * ----------------
+ *
+ * Extends: Thread
+ *
+ * Writes one machine-readable record (a CSV row or a JSON object on its own line)
+ * per reporting interval to a file or file descriptor.
+ *
+ * Records are formatted by the caller of write() and queued; they're written out
+ * through a large stdio buffer by this thread, so a slow or blocked destination never
+ * holds up the stats thread. If the queue fills, further records are dropped and counted.
+ */
+class StatsSink : public Thread {
+public:
+  enum Format { CSV, JSON };
+
+  static size_t const MAX_QUEUED = 1024;
+
+  StatsSink(CPH_CONFIG * pConfig, char const * destination, Format format, char const * procId);
+  virtual ~StatsSink();
+
+  void write(StatsRecord const &record);
+  void close();
+
+protected:
+  virtual void run();
+
+private:
+  FILE * fp;
+  bool ownsFile;
+  Format const format;
+  std::string const procId;
+  bool headerWritten;
+  bool closing;
+  unsigned long dropped;
+
+  Lock queueLock;
+  std::vector<std::string> queue;
+
+  std::string formatCsv(StatsRecord const &record);
+  std::string formatJson(StatsRecord const &record) const;
+};
+
+}
+
+#endif /* STATSSINK_HPP_ */
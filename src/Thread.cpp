@@ -36,14 +36,45 @@
 #include <sys/select.h>
 #endif
 
+#if defined(__linux__)
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#elif defined(CPH_OSX)
+#include <mach/mach.h>
+#elif !defined(CPH_WINDOWS)
+#include <time.h>
+#endif
+
 #define MAX_QUICKSLEEP_DURATION 1000
 
 namespace cph {
 
-Thread::Thread(CPH_CONFIG* pConfig) : shutdown(false), pConfig(pConfig), id(0), alive(false), shutdownLock() {}
+size_t Thread::stackSize = 0;
+
+Thread::Thread(CPH_CONFIG* pConfig) : shutdown(false), pConfig(pConfig), id(0), alive(false), shutdownLock() {
+#ifdef CPH_WINDOWS
+  handle = NULL;
+#else
+  kernelId = 0;
+#endif
+}
 Thread::Thread(CPH_CONFIG* pConfig, bool const attach) :
-    shutdown(false), pConfig(pConfig), id(attach ? getCurrentThreadId() : 0), alive(attach), shutdownLock() {}
-Thread::~Thread(){}
+    shutdown(false), pConfig(pConfig), id(attach ? getCurrentThreadId() : 0), alive(attach), shutdownLock() {
+#ifdef CPH_WINDOWS
+  handle = NULL;
+#else
+  handle = pthread_self();
+  kernelId = 0;
+#endif
+}
+Thread::~Thread(){
+#ifdef CPH_WINDOWS
+  if(handle != NULL) CloseHandle(handle);
+#endif
+}
 
 /*
  * Method: isAlive
@@ -98,6 +129,9 @@ void Thread::checkShutdown() const {
 CPH_THREAD_RUN _thread_run(void* t) {
   Thread* th = (Thread*) t;
   CPHTRACEENTRY(th->pConfig->pTrc)
+#if defined(__linux__)
+  th->kernelId = (long) syscall(SYS_gettid);
+#endif
   th->alive = true;
   try {
     th->run();
@@ -125,10 +159,15 @@ bool Thread::start(){
   if(!shutdown && id==0){
 #ifdef CPH_WINDOWS
     DWORD tid;
-    if(NULL == CreateThread(NULL, 0, _thread_run, this, 0, &tid)){
+    if(NULL == (handle = CreateThread(NULL, stackSize, _thread_run, this, stackSize > 0 ? STACK_SIZE_PARAM_IS_A_RESERVATION : 0, &tid))){
 #else //#elif defined(CPH_UNIX)
     pthread_t tid;
-    if ((ret = pthread_create(&tid, NULL, _thread_run, this)) != 0) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if(stackSize > 0) pthread_attr_setstacksize(&attr, stackSize);
+    ret = pthread_create(&tid, &attr, _thread_run, this);
+    pthread_attr_destroy(&attr);
+    if (ret != 0) {
 #endif
       CPHTRACEMSG(pConfig->pTrc, (char*) "Failed to spawn new thread.")
 	  if (ret) {
@@ -142,6 +181,9 @@ bool Thread::start(){
     id = ((uint64_t) tid.reservedHiId << (sizeof(unsigned int) << 3)) + tid.reservedLoId;
 #else
     id = (uint64_t) tid;
+#endif
+#ifndef CPH_WINDOWS
+    handle = tid;
 #endif
   } else {
     CPHTRACEMSG(pConfig->pTrc, (char*) "Cannot spawn new thread. Either thread already started, or signalShutdown called.")
@@ -151,6 +193,120 @@ bool Thread::start(){
   return rc;
 }
 
+/*
+ * Static Method: setStackSize
+ * ---------------------------
+ *
+ * Set the stack size (bytes) of threads started from now on, or 0 for the platform default.
+ *
+ * Returns: false if the size isn't valid on this platform (e.g. below the minimum), true otherwise.
+ */
+bool Thread::setStackSize(size_t bytes){
+#ifndef CPH_WINDOWS
+  if(bytes > 0){
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    int ret = pthread_attr_setstacksize(&attr, bytes);
+    pthread_attr_destroy(&attr);
+    if(ret != 0) return false;
+  }
+#endif
+  stackSize = bytes;
+  return true;
+}
+
+/*
+ * Method: getCpuTime
+ * ------------------
+ *
+ * Find the CPU time used so far by this thread, which must be running.
+ * Where the platform only provides the total, it is all counted as user time;
+ * on Linux the total is split in the proportions given by /proc/self/task/<tid>/stat.
+ *
+ * Returns: true if the CPU time could be found, false otherwise.
+ */
+bool Thread::getCpuTime(CpuTime &cpu) const {
+  if(id == 0 || !alive) return false;
+  cpu.userTicks = cpu.systemTicks = 0;
+#if defined(CPH_WINDOWS)
+  FILETIME creation, exit, kernel, user;
+  if(!GetThreadTimes(handle, &creation, &exit, &kernel, &user)) return false;
+  cpu.user = ((((uint64_t) user.dwHighDateTime) << 32) + user.dwLowDateTime) * 100;
+  cpu.system = ((((uint64_t) kernel.dwHighDateTime) << 32) + kernel.dwLowDateTime) * 100;
+  return true;
+#elif defined(CPH_OSX)
+  thread_basic_info_data_t info;
+  mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
+  if(KERN_SUCCESS != thread_info((thread_act_t) id, THREAD_BASIC_INFO, (thread_info_t) &info, &count)) return false;
+  cpu.user = (uint64_t) info.user_time.seconds * 1000000000 + (uint64_t) info.user_time.microseconds * 1000;
+  cpu.system = (uint64_t) info.system_time.seconds * 1000000000 + (uint64_t) info.system_time.microseconds * 1000;
+  return true;
+#elif defined(CPH_IBMI)
+  return false;
+#else
+  clockid_t clock;
+  struct timespec ts;
+  if(0 != pthread_getcpuclockid(handle, &clock) || 0 != clock_gettime(clock, &ts)) return false;
+  uint64_t total = (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+  cpu.user = total;
+  cpu.system = 0;
+#if defined(__linux__)
+  char path[64], line[512];
+  snprintf(path, sizeof(path), "/proc/self/task/%ld/stat", (long) kernelId);
+  FILE * fp = kernelId == 0 ? NULL : fopen(path, "r");
+  if(fp != NULL){
+    /* Skip the command name (which may contain spaces) and fields 3-13 to reach utime and stime (clock ticks) */
+    char const * fields = fgets(line, sizeof(line), fp) == NULL ? NULL : strrchr(line, ')');
+    unsigned long utime, stime;
+    if(fields != NULL && 2 == sscanf(fields + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime)
+        && utime + stime > 0){
+      cpu.system = (uint64_t) ((double) total * stime / (utime + stime));
+      cpu.user = total - cpu.system;
+      cpu.userTicks = utime;
+      cpu.systemTicks = stime;
+    }
+    fclose(fp);
+  }
+#endif
+  return true;
+#endif
+}
+
+/*
+ * Function: addCpuInterval
+ * ------------------------
+ *
+ * Add the CPU time a thread used between two samples of it to the given interval.
+ *
+ * When the samples were split into user and system time by clock ticks, a later sample's share of either
+ * can be less than an earlier one's, so the interval's total is found from the sample totals, then split
+ * by the ticks counted in the interval (or, if none were, by the later sample's ticks). Decreases, as from
+ * a thread in a different slot, count as zero.
+ */
+void addCpuInterval(CpuTime &interval, CpuTime const &now, CpuTime const &then){
+  uint64_t const nowTotal = now.user + now.system;
+  uint64_t const thenTotal = then.user + then.system;
+  uint64_t const total = nowTotal > thenTotal ? nowTotal - thenTotal : 0;
+
+  if(now.userTicks + now.systemTicks == 0){
+    uint64_t const user = now.user > then.user ? now.user - then.user : 0;
+    uint64_t const system = now.system > then.system ? now.system - then.system : 0;
+    interval.user += user;
+    interval.system += system;
+    return;
+  }
+
+  uint64_t userTicks = now.userTicks > then.userTicks ? now.userTicks - then.userTicks : 0;
+  uint64_t systemTicks = now.systemTicks > then.systemTicks ? now.systemTicks - then.systemTicks : 0;
+  if(userTicks + systemTicks == 0){
+    userTicks = now.userTicks;
+    systemTicks = now.systemTicks;
+  }
+  uint64_t const system = (uint64_t) ((double) total * systemTicks / (userTicks + systemTicks));
+  interval.system += system;
+  interval.user += total - system;
+}
+
 void Thread::sleep(int millis) const {
   CPHTRACEENTRY(pConfig->pTrc);
   assert(id==getCurrentThreadId());
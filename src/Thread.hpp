@@ -49,6 +49,24 @@
 
 namespace cph {
 
+/*
+ * Struct: CpuTime
+ * ---------------
+ *
+ * The CPU time (nanoseconds) used by a thread, in user and system (kernel) mode.
+ *
+ * Where only the total is precise, and it's split between user and system by their clock ticks,
+ * the ticks are kept too (otherwise they're zero), for addCpuInterval to split intervals by.
+ */
+struct CpuTime {
+  uint64_t user;
+  uint64_t system;
+  uint64_t userTicks;
+  uint64_t systemTicks;
+};
+
+void addCpuInterval(CpuTime &interval, CpuTime const &now, CpuTime const &then);
+
 /*
  * Class: Thread
  * -------------
@@ -82,9 +100,11 @@ public:
   uint64_t getId() const;
   bool isAlive() const;
   void checkShutdown() const;
+  virtual bool getCpuTime(CpuTime &cpu) const;
 
   static uint64_t getCurrentThreadId();
   static void yield();
+  static bool setStackSize(size_t bytes);
 
 protected:
   /*
@@ -108,8 +128,18 @@ protected:
   void sleep(int millis) const;
 
 private:
+  /*The stack size (bytes) of new threads, or 0 for the platform default.*/
+  static size_t stackSize;
+
   uint64_t id;
   bool alive;
+#ifdef CPH_WINDOWS
+  HANDLE handle;
+#else
+  pthread_t handle;
+  /*The kernel's id for the thread (Linux only), set when it starts running.*/
+  volatile long kernelId;
+#endif
   mutable Lock shutdownLock;
 
   friend CPH_THREAD_RUN _thread_run(void* t);
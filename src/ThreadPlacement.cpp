@@ -0,0 +1,372 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#include "ThreadPlacement.hpp"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(WIN32) || defined(WIN64)
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
+/*The scheduling policy value meaning the policy is left as it is.*/
+#define CPH_SCHED_UNCHANGED -1
+
+namespace cph {
+
+/*
+ * Struct: CpuInfo
+ * ---------------
+ *
+ * The position of a CPU in the machine, used to order the CPUs of a ThreadPlacement.
+ */
+struct CpuInfo {
+  int cpu;
+  int socket;
+  int core;
+  /*The position of this CPU among the hardware threads of its core.*/
+  int rank;
+};
+
+static bool compactOrder(CpuInfo const &a, CpuInfo const &b){
+  if(a.socket != b.socket) return a.socket < b.socket;
+  if(a.core != b.core) return a.core < b.core;
+  return a.cpu < b.cpu;
+}
+
+static bool scatterOrder(CpuInfo const &a, CpuInfo const &b){
+  if(a.socket != b.socket) return a.socket < b.socket;
+  if(a.rank != b.rank) return a.rank < b.rank;
+  if(a.core != b.core) return a.core < b.core;
+  return a.cpu < b.cpu;
+}
+
+ThreadPlacement::ThreadPlacement() : cpus(), policy(CPH_SCHED_UNCHANGED), priority(0) {}
+
+/*
+ * Method: setCpus
+ * ---------------
+ *
+ * Set the CPUs to pin threads to, from a list of CPU numbers and ranges (e.g. "0-3,8,10-11"),
+ * and the order in which threads are placed on them. An empty list leaves threads unpinned.
+ *
+ * Throws: std::runtime_error if the list isn't valid, or threads can't be pinned on this platform.
+ */
+void ThreadPlacement::setCpus(char const * cpuList, Mode mode){
+  cpus.clear();
+  if(cpuList == NULL || *cpuList == '\0') return;
+
+#if defined(WIN32) || defined(WIN64)
+  int const maxCpu = (int) (sizeof(DWORD_PTR) * 8) - 1;
+#elif defined(__linux__)
+  int const maxCpu = CPU_SETSIZE - 1;
+#else
+  int const maxCpu = -1;
+  throw std::runtime_error("Pinning threads to CPUs is not supported on this platform.");
+#endif
+
+  char const * p = cpuList;
+  while(*p != '\0'){
+    char * end;
+    long first = strtol(p, &end, 10), last;
+    if(end == p || first < 0) throw std::runtime_error(std::string("Invalid CPU list: ") + cpuList);
+    p = end;
+    if(*p == '-'){
+      last = strtol(++p, &end, 10);
+      if(end == p || last < first) throw std::runtime_error(std::string("Invalid CPU list: ") + cpuList);
+      p = end;
+    } else
+      last = first;
+    if(last > maxCpu){
+      std::stringstream ss;
+      ss << "CPU " << last << " is beyond the highest that can be used (" << maxCpu << ").";
+      throw std::runtime_error(ss.str());
+    }
+    for(long cpu = first; cpu <= last; cpu++)
+      if(std::find(cpus.begin(), cpus.end(), (int) cpu) == cpus.end())
+        cpus.push_back((int) cpu);
+    if(*p == ',') p++;
+    else if(*p != '\0') throw std::runtime_error(std::string("Invalid CPU list: ") + cpuList);
+  }
+
+  if(mode == ROUND_ROBIN) return;
+
+  std::vector<CpuInfo> infos;
+  for(std::vector<int>::const_iterator it = cpus.begin(); it != cpus.end(); ++it){
+    CpuInfo info;
+    info.cpu = *it;
+    info.socket = readTopology(*it, "physical_package_id");
+    info.core = readTopology(*it, "core_id");
+    if(info.socket < 0) info.socket = 0;
+    if(info.core < 0) info.core = *it;
+    info.rank = 0;
+    infos.push_back(info);
+  }
+  for(std::vector<CpuInfo>::iterator it = infos.begin(); it != infos.end(); ++it)
+    for(std::vector<CpuInfo>::const_iterator other = infos.begin(); other != infos.end(); ++other)
+      if(other->socket == it->socket && other->core == it->core && other->cpu < it->cpu) it->rank++;
+
+  cpus.clear();
+  if(mode == COMPACT){
+    std::sort(infos.begin(), infos.end(), compactOrder);
+    for(std::vector<CpuInfo>::const_iterator it = infos.begin(); it != infos.end(); ++it)
+      cpus.push_back(it->cpu);
+  } else {
+    // Take the next CPU of each socket in turn
+    std::sort(infos.begin(), infos.end(), scatterOrder);
+    std::vector<std::vector<int> > sockets;
+    int lastSocket = -1;
+    for(std::vector<CpuInfo>::const_iterator it = infos.begin(); it != infos.end(); ++it){
+      if(sockets.empty() || it->socket != lastSocket) sockets.push_back(std::vector<int>());
+      sockets.back().push_back(it->cpu);
+      lastSocket = it->socket;
+    }
+    for(size_t i = 0; cpus.size() < infos.size(); i++)
+      for(size_t s = 0; s < sockets.size(); s++)
+        if(i < sockets[s].size()) cpus.push_back(sockets[s][i]);
+  }
+}
+
+/*
+ * Method: setScheduling
+ * ---------------------
+ *
+ * Set the scheduling policy (default, other, batch, idle, fifo or rr) to give threads, with the
+ * given priority: the real-time priority for fifo and rr, otherwise the nice value (Linux only).
+ * The default policy leaves threads as they are.
+ *
+ * Throws: std::runtime_error if the policy or priority isn't valid on this platform.
+ */
+void ThreadPlacement::setScheduling(char const * policyName, int priority){
+  this->priority = priority;
+  policy = CPH_SCHED_UNCHANGED;
+  if(policyName == NULL || *policyName == '\0' || 0 == strcmp(policyName, "default")) return;
+
+#if defined(WIN32) || defined(WIN64)
+  throw std::runtime_error("Setting the scheduling policy of threads is not supported on this platform.");
+#else
+  if(0 == strcmp(policyName, "other")) policy = SCHED_OTHER;
+  else if(0 == strcmp(policyName, "fifo")) policy = SCHED_FIFO;
+  else if(0 == strcmp(policyName, "rr")) policy = SCHED_RR;
+#if defined(__linux__)
+  else if(0 == strcmp(policyName, "batch")) policy = SCHED_BATCH;
+  else if(0 == strcmp(policyName, "idle")) policy = SCHED_IDLE;
+#endif
+  else
+    throw std::runtime_error(std::string("Unknown or unsupported scheduling policy: ") + policyName);
+
+  if(policy == SCHED_FIFO || policy == SCHED_RR){
+    if(priority < sched_get_priority_min(policy) || priority > sched_get_priority_max(policy)){
+      std::stringstream ss;
+      ss << "The priority for " << policyName << " must be from " << sched_get_priority_min(policy)
+          << " to " << sched_get_priority_max(policy) << ".";
+      throw std::runtime_error(ss.str());
+    }
+  } else {
+#if defined(__linux__)
+    if(priority < -20 || priority > 19)
+      throw std::runtime_error("The nice value must be from -20 to 19.");
+#else
+    if(priority != 0)
+      throw std::runtime_error("Setting the nice value of threads is not supported on this platform.");
+#endif
+  }
+#endif
+}
+
+/*
+ * Method: isPinning
+ * -----------------
+ *
+ * Returns true if threads are pinned to CPUs.
+ */
+bool ThreadPlacement::isPinning() const {
+  return !cpus.empty();
+}
+
+/*
+ * Method: isEnabled
+ * -----------------
+ *
+ * Returns true if threads are pinned to CPUs or given a scheduling policy, so apply() has something to do.
+ */
+bool ThreadPlacement::isEnabled() const {
+  return !cpus.empty() || policy != CPH_SCHED_UNCHANGED;
+}
+
+/*
+ * Method: getCpu
+ * --------------
+ *
+ * Returns the CPU the thread with the given index is pinned to, or -1 if threads aren't pinned.
+ */
+int ThreadPlacement::getCpu(unsigned int index) const {
+  return cpus.empty() ? -1 : cpus[index % cpus.size()];
+}
+
+/*
+ * Method: apply
+ * -------------
+ *
+ * Pin the calling thread, as the thread with the given index, to its CPU and set its scheduling policy,
+ * returning a description of where and how it is then running (e.g. "cpu=3,node=0,policy=fifo,priority=10").
+ *
+ * Throws: std::runtime_error if the placement can't be applied (e.g. for lack of privileges).
+ */
+std::string ThreadPlacement::apply(unsigned int index) const {
+  std::stringstream ss;
+  int const cpu = getCpu(index);
+
+#if defined(WIN32) || defined(WIN64)
+  if(cpu >= 0 && 0 == SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR) 1 << cpu)){
+    ss << "Could not pin thread to CPU " << cpu << " (error " << GetLastError() << ").";
+    throw std::runtime_error(ss.str());
+  }
+  int const current = (int) GetCurrentProcessorNumber();
+  ss << "cpu=" << current << (cpu < 0 ? " (not pinned)" : "") << ",node=" << getNode(current)
+      << ",priority=" << GetThreadPriority(GetCurrentThread());
+#else
+  int rc;
+#if defined(__linux__)
+  if(cpu >= 0){
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    if(0 != (rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set))){
+      ss << "Could not pin thread to CPU " << cpu << ": " << strerror(rc);
+      throw std::runtime_error(ss.str());
+    }
+  }
+#endif
+
+  if(policy != CPH_SCHED_UNCHANGED){
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    if(policy == SCHED_FIFO || policy == SCHED_RR) param.sched_priority = priority;
+    if(0 != (rc = pthread_setschedparam(pthread_self(), policy, &param))){
+      ss << "Could not set thread scheduling policy: " << strerror(rc);
+      throw std::runtime_error(ss.str());
+    }
+#if defined(__linux__)
+    // On Linux, the nice value applies to the thread rather than the process
+    if(policy != SCHED_FIFO && policy != SCHED_RR
+        && 0 != setpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid), priority)){
+      ss << "Could not set thread nice value: " << strerror(errno);
+      throw std::runtime_error(ss.str());
+    }
+#endif
+  }
+
+  int actualPolicy;
+  struct sched_param param;
+  if(0 != pthread_getschedparam(pthread_self(), &actualPolicy, &param)) actualPolicy = CPH_SCHED_UNCHANGED;
+
+#if defined(__linux__)
+  int const current = sched_getcpu();
+  ss << "cpu=" << current << (cpu < 0 ? " (not pinned)" : "") << ",node=" << getNode(current) << ",";
+#endif
+  switch(actualPolicy){
+  case SCHED_FIFO: ss << "policy=fifo,priority=" << param.sched_priority; break;
+  case SCHED_RR: ss << "policy=rr,priority=" << param.sched_priority; break;
+#if defined(__linux__)
+  case SCHED_BATCH: ss << "policy=batch,nice=" << getpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid)); break;
+  case SCHED_IDLE: ss << "policy=idle"; break;
+  case SCHED_OTHER: ss << "policy=other,nice=" << getpriority(PRIO_PROCESS, (id_t) syscall(SYS_gettid)); break;
+#else
+  case SCHED_OTHER: ss << "policy=other"; break;
+#endif
+  default: ss << "policy=unknown"; break;
+  }
+#endif
+  return ss.str();
+}
+
+/*
+ * Static Method: getNode
+ * ----------------------
+ *
+ * Returns the NUMA node of the given CPU, or -1 if not known.
+ */
+int ThreadPlacement::getNode(int cpu){
+#if defined(__linux__)
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+  DIR * dir = opendir(path);
+  if(dir == NULL) return -1;
+  int node = -1;
+  struct dirent * entry;
+  while(node < 0 && NULL != (entry = readdir(dir)))
+    if(0 == strncmp(entry->d_name, "node", 4) && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+      node = atoi(entry->d_name + 4);
+  closedir(dir);
+  // Without NUMA support in the kernel there are no node links, and everything is on node 0
+  return node < 0 ? 0 : node;
+#else
+  (void) cpu;
+  return -1;
+#endif
+}
+
+/*
+ * Static Method: readTopology
+ * ---------------------------
+ *
+ * Returns the value of the given file in the topology directory of the given CPU (Linux only), or -1.
+ */
+int ThreadPlacement::readTopology(int cpu, char const * file){
+  int value = -1;
+#if defined(__linux__)
+  char path[128];
+  snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/%s", cpu, file);
+  FILE * fp = fopen(path, "r");
+  if(fp != NULL){
+    if(1 != fscanf(fp, "%d", &value)) value = -1;
+    fclose(fp);
+  }
+#else
+  (void) cpu;
+  (void) file;
+#endif
+  return value;
+}
+
+}
@@ -0,0 +1,81 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#ifndef THREADPLACEMENT_HPP_
+#define THREADPLACEMENT_HPP_
+
+#include <string>
+#include <vector>
+
+namespace cph {
+
+/*
+ * Class: ThreadPlacement
+ * ----------------------
+ *
+ * Where, and with what scheduling policy, each WorkerThread runs.
+ *
+ * Given a list of CPUs, the n'th thread is pinned to the n'th CPU of that list (wrapping round),
+ * once the list has been put in the order given by the placement mode:
+ *
+ *   roundrobin - the order given
+ *   compact    - by socket, then core, so that threads fill the hardware threads of one core,
+ *                then the cores of one socket, before moving on
+ *   scatter    - alternating between sockets, using one hardware thread of every core of each
+ *                socket before using any core's second hardware thread
+ *
+ * Sockets and cores are found from /sys on Linux; elsewhere all CPUs are taken to be separate
+ * cores of one socket. The placement is applied by each thread to itself, with apply().
+ */
+class ThreadPlacement {
+public:
+  enum Mode { ROUND_ROBIN, COMPACT, SCATTER };
+
+  ThreadPlacement();
+
+  void setCpus(char const * cpuList, Mode mode);
+  void setScheduling(char const * policy, int priority);
+  bool isPinning() const;
+  bool isEnabled() const;
+  int getCpu(unsigned int index) const;
+  std::string apply(unsigned int index) const;
+
+  static int getNode(int cpu);
+
+private:
+  /*The CPUs to pin threads to, in placement order; empty if threads aren't pinned.*/
+  std::vector<int> cpus;
+  /*The scheduling policy (a SCHED_ value), or -1 to leave it unchanged.*/
+  int policy;
+  int priority;
+
+  static int readTopology(int cpu, char const * file);
+};
+
+}
+
+#endif /* THREADPLACEMENT_HPP_ */
@@ -0,0 +1,194 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#include "TokenBucket.hpp"
+#include <math.h>
+#include <string.h>
+#include <stdexcept>
+#include <string>
+
+#if defined(WIN32) || defined(WIN64)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/*The time (s) each thread claims tokens for at once, so the shared state is updated at most this often per thread.*/
+#define CPH_TOKEN_BATCH_TIME 0.001
+/*A shared next token time this far (s) in the future is left from before a reboot, and is discarded.*/
+#define CPH_TOKEN_STALE_TIME 60
+
+namespace cph {
+
+TokenBucket::TokenBucket() :
+    pState(NULL), mapped(false), rate(0), interval(0), batchSize(0), burst(0) {
+  memset(&localState, 0, sizeof(localState));
+}
+
+TokenBucket::~TokenBucket(){
+  if(mapped){
+#if defined(WIN32) || defined(WIN64)
+    UnmapViewOfFile(pState);
+#else
+    munmap(pState, sizeof(TokenBucketState));
+#endif
+  }
+}
+
+/*
+ * Method: open
+ * ------------
+ *
+ * Start issuing tokens at the given rate (tokens/second). If fileName is not NULL or empty,
+ * the state of the bucket is kept in that file (created if need be), so that every process
+ * opening the same file shares the one rate; all of them should give the same rate.
+ *
+ * Throws: std::runtime_error if the file can't be mapped, or isn't a token bucket file.
+ */
+void TokenBucket::open(double rate, char const * fileName){
+  if(pState != NULL)
+    throw std::logic_error("TokenBucket already open.");
+
+  this->rate = rate;
+  interval = 1000000000 / rate;
+  batchSize = (unsigned int) ceil(rate * CPH_TOKEN_BATCH_TIME);
+  burst = (MQINT64) (batchSize * interval);
+
+  if(fileName == NULL || *fileName == '\0'){
+    pState = &localState;
+  } else {
+#if defined(WIN32) || defined(WIN64)
+    HANDLE hFile = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(hFile == INVALID_HANDLE_VALUE)
+      throw std::runtime_error(std::string("Could not open token bucket file: ") + fileName);
+    HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READWRITE, 0, (DWORD) sizeof(TokenBucketState), NULL);
+    if(hMapping != NULL){
+      pState = (TokenBucketState *) MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(TokenBucketState));
+      CloseHandle(hMapping);
+    }
+    CloseHandle(hFile);
+    if(pState == NULL)
+      throw std::runtime_error(std::string("Could not map token bucket file: ") + fileName);
+#else
+    // Not truncated, as other processes may already be using it
+    int fd = ::open(fileName, O_RDWR | O_CREAT, 0644);
+    if(fd < 0)
+      throw std::runtime_error(std::string("Could not open token bucket file: ") + fileName);
+    void * addr = MAP_FAILED;
+    struct stat st;
+    if(0 == fstat(fd, &st) && (st.st_size >= (off_t) sizeof(TokenBucketState) || 0 == ftruncate(fd, sizeof(TokenBucketState))))
+      addr = mmap(NULL, sizeof(TokenBucketState), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(addr == MAP_FAILED)
+      throw std::runtime_error(std::string("Could not map token bucket file: ") + fileName);
+    pState = (TokenBucketState *) addr;
+#endif
+    mapped = true;
+
+    if(pState->strucId[0] != '\0'
+        && (0 != memcmp(pState->strucId, CPH_TOKENS_STRUC_ID, sizeof(pState->strucId)) || pState->version != CPH_TOKENS_VERSION))
+      throw std::runtime_error(std::string("Not a token bucket file: ") + fileName);
+  }
+
+  // Forget a next token time from an earlier boot, when the clock started from a higher value
+  MQINT64 const now = cphUtilGetMonotonicNs();
+  uint64_t next = cphAtomicLoad64(&pState->nextToken);
+  if((MQINT64) next > now + (MQINT64) CPH_TOKEN_STALE_TIME * 1000000000)
+    cphAtomicCompareAndSwap64(&pState->nextToken, next, 0);
+
+  if(pState->strucId[0] == '\0'){
+    pState->version = CPH_TOKENS_VERSION;
+    cphAtomicReleaseFence();
+    memcpy(pState->strucId, CPH_TOKENS_STRUC_ID, sizeof(pState->strucId));
+  }
+}
+
+/*
+ * Method: isOpen
+ * --------------
+ *
+ * Returns true if the bucket is issuing tokens.
+ */
+bool TokenBucket::isOpen() const {
+  return pState != NULL;
+}
+
+/*
+ * Method: getRate
+ * ---------------
+ *
+ * Returns the rate (tokens/second) at which tokens are issued, or 0 if not open.
+ */
+double TokenBucket::getRate() const {
+  return rate;
+}
+
+/*
+ * Method: getBatchSize
+ * --------------------
+ *
+ * Returns the number of tokens each thread should claim at once.
+ */
+unsigned int TokenBucket::getBatchSize() const {
+  return batchSize;
+}
+
+/*
+ * Method: getInterval
+ * -------------------
+ *
+ * Returns the time (ns) between tokens.
+ */
+double TokenBucket::getInterval() const {
+  return interval;
+}
+
+/*
+ * Method: claim
+ * -------------
+ *
+ * Claim the given number of consecutive tokens, returning the time (from cphUtilGetMonotonicNs)
+ * at which the first is issued; the rest follow at getInterval() apart. The time may be in the
+ * past if unclaimed tokens had built up, or in the future if other threads are ahead of the caller,
+ * in which case the caller should wait for it.
+ */
+MQINT64 TokenBucket::claim(unsigned int tokens){
+  MQINT64 const length = (MQINT64) (tokens * interval);
+  for(;;){
+    uint64_t const next = cphAtomicLoad64(&pState->nextToken);
+    MQINT64 const oldest = cphUtilGetMonotonicNs() - burst;
+    MQINT64 const first = (MQINT64) next > oldest ? (MQINT64) next : oldest;
+    if(cphAtomicCompareAndSwap64(&pState->nextToken, next, (uint64_t) (first + length)))
+      return first;
+  }
+}
+
+}
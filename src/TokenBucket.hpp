@@ -0,0 +1,96 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#ifndef TOKENBUCKET_HPP_
+#define TOKENBUCKET_HPP_
+
+#include "cphAtomic.h"
+#include "cphUtil.h"
+
+#define CPH_TOKENS_STRUC_ID "CPHTOKEN"
+#define CPH_TOKENS_VERSION 1
+
+namespace cph {
+
+/*
+ * Struct: TokenBucketState
+ * ------------------------
+ *
+ * The shared state of a TokenBucket, which may be in a file mapped by several processes.
+ *
+ * nextToken is the time (from cphUtilGetMonotonicNs, which is system-wide) at which the next
+ * token not yet claimed is issued. It's only ever changed with a compare-and-swap.
+ */
+struct TokenBucketState {
+  char strucId[8];
+  uint32_t version;
+  uint32_t reserved;
+  volatile uint64_t nextToken;
+};
+
+/*
+ * Class: TokenBucket
+ * ------------------
+ *
+ * A lock-free rate limiter shared by all the WorkerThreads (and, if backed by a file, by all the
+ * processes) using it, which issues tokens at a fixed total rate for them to claim in batches.
+ *
+ * The bucket is kept as the time at which its next token is issued (as in the generic cell rate
+ * algorithm), so claiming a batch is a single compare-and-swap that moves that time on by the
+ * batch's worth of token intervals. Tokens not claimed accumulate up to a burst of one batch;
+ * beyond that, tokens nobody claims are lost rather than saved up.
+ */
+class TokenBucket {
+public:
+  TokenBucket();
+  ~TokenBucket();
+
+  void open(double rate, char const * fileName);
+  bool isOpen() const;
+  double getRate() const;
+  unsigned int getBatchSize() const;
+  double getInterval() const;
+  MQINT64 claim(unsigned int tokens);
+
+private:
+  TokenBucketState localState;
+  TokenBucketState * pState;
+  bool mapped;
+  double rate;
+  /*Time (ns) between tokens.*/
+  double interval;
+  unsigned int batchSize;
+  /*The longest (ns) unclaimed tokens are kept.*/
+  MQINT64 burst;
+
+  TokenBucket(TokenBucket const &);
+  TokenBucket & operator=(TokenBucket const &);
+};
+
+}
+
+#endif /* TOKENBUCKET_HPP_ */
@@ -0,0 +1,217 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#include "WorkerCounters.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <stdexcept>
+#include <string>
+
+#if defined(WIN32) || defined(WIN64)
+#include <Windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+/* Round a size up to a whole number of cache lines */
+#define CPH_STATS_ALIGN(size) ((((size) + CPH_CACHE_LINE_SIZE - 1) / CPH_CACHE_LINE_SIZE) * CPH_CACHE_LINE_SIZE)
+
+namespace cph {
+
+static size_t const headerSize = CPH_STATS_ALIGN(sizeof(WorkerCountersHeader));
+static size_t const histogramOffset = CPH_STATS_ALIGN(sizeof(WorkerCounters));
+static size_t const histogramSize = CPH_STATS_ALIGN(sizeof(Histogram));
+static size_t const callStatsOffset = histogramOffset + LATENCY_TYPES * histogramSize;
+static size_t const slotSize = CPH_STATS_ALIGN(callStatsOffset + sizeof(CallStats));
+
+WorkerCountersArray::WorkerCountersArray() :
+    memory(NULL), memorySize(0), mapped(false), pHeader(NULL), slots(NULL), capacity(0), used(0) {
+}
+
+WorkerCountersArray::~WorkerCountersArray(){
+  if(!mapped)
+    free(memory);
+  else {
+#if defined(WIN32) || defined(WIN64)
+    UnmapViewOfFile(memory);
+#else
+    munmap(memory, memorySize);
+#endif
+  }
+}
+
+/*
+ * Method: allocate
+ * ----------------
+ *
+ * Create room for the given number of (zeroed) worker slots, and fill in the header.
+ * If fileName is not NULL or empty, the segment is a shared mapping of that file, which is left in place
+ * afterwards so that monitors can read the final values. Any existing file is removed and a new one created,
+ * rather than truncated, so that a monitor still mapping the old file keeps its values (truncating a mapped
+ * file makes the mapping fault); if something else creates the file in between, allocate fails.
+ * Must be called once, before any slots are handed out by next().
+ */
+void WorkerCountersArray::allocate(size_t capacity, char const * procId, char const * fileName){
+  if(memory != NULL)
+    throw std::logic_error("WorkerCountersArray already allocated.");
+
+  memorySize = headerSize + capacity * slotSize;
+  if(fileName == NULL || *fileName == '\0'){
+    /* Over-allocate by a line, so the header can start on a line boundary */
+    memory = calloc(memorySize + CPH_CACHE_LINE_SIZE, 1);
+    if(memory == NULL)
+      throw std::runtime_error("Could not allocate worker thread counters.");
+    size_t misalignment = (size_t) memory % CPH_CACHE_LINE_SIZE;
+    pHeader = (WorkerCountersHeader *) ((char *) memory + (misalignment == 0 ? 0 : CPH_CACHE_LINE_SIZE - misalignment));
+  } else {
+#if defined(WIN32) || defined(WIN64)
+    DeleteFileA(fileName);
+    HANDLE hFile = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(hFile == INVALID_HANDLE_VALUE)
+      throw std::runtime_error(std::string("Could not create statistics segment file: ") + fileName);
+    HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READWRITE,
+        (DWORD) ((unsigned long long) memorySize >> 32), (DWORD) memorySize, NULL);
+    if(hMapping != NULL){
+      memory = MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, memorySize);
+      CloseHandle(hMapping);
+    }
+    CloseHandle(hFile);
+    if(memory == NULL)
+      throw std::runtime_error(std::string("Could not map statistics segment file: ") + fileName);
+#else
+    if(0 != unlink(fileName) && errno != ENOENT)
+      throw std::runtime_error(std::string("Could not remove existing statistics segment file: ") + fileName
+          + " (" + strerror(errno) + ")");
+    int fd = open(fileName, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if(fd < 0)
+      throw std::runtime_error(std::string("Could not create statistics segment file: ") + fileName
+          + " (" + strerror(errno) + ")");
+    void * addr = MAP_FAILED;
+    if(0 == ftruncate(fd, (off_t) memorySize))
+      addr = mmap(NULL, memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(addr == MAP_FAILED)
+      throw std::runtime_error(std::string("Could not map statistics segment file: ") + fileName);
+    memory = addr;
+#endif
+    mapped = true;
+    pHeader = (WorkerCountersHeader *) memory;
+  }
+
+  slots = (char *) pHeader + headerSize;
+  this->capacity = capacity;
+
+  pHeader->version = CPH_STATS_VERSION;
+  pHeader->headerSize = (uint32_t) headerSize;
+  pHeader->slotSize = (uint32_t) slotSize;
+  pHeader->slotCount = (uint32_t) capacity;
+  pHeader->startTime = cphUtilGetEpochMs();
+  pHeader->processId = cphUtilGetProcessId();
+  pHeader->latencyTypes = LATENCY_TYPES;
+  pHeader->histogramOffset = (uint32_t) histogramOffset;
+  pHeader->histogramSize = (uint32_t) histogramSize;
+  pHeader->histogramBuckets = Histogram::BUCKET_COUNT;
+  pHeader->subBucketBits = Histogram::SUB_BUCKET_BITS;
+  pHeader->callStatsOffset = (uint32_t) callStatsOffset;
+  pHeader->callStatsSize = (uint32_t) sizeof(CallStats);
+  pHeader->callTypes = CALL_TYPES;
+  pHeader->callEvents = EVENT_TYPES;
+  if(procId != NULL)
+    strncpy(pHeader->procId, procId, sizeof(pHeader->procId) - 1);
+  /* Written last, so a monitor that sees the identifier sees the rest of the header */
+  cphAtomicReleaseFence();
+  memcpy(pHeader->strucId, CPH_STATS_STRUC_ID, sizeof(pHeader->strucId));
+}
+
+/*
+ * Method: next
+ * ------------
+ *
+ * Returns the next unused slot.
+ */
+WorkerCounters * WorkerCountersArray::next(){
+  if(used >= capacity)
+    throw std::logic_error("No more worker thread counters available.");
+  WorkerCounters * pSlot = (WorkerCounters *) (slots + used * slotSize);
+  cphAtomicStore64(&pHeader->slotsUsed, ++used);
+  return pSlot;
+}
+
+/*
+ * Method: size
+ * ------------
+ *
+ * Returns the number of slots handed out by next().
+ */
+size_t WorkerCountersArray::size() const {
+  return used;
+}
+
+/*
+ * Method: snapshot
+ * ----------------
+ *
+ * Copy the counters of each slot handed out so far into the given vector, in order, each with the time it was read,
+ * so that rates calculated from successive snapshots are exact however long a pass over the array takes.
+ */
+void WorkerCountersArray::snapshot(std::vector<WorkerCountersSnapshot> &into) const {
+  if(into.size() != used)
+    into.resize(used);
+  for(size_t i = 0; i < used; i++){
+    WorkerCounters const * pSlot = (WorkerCounters const *) (slots + i * slotSize);
+    into[i].iterations = cphAtomicLoad64(&pSlot->iterations);
+    into[i].time = cphUtilGetMonotonicNs();
+    into[i].state = pSlot->state;
+    into[i].name = pSlot->name;
+  }
+}
+
+/*
+ * Static Method: getHistogramStorage
+ * ----------------------------------
+ *
+ * Returns the (uninitialised) memory in the given slot for a Histogram of the given type.
+ */
+void * WorkerCountersArray::getHistogramStorage(WorkerCounters * pSlot, LatencyType type){
+  return (char *) pSlot + histogramOffset + type * histogramSize;
+}
+
+/*
+ * Static Method: getCallStatsStorage
+ * ----------------------------------
+ *
+ * Returns the (uninitialised) memory in the given slot for a CallStats.
+ */
+void * WorkerCountersArray::getCallStatsStorage(WorkerCounters * pSlot){
+  return (char *) pSlot + callStatsOffset;
+}
+
+}
@@ -0,0 +1,185 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+#ifndef WORKERCOUNTERS_HPP_
+#define WORKERCOUNTERS_HPP_
+
+#include <stddef.h>
+#include <vector>
+#include "cphAtomic.h"
+#include "cphUtil.h"
+#include "Histogram.hpp"
+#include "CallStats.hpp"
+
+/*
+ * The size of the cache lines (or, where adjacent lines are prefetched together, pairs of lines)
+ * that the header and each slot of a WorkerCountersArray are aligned to.
+ */
+#if defined(__s390__) || defined(__MVS__)
+#define CPH_CACHE_LINE_SIZE 256
+#elif defined(__powerpc__) || defined(_ARCH_PPC) || defined(__x86_64__) || defined(_M_X64) || defined(__aarch64__)
+#define CPH_CACHE_LINE_SIZE 128
+#else
+#define CPH_CACHE_LINE_SIZE 64
+#endif
+
+#define CPH_STATS_STRUC_ID "CPHSTATS"
+#define CPH_STATS_VERSION 2
+
+/* Bits of WorkerCounters.collecting: one per LatencyType (1 << type), and one for CallStats */
+#define CPH_STATS_COLLECTING_CALLS (1u << 31)
+
+namespace cph {
+
+/*
+ * Struct: WorkerCountersHeader
+ * ----------------------------
+ *
+ * The start of a WorkerCountersArray, describing the layout of the rest of it so that external monitors
+ * can find (and check they understand) the statistics of each worker. All fields other than
+ * slotsUsed are written once, before the first slot is handed out.
+ *
+ * The segment is laid out as:
+ *
+ *   header                   headerSize bytes (a whole number of cache lines)
+ *   slot[0..slotCount-1]     slotSize bytes each (a whole number of cache lines), of which:
+ *     WorkerCounters         at offset 0
+ *     Histogram[t]           at histogramOffset + t * histogramSize, for t < latencyTypes
+ *     CallStats              at callStatsOffset
+ *
+ * Each Histogram is histogramBuckets counts (uint64) followed by totalCount, totalValue, minValue
+ * and maxValue (uint64). Bucket i counts values v with i == v if v < 2^subBucketBits, otherwise
+ * i == s * 2^(subBucketBits-1) + (v >> s) where s == msb(v) - (subBucketBits-1).
+ *
+ * Each CallStats is a sequence number (see below), then callTypes each of calls, failures,
+ * total time (ns) and maximum time (ns), then callEvents event counts (all uint64), in the
+ * order of the CallType and CallEvent enumerations.
+ *
+ * A Histogram or CallStats is only valid if its bit is set in WorkerCounters.collecting.
+ * Values are in the byte order of the writing machine.
+ */
+struct WorkerCountersHeader {
+  char strucId[8];
+  uint32_t version;
+  uint32_t headerSize;
+  uint32_t slotSize;
+  uint32_t slotCount;
+  /*The number of slots handed out to WorkerThreads so far; slots below this are initialised.*/
+  volatile uint64_t slotsUsed;
+  /*Milliseconds since the epoch.*/
+  MQINT64 startTime;
+  MQINT64 processId;
+  uint32_t latencyTypes;
+  uint32_t histogramOffset;
+  uint32_t histogramSize;
+  uint32_t histogramBuckets;
+  uint32_t subBucketBits;
+  uint32_t callStatsOffset;
+  uint32_t callStatsSize;
+  uint32_t callTypes;
+  uint32_t callEvents;
+  uint32_t reserved;
+  /*The process identifier given by the id option (may be empty).*/
+  char procId[80];
+};
+
+/*
+ * Struct: WorkerCounters
+ * ----------------------
+ *
+ * The counters of a single WorkerThread, which is their only writer, at the start of its slot.
+ *
+ * The sequence number is a seqlock (see cphAtomic.h) covering the iteration count and the
+ * histograms in the slot: it is odd while they are being updated, and a reader that sees the
+ * same even value before and after copying them has a consistent copy.
+ */
+struct WorkerCounters {
+  volatile uint64_t sequence;
+  /*The total number of iterations completed so far.*/
+  volatile uint64_t iterations;
+  /*The WorkerThread state (S_CREATED, S_RUNNING etc.).*/
+  volatile uint32_t state;
+  /*The statistics being collected in this slot (CPH_STATS_COLLECTING_CALLS and 1 << LatencyType).*/
+  volatile uint32_t collecting;
+  /*The name of the WorkerThread, NUL-terminated.*/
+  char name[CPH_CACHE_LINE_SIZE - 2 * sizeof(uint64_t) - 2 * sizeof(uint32_t)];
+};
+
+/*
+ * Struct: WorkerCountersSnapshot
+ * ------------------------------
+ *
+ * A copy of a WorkerCounters, with the time (from cphUtilGetMonotonicNs) it was taken.
+ */
+struct WorkerCountersSnapshot {
+  uint64_t iterations;
+  MQINT64 time;
+  unsigned int state;
+  /*The name of the WorkerThread (in the segment, so valid for as long as it is).*/
+  char const * name;
+};
+
+/*
+ * Class: WorkerCountersArray
+ * --------------------------
+ *
+ * A fixed-size, contiguous, cache-line aligned array of worker statistics slots, from which each
+ * WorkerThread is allocated one when it is created. The slots are either private memory, or
+ * (if a file name is given) a shared file mapping that other processes can read while cph runs.
+ *
+ * Only the WorkerCounters of each slot are touched unless other statistics are enabled,
+ * so the pages holding the rest of the slot are never allocated in a sparse file.
+ */
+class WorkerCountersArray {
+public:
+  WorkerCountersArray();
+  ~WorkerCountersArray();
+
+  void allocate(size_t capacity, char const * procId, char const * fileName);
+  WorkerCounters * next();
+  size_t size() const;
+  void snapshot(std::vector<WorkerCountersSnapshot> &into) const;
+
+  static void * getHistogramStorage(WorkerCounters * pSlot, LatencyType type);
+  static void * getCallStatsStorage(WorkerCounters * pSlot);
+
+private:
+  void * memory;
+  size_t memorySize;
+  bool mapped;
+  WorkerCountersHeader * pHeader;
+  char * slots;
+  size_t capacity;
+  size_t used;
+
+  WorkerCountersArray(WorkerCountersArray const &);
+  WorkerCountersArray & operator=(WorkerCountersArray const &);
+};
+
+}
+
+#endif /* WORKERCOUNTERS_HPP_ */
@@ -0,0 +1,151 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+
+#include "WorkerPool.hpp"
+#include "WorkerThread.hpp"
+#include "cphLog.h"
+
+#include <queue>
+#include <functional>
+#include <sstream>
+
+/*The longest (ms) the pool sleeps before checking whether it has been asked to shut down.*/
+#define MAX_POOL_SLEEP 100
+
+using namespace std;
+
+namespace cph {
+
+static inline std::string buildName(unsigned int index){
+  std::stringstream ss;
+  ss << "Pool" << index;
+  return ss.str();
+}
+
+/*
+ * Constructor: WorkerPool
+ * -----------------------
+ *
+ * Create the index'th pool, to which worker threads are then given with add().
+ */
+WorkerPool::WorkerPool(CPH_CONFIG * pConfig, unsigned int index) :
+    Thread(pConfig), name(buildName(index)), index(index) {}
+
+WorkerPool::~WorkerPool(){}
+
+/*
+ * Method: add
+ * -----------
+ *
+ * Have this pool drive the given worker thread, which must not be started itself. Must be called before the pool is started.
+ */
+void WorkerPool::add(WorkerThread * pWorker){
+  pWorker->pooled = true;
+  workers.push_back(pWorker);
+}
+
+/*
+ * Method: run
+ * -----------
+ *
+ * Inherited from class: Thread
+ *
+ * Open the first session of each worker, then run their iterations until all of them have ended,
+ * or the pool is asked to shut down, in which case the workers still running are ended.
+ */
+void WorkerPool::run(){
+  CPHTRACEENTRY(pConfig->pTrc)
+  char msg[512];
+
+  if(WorkerThread::placement.isEnabled()){
+    try{
+      snprintf(msg, 512, "[%s] Placement: %s", name.data(), WorkerThread::placement.apply(index).data());
+      cphLogPrintLn(pConfig->pLog, LOG_INFO, msg);
+    } catch (runtime_error &e) {
+      for(size_t i=0; i<workers.size(); i++)
+        workers[i]->poolAbort(e);
+      CPHTRACEEXIT(pConfig->pTrc)
+      return;
+    }
+  }
+
+  snprintf(msg, 512, "[%s] Opening sessions of %u worker threads.", name.data(), (unsigned int) workers.size());
+  cphLogPrintLn(pConfig->pLog, LOG_VERBOSE, msg);
+
+  // Open all the sessions before running any iterations, so that the first to open don't get ahead of the others
+  vector<bool> opened(workers.size());
+  for(size_t i=0; i<workers.size(); i++)
+    opened[i] = !shutdown && workers[i]->poolOpen();
+
+  // The workers with iterations to run, by the time the next one is due
+  typedef pair<MQINT64, size_t> Due;
+  priority_queue<Due, vector<Due>, greater<Due> > due;
+  for(size_t i=0; i<workers.size(); i++){
+    if(!opened[i]) continue;
+    MQINT64 const next = workers[i]->poolBegin();
+    if(next >= 0) due.push(Due(next, i));
+  }
+
+  while(!due.empty() && !shutdown){
+    Due const next = due.top();
+    if(next.first > cphUtilGetMonotonicNs()){
+      sleepUntil(next.first);
+      continue;
+    }
+    due.pop();
+    MQINT64 const after = workers[next.second]->poolStep();
+    if(after >= 0) due.push(Due(after, next.second));
+  }
+
+  // We've been asked to shut down
+  for(; !due.empty(); due.pop())
+    workers[due.top().second]->finish();
+
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+/*
+ * Method: sleepUntil
+ * ------------------
+ *
+ * Wait for the given time (from cphUtilGetMonotonicNs), when the next iteration is due, sleeping for at most
+ * MAX_POOL_SLEEP ms at a time so that a shutdown request is noticed promptly. As for a worker thread pacing
+ * to deadlines, the last spinTime (ps) microseconds are spent spinning on the clock instead.
+ */
+void WorkerPool::sleepUntil(MQINT64 deadline){
+  MQINT64 const wake = deadline - (MQINT64) WorkerThread::spinTime * 1000;
+  MQINT64 const maxSleep = (MQINT64) MAX_POOL_SLEEP * 1000000;
+  MQINT64 const now = cphUtilGetMonotonicNs();
+
+  if(now < wake)
+    cphUtilSleepUntilNs(wake - now > maxSleep ? now + maxSleep : wake);
+  else
+    while(cphUtilGetMonotonicNs() < deadline);
+}
+
+}
@@ -0,0 +1,81 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+
+#ifndef WORKERPOOL_HPP_
+#define WORKERPOOL_HPP_
+
+#include <string>
+#include <vector>
+
+#include "Thread.hpp"
+#include "cphUtil.h"
+
+namespace cph {
+class WorkerThread;
+
+/*
+ * Class: WorkerPool
+ * -----------------
+ *
+ * Extends: Thread
+ *
+ * Drives the iterations of many WorkerThreads (np) from one thread, instead of each running on its own,
+ * so that a large number of connections can be simulated without a thread (and its stack and scheduling
+ * overhead) for each. The workers are never started themselves: the pool opens their sessions and then
+ * repeatedly runs whichever has the earliest iteration due, sleeping when none is.
+ *
+ * Workers that wait for messages consume them by callback, on threads belonging to MQ, so that they
+ * don't hold up the others (see WorkerThread::startCallbacks).
+ */
+class WorkerPool : public Thread {
+public:
+  /*The name of this pool, as used in log messages.*/
+  std::string const name;
+
+  WorkerPool(CPH_CONFIG * pConfig, unsigned int index);
+  virtual ~WorkerPool();
+  void add(WorkerThread * pWorker);
+
+protected:
+  virtual void run();
+
+private:
+  /*This pool's position among the others, used to place it (af).*/
+  unsigned int const index;
+  /*The worker threads driven by this pool.*/
+  std::vector<WorkerThread *> workers;
+
+  void sleepUntil(MQINT64 deadline);
+
+  WorkerPool(WorkerPool const &);
+  WorkerPool & operator=(WorkerPool const &);
+};
+
+}
+
+#endif /* WORKERPOOL_HPP_ */
@@ -33,8 +33,12 @@
 #include "cphDestinationFactory.h"
 #include "cphLog.h"
 #include <limits.h>
+#include <string.h>
+#include <new>
 
 #define WINDOW_SIZE 4
+/*The longest (ms) the deadline pacer sleeps before checking whether it has been asked to shut down.*/
+#define MAX_DEADLINE_SLEEP 100
 
 #ifdef _MSC_VER
 #include "msio.h"
@@ -70,6 +74,22 @@ float WorkerThread::rate = 0;
 unsigned int WorkerThread::yieldRate = 0;
 /*Time period (s) to ramp up to the full rate.*/
 unsigned int WorkerThread::rampTime = 0;
+/*Whether to pace each iteration to its own deadline, rather than in windows.*/
+bool WorkerThread::deadlinePacing = false;
+/*Time (microseconds) before each deadline to stop sleeping and spin.*/
+unsigned int WorkerThread::spinTime = 0;
+/*Distribution of the times between iterations when pacing to deadlines.*/
+WorkerThread::Arrivals WorkerThread::arrivals = WorkerThread::ARRIVALS_EVEN;
+/*Seed from which each thread's arrival times are drawn.*/
+unsigned int WorkerThread::arrivalSeed = 0;
+/*The target rate over time, from a schedule file or from rt and rp; empty if not pacing.*/
+RateSchedule WorkerThread::schedule;
+/*Tokens for the total rate across all threads (and processes sharing its file), if set.*/
+TokenBucket WorkerThread::globalTokens;
+/*The CPUs and scheduling policy of the threads.*/
+ThreadPlacement WorkerThread::placement;
+/*Whether each thread should reallocate its buffers once running, so they're on its NUMA node.*/
+bool WorkerThread::localBuffers = false;
 /*Number of sessions to run.*/
 unsigned int WorkerThread::sessions = 1;
 /*Interval between sessions (milliseconds).*/
@@ -86,22 +106,29 @@ unsigned int WorkerThread::sessionInterval = 0;
  */
 WorkerThread::WorkerThread(ControlThread *pControlThread, std::string className):
     Thread(pControlThread->pConfig),
-    state(0),
-    iterations(0),
+    pCounters(pControlThread->allocateWorkerCounters()),
+    state(pCounters->state),
     pControlThread(pControlThread),
-    className(className),
+    pooled(false),
+    pCallStats(NULL),
     threadNum(seq++),
     destinationIndex(cphDestinationFactoryGenerateDestinationIndex(pControlThread->pDestinationFactory)),
+    className(className),
     name(buildName(className, threadNum)){
   CPHTRACEREF(pTrc, pConfig->pTrc)
   CPHTRACEENTRY(pTrc)
   count++;
+  strncpy(pCounters->name, name.data(), sizeof(pCounters->name) - 1);
 
   /* Initialise the worker thread start and end times */
   cphUtilTimeIni(&startTime);
   cphUtilTimeIni(&endTime);
+  finalCpuTime.user = finalCpuTime.system = finalCpuTime.userTicks = finalCpuTime.systemTicks = 0;
+  cpuTimeFinal = false;
 
   collectLatencyStats = false;
+  for(int i=0; i<LATENCY_TYPES; i++)
+    latencyHistograms[i] = NULL;
 
   // Initialise static configuration variables (only if we're the first WorkerThread to be created).
   if(threadNum==0){
@@ -118,12 +145,126 @@ WorkerThread::WorkerThread(ControlThread *pControlThread, std::string className)
       configError(pConfig, "Could not determine number of iterations to run (mg).");
     CPHTRACEMSG(pTrc, "Max Iterations: %d.", messages)
 
-    if(rate>0){
+    char scheduleFile[512];
+    if (CPHTRUE != cphConfigGetString(pConfig, scheduleFile, sizeof(scheduleFile), "pf"))
+      configError(pConfig, "Could not determine rate schedule file (pf).");
+    CPHTRACEMSG(pTrc, "Rate schedule file: %s.", scheduleFile)
+
+    if(0 < strlen(scheduleFile)){
+      // A schedule is followed one iteration at a time, so it's always paced to deadlines
+      try {
+        schedule.load(scheduleFile);
+      } catch (runtime_error &e) {
+        configError(pConfig, string("(pf) ") + e.what());
+      }
+      deadlinePacing = true;
+    } else if(rate>0){
       if (CPHTRUE != cphConfigGetInt(pConfig, (int*) &rampTime, "rp"))
         configError(pConfig, "Could not determine ramp time (rp).");
       CPHTRACEMSG(pTrc, "Ramptime: %d.", rampTime)
+
+      // The rate rises linearly over the ramp time, so the n'th iteration is due sqrt(2*rampTime*n/rate) seconds in
+      if(rampTime>0) schedule.addRamp(rampTime, 0, rate);
+      schedule.addConstant(HUGE_VAL, rate);
+
+      char pacingMode[80];
+      if (CPHTRUE != cphConfigGetString(pConfig, pacingMode, sizeof(pacingMode), "pm"))
+        configError(pConfig, "Could not determine pacing mode (pm).");
+      if (0 == strcmp(pacingMode, "deadline"))
+        deadlinePacing = true;
+      else if (0 != strcmp(pacingMode, "window"))
+        configError(pConfig, "(pm) Pacing mode must be one of: window, deadline.");
+      CPHTRACEMSG(pTrc, "Pacing mode: %s.", pacingMode)
+    }
+
+    float globalRate;
+    if (CPHTRUE != cphConfigGetFloat(pConfig, &globalRate, "gr"))
+      configError(pConfig, "Could not determine global rate (gr).");
+    CPHTRACEMSG(pTrc, "Global rate: %g", globalRate)
+
+    if(globalRate>0){
+      if(!schedule.empty())
+        configError(pConfig, "(gr) A global rate can't be combined with a per-thread rate (rt or pf).");
+
+      char tokenFile[512];
+      if (CPHTRUE != cphConfigGetString(pConfig, tokenFile, sizeof(tokenFile), "gf"))
+        configError(pConfig, "Could not determine global rate file (gf).");
+      CPHTRACEMSG(pTrc, "Global rate file: %s.", tokenFile)
+
+      try {
+        globalTokens.open(globalRate, tokenFile);
+      } catch (runtime_error &e) {
+        configError(pConfig, string("(gf) ") + e.what());
+      }
+      CPHTRACEMSG(pTrc, "Global rate tokens claimed in batches of %u.", globalTokens.getBatchSize())
+    }
+
+    if(deadlinePacing || globalTokens.isOpen()){
+      if (CPHTRUE != cphConfigGetInt(pConfig, (int*) &spinTime, "ps"))
+        configError(pConfig, "Could not determine pacing spin time (ps).");
+      CPHTRACEMSG(pTrc, "Pacing spin time: %uus.", spinTime)
+    }
+
+    if(deadlinePacing){
+
+      char arrivalDist[80];
+      if (CPHTRUE != cphConfigGetString(pConfig, arrivalDist, sizeof(arrivalDist), "pa"))
+        configError(pConfig, "Could not determine arrival distribution (pa).");
+      if (0 == strcmp(arrivalDist, "exponential"))
+        arrivals = ARRIVALS_EXPONENTIAL;
+      else if (0 == strcmp(arrivalDist, "uniform"))
+        arrivals = ARRIVALS_UNIFORM;
+      else if (0 != strcmp(arrivalDist, "even"))
+        configError(pConfig, "(pa) Arrival distribution must be one of: even, exponential, uniform.");
+      CPHTRACEMSG(pTrc, "Arrival distribution: %s.", arrivalDist)
+
+      if(arrivals != ARRIVALS_EVEN){
+        if (CPHTRUE != cphConfigGetInt(pConfig, (int*) &arrivalSeed, "pr"))
+          configError(pConfig, "Could not determine arrival seed (pr).");
+        if(arrivalSeed == 0)
+          arrivalSeed = (unsigned int) (time(NULL) ^ cphUtilGetMonotonicNs());
+        char msg[80];
+        snprintf(msg, 80, "Arrival seed: %u", arrivalSeed);
+        cphLogPrintLn(pConfig->pLog, LOG_INFO, msg);
+      }
+    }
+
+    char cpuList[512], placementMode[80], policy[80];
+    int priority;
+    if (CPHTRUE != cphConfigGetString(pConfig, cpuList, sizeof(cpuList), "af"))
+      configError(pConfig, "Could not determine CPU affinity list (af).");
+    if (CPHTRUE != cphConfigGetString(pConfig, placementMode, sizeof(placementMode), "afm"))
+      configError(pConfig, "Could not determine CPU placement mode (afm).");
+    if (CPHTRUE != cphConfigGetString(pConfig, policy, sizeof(policy), "sc"))
+      configError(pConfig, "Could not determine scheduling policy (sc).");
+    if (CPHTRUE != cphConfigGetInt(pConfig, &priority, "scp"))
+      configError(pConfig, "Could not determine scheduling priority (scp).");
+    CPHTRACEMSG(pTrc, "CPU affinity: %s (%s), scheduling policy: %s (%d).", cpuList, placementMode, policy, priority)
+
+    ThreadPlacement::Mode mode = ThreadPlacement::ROUND_ROBIN;
+    if (0 == strcmp(placementMode, "compact"))
+      mode = ThreadPlacement::COMPACT;
+    else if (0 == strcmp(placementMode, "scatter"))
+      mode = ThreadPlacement::SCATTER;
+    else if (0 != strcmp(placementMode, "roundrobin"))
+      configError(pConfig, "(afm) CPU placement mode must be one of: roundrobin, compact, scatter.");
+    try {
+      placement.setCpus(cpuList, mode);
+    } catch (runtime_error &e) {
+      configError(pConfig, string("(af) ") + e.what());
+    }
+    try {
+      placement.setScheduling(policy, priority);
+    } catch (runtime_error &e) {
+      configError(pConfig, string("(sc) ") + e.what());
     }
 
+    int temp;
+    if (CPHTRUE != cphConfigGetBoolean(pConfig, &temp, "nb"))
+      configError(pConfig, "Could not determine whether to allocate buffers on the local NUMA node (nb).");
+    localBuffers = temp==CPHTRUE;
+    CPHTRACEMSG(pTrc, "Allocate buffers on local NUMA node: %s.", localBuffers ? "yes" : "no")
+
     if(messages>0){
       if (CPHTRUE != cphConfigGetInt(pConfig, (int*) &sessions, "sn"))
         configError(pConfig, "Could not determine number of sessions (sn).");
@@ -137,6 +278,11 @@ WorkerThread::WorkerThread(ControlThread *pControlThread, std::string className)
     }
   }
 
+  scheduleStart = 0;
+
+  // Give each thread its own sequence of arrival times, repeatable for a given seed
+  arrivalRandom = (uint64_t) arrivalSeed * 0x100000001ULL + threadNum;
+
   state = S_CREATED;
   CPHTRACEEXIT(pTrc)
 }
@@ -147,6 +293,16 @@ WorkerThread::~WorkerThread(){
   CPHTRACEEXIT(pConfig->pTrc)
 }
 
+/*
+ * Method: allocateLocalBuffers
+ * ----------------------------
+ *
+ * Called by the thread itself as it starts, if buffers are to be on its local NUMA node (nb),
+ * to replace any buffers allocated by its constructor (on the ControlThread) with copies that it
+ * allocates itself. Does nothing unless overridden.
+ */
+void WorkerThread::allocateLocalBuffers(){}
+
 /*
  * Static Method: getWorkerCount
  * -----------------------------
@@ -187,20 +343,44 @@ inline void WorkerThread::_closeSession(){
 void WorkerThread::run(){
   CPHTRACEENTRY(pConfig->pTrc)
   char msg[512];
-  minLatency=LONG_MAX;
-  maxLatency=0;
-  latencyIter=0;
 
   state |= S_STARTED;
   snprintf(msg, 512, "[%s] START", name.data());
   cphLogPrintLn(pConfig->pLog, LOG_INFO, msg);
 
   try{
-    _openSession();
-    snprintf(msg, 512, "[%s] First session open - entering RUNNING state.", name.data());
-    cphLogPrintLn(pConfig->pLog, LOG_INFO, msg);
-    state |= S_RUNNING;
-    pControlThread->incRunners();
+    if(placement.isEnabled()){
+      snprintf(msg, 512, "[%s] Placement: %s", name.data(), placement.apply(threadNum).data());
+      cphLogPrintLn(pConfig->pLog, LOG_INFO, msg);
+    }
+    // Buffers allocated now are first touched, and so placed, on the node this thread runs on
+    if(localBuffers)
+      allocateLocalBuffers();
+
+    if(pControlThread->isStartBarrier()){
+      // Open the first session alongside the other threads, then wait for all of them to be ready
+      if(!pControlThread->beginOpen()) throw ShutdownException(this);
+      try{
+        _openSession();
+      } catch(...){
+        pControlThread->endOpen(false);
+        throw;
+      }
+      pControlThread->endOpen(true);
+      snprintf(msg, 512, "[%s] First session open - waiting for all threads to be ready.", name.data());
+      cphLogPrintLn(pConfig->pLog, LOG_VERBOSE, msg);
+      if(!pControlThread->awaitStart()) throw ShutdownException(this);
+      snprintf(msg, 512, "[%s] All threads ready - entering RUNNING state.", name.data());
+      cphLogPrintLn(pConfig->pLog, LOG_INFO, msg);
+      // The control thread has already counted this thread as running
+      state |= S_RUNNING;
+    } else {
+      _openSession();
+      snprintf(msg, 512, "[%s] First session open - entering RUNNING state.", name.data());
+      cphLogPrintLn(pConfig->pLog, LOG_INFO, msg);
+      state |= S_RUNNING;
+      pControlThread->incRunners();
+    }
     startTime = cphUtilGetNow();
 
     pace();
@@ -235,11 +415,7 @@ void WorkerThread::run(){
      *
      * Shut down the process (consistent with JMSPerfHarness)
      */
-
-    snprintf(msg, 512, "[%s] Caught exception: %s", name.data(), e.what());
-    cphLogPrintLn(pConfig->pLog, LOG_ERROR, msg);
-    state |= S_ERROR;
-    state &= ~(S_OPENING | S_CLOSING);
+    fail(e);
 
     //Current shutdown flow is waiting for the controller to notice that an error has occured (parsing output for mqrc)
     //and killing remote clients. We could end this process more speedily by calling
@@ -247,8 +423,44 @@ void WorkerThread::run(){
 
   }
 
-  if(state & S_OPEN)
-    _closeSession();
+  finish();
+  CPHTRACEEXIT(pConfig->pTrc)
+}
+
+/*
+ * Method: fail
+ * ------------
+ *
+ * Log an error that has stopped this thread from running iterations, and put it into the ERROR state.
+ */
+void WorkerThread::fail(runtime_error const &e){
+  char msg[512];
+  snprintf(msg, 512, "[%s] Caught exception: %s", name.data(), e.what());
+  cphLogPrintLn(pConfig->pLog, LOG_ERROR, msg);
+  state |= S_ERROR;
+  state &= ~(S_OPENING | S_CLOSING);
+}
+
+/*
+ * Method: finish
+ * --------------
+ *
+ * Close any open session, and put this thread into the ENDED state.
+ */
+void WorkerThread::finish(){
+  char msg[512];
+
+  if(state & S_OPEN){
+    try{
+      _closeSession();
+    } catch (runtime_error &e) {
+      fail(e);
+    }
+  }
+
+  // Keep the CPU time used, as it can't be sampled once the thread has ended
+  if(Thread::getCpuTime(finalCpuTime))
+    cpuTimeFinal = true;
 
   state |= S_ENDED;
   if(state & S_RUNNING){
@@ -258,29 +470,300 @@ void WorkerThread::run(){
   }
   snprintf(msg, 512, "[%s] STOP", name.data());
   cphLogPrintLn(pConfig->pLog, LOG_INFO, msg);
-  CPHTRACEEXIT(pConfig->pTrc)
 }
 
-inline bool WorkerThread::doOneIteration(unsigned int& its){
-  if(shutdown) return false;
+/*
+ * Method: poolOpen
+ * ----------------
+ *
+ * Called by a WorkerPool (np), on its own thread, in place of starting this thread, to open the first session.
+ * The pool then calls poolBegin, and poolStep each time this thread has an iteration due, until it ends.
+ *
+ * Returns: true if the session was opened, false if the thread has ended.
+ */
+bool WorkerThread::poolOpen(){
+  char msg[512];
+
+  state |= S_STARTED;
+  snprintf(msg, 512, "[%s] START", name.data());
+  cphLogPrintLn(pConfig->pLog, LOG_INFO, msg);
+
+  try{
+    if(localBuffers)
+      allocateLocalBuffers();
+    _openSession();
+    snprintf(msg, 512, "[%s] First session open - entering RUNNING state.", name.data());
+    cphLogPrintLn(pConfig->pLog, LOG_INFO, msg);
+    state |= S_RUNNING;
+    pControlThread->incRunners();
+    return true;
+  } catch (ShutdownException &e){
+    (void)e;
+  } catch (runtime_error &e) {
+    fail(e);
+  }
+  finish();
+  return false;
+}
+
+/*
+ * Method: poolBegin
+ * -----------------
+ *
+ * Start running iterations, once the WorkerPool has opened the first sessions of all its threads.
+ *
+ * Returns: the time (from cphUtilGetMonotonicNs) poolStep should first be called, or -1 if the thread has ended.
+ */
+MQINT64 WorkerThread::poolBegin(){
+  startTime = cphUtilGetNow();
+  poolSessions = 0;
+  try{
+    return poolBeginSession();
+  } catch (ShutdownException &e){
+    (void)e;
+  } catch (runtime_error &e) {
+    fail(e);
+  }
+  finish();
+  return -1;
+}
+
+/*
+ * Method: poolBeginSession
+ * ------------------------
+ *
+ * Start the iterations of a newly opened session driven by a WorkerPool: either by callbacks,
+ * if the implementation supports them (see startCallbacks), or one at a time by poolStep.
+ * Paced sessions always run each iteration at its deadline (see nextDeadline), whatever the pacing mode.
+ *
+ * Returns: the time (from cphUtilGetMonotonicNs) poolStep should next be called.
+ */
+MQINT64 WorkerThread::poolBeginSession(){
+  poolIts = 0;
+  cphAtomicStore64(&scheduleStart, (uint64_t) cphUtilGetMonotonicNs());
+
+  if(beginCallbacks() || schedule.empty()){
+    poolDeadline = 0;
+    return cphUtilGetMonotonicNs();
+  }
+  poolPosition = arrivals == ARRIVALS_EVEN ? 0 : nextArrivalGap();
+  poolDeadline = nextDeadline(poolPosition);
+  return poolDeadline < 0 ? cphUtilGetMonotonicNs() : poolDeadline;
+}
+
+/*
+ * Method: poolStep
+ * ----------------
+ *
+ * Called by a WorkerPool when the time it was last given by this thread has come: runs the next iteration,
+ * checks whether callbacks have finished the session, or opens the next session after the interval between them.
+ *
+ * Returns: the time (from cphUtilGetMonotonicNs) poolStep should next be called, or -1 if the thread has ended.
+ */
+MQINT64 WorkerThread::poolStep(){
+  char msg[512];
 
-  if(collectLatencyStats) latencyStartTime = cphUtilGetNow();
-  oneIteration();
+  try{
+    if(!(state & S_OPEN)){
+      // The interval between sessions is over
+      if(shutdown){
+        finish();
+        return -1;
+      }
+      snprintf(msg, 512, "[%s] Starting session %u.", name.data(), poolSessions+1);
+      cphLogPrintLn(pConfig->pLog, LOG_VERBOSE, msg);
+      _openSession();
+      return poolBeginSession();
+    }
+
+    if(callbackDriven){
+      // Check back regularly, so that a request to shut down is noticed promptly
+      if(!shutdown && cphAtomicLoad64(&callbacksEnded) == 0)
+        return cphUtilGetMonotonicNs() + (MQINT64) MAX_DEADLINE_SLEEP * 1000000;
+      finishCallbacks();
+    } else if(poolDeadline >= 0 && doOneIteration(poolIts, poolDeadline)){
+      if(schedule.empty())
+        return cphUtilGetMonotonicNs();
+      if((poolDeadline = nextDeadline(poolPosition)) >= 0)
+        return poolDeadline;
+      CPHTRACEMSG(pConfig->pTrc, (char*) "End of rate schedule after %u iterations.", poolIts)
+    }
+
+    // The session is over
+    if(shutdown || ++poolSessions==sessions){
+      finish();
+      return -1;
+    }
+    _closeSession();
+    if(sessionInterval>0){
+      snprintf(msg, 512, "[%s] Session %u complete - sleeping for %ums.", name.data(), poolSessions, sessionInterval);
+      cphLogPrintLn(pConfig->pLog, LOG_VERBOSE, msg);
+    }
+    return cphUtilGetMonotonicNs() + (MQINT64) sessionInterval * 1000000;
+  } catch (ShutdownException &e){
+    (void)e;
+  } catch (runtime_error &e) {
+    fail(e);
+  }
+  finish();
+  return -1;
+}
+
+/*
+ * Method: poolAbort
+ * -----------------
+ *
+ * Called by a WorkerPool that failed before opening this thread's first session, to end it with the given error.
+ */
+void WorkerThread::poolAbort(runtime_error const &e){
+  state |= S_STARTED;
+  fail(e);
+  finish();
+}
+
+/*
+ * Method: beginCallbacks
+ * ----------------------
+ *
+ * Try to start callbacks to run the iterations of the session just opened (see startCallbacks).
+ *
+ * Returns: true if callbacks were started, and must be ended with finishCallbacks.
+ */
+bool WorkerThread::beginCallbacks(){
+  callbackIts = 0;
+  callbackError.clear();
+  cphAtomicStore64(&callbacksEnded, 0);
+  return callbackDriven = startCallbacks();
+}
+
+/*
+ * Method: finishCallbacks
+ * -----------------------
+ *
+ * Stop the callbacks started by beginCallbacks, once they have ended the session or it is to be ended early.
+ *
+ * Throws: runtime_error if the callbacks failed.
+ */
+void WorkerThread::finishCallbacks(){
+  stopCallbacks();
+  if(!callbackError.empty())
+    throw runtime_error(callbackError);
+}
+
+/*
+ * Method: startCallbacks
+ * ----------------------
+ *
+ * Called as each session begins, to let implementations that can do so run its iterations from callbacks
+ * (on threads of their own), rather than having pace (or a WorkerPool) call oneIteration.
+ * The callbacks must call callbackIteration after each iteration, and endCallbacks once they are done.
+ *
+ * Returns: true if callbacks were started, false (unless overridden) if oneIteration should be called instead.
+ */
+bool WorkerThread::startCallbacks(){
+  return false;
+}
+
+/*
+ * Method: stopCallbacks
+ * ---------------------
+ *
+ * Stop any callbacks started by startCallbacks, waiting for any in progress to return. Does nothing unless overridden.
+ */
+void WorkerThread::stopCallbacks(){}
+
+/*
+ * Method: callbackIteration
+ * -------------------------
+ *
+ * Called from a callback (see startCallbacks) after each iteration it runs, which began at the given
+ * time (from cphUtilGetTimestampNs), to count it and record its latency.
+ *
+ * Returns: false if no further iterations should be run in this session, true otherwise.
+ */
+bool WorkerThread::callbackIteration(MQINT64 start){
+  if(collectLatencyStats) {
+    MQINT64 end = cphUtilGetTimestampNs();
+    cphSeqlockWriteBegin(&pCounters->sequence);
+    latencyHistograms[LATENCY_ITERATION]->record(end > start ? (uint64_t) (end - start) / 1000 : 0);
+    cphAtomicInc64(&pCounters->iterations);
+    cphSeqlockWriteEnd(&pCounters->sequence);
+  } else
+    cphAtomicInc64(&pCounters->iterations);
+
+  return ++callbackIts != messages;
+}
+
+/*
+ * Method: endCallbacks
+ * --------------------
+ *
+ * Called from a callback (see startCallbacks) once it has run the last iteration of the session,
+ * or with an error message if it has failed, so that the session is ended by the WorkerPool.
+ */
+void WorkerThread::endCallbacks(char const * const error){
+  callbackLock.lock();
+  if(error != NULL && callbackError.empty())
+    callbackError = error;
+  cphAtomicStore64(&callbacksEnded, 1);
+  callbackLock.notify();
+  callbackLock.unlock();
+}
+
+/*
+ * Method: canRunPooled
+ * --------------------
+ *
+ * Returns whether this thread's iterations can be driven by a WorkerPool (np), which is always
+ * the case unless overridden by implementations whose iterations would block the pool.
+ */
+bool WorkerThread::canRunPooled() const {
+  return true;
+}
+
+/*
+ * Method: doOneIteration
+ * ----------------------
+ *
+ * Call oneIteration, timing it if latency statistics are being collected.
+ * When pacing, intendedStart gives the time (from cphUtilGetMonotonicNs) the pacer intended this
+ * iteration to start, and the latency measured from then is also recorded, so that any time spent
+ * behind schedule (e.g. during a stall) is included, along with (if jitter is recorded, see
+ * setCollectLatencyStats) how far from it the iteration started.
+ *
+ * Returns: false if no further iterations should be executed in this session, true otherwise.
+ */
+inline bool WorkerThread::doOneIteration(unsigned int& its, MQINT64 intendedStart){
+  if(shutdown) return false;
 
   if(collectLatencyStats) {
-     latencyStopTime = cphUtilGetNow();
-     latency=cphUtilGetUsTimeDifference(latencyStopTime,latencyStartTime);
-     //printf("Latency: %d\n",latency);
-     if(latency > maxLatency)maxLatency= latency;
-     if(latency < minLatency)minLatency= latency;
-     if(latencyIter == 0){
-	    avgLatency = latency;
-     } else {
-	    avgLatency = ((avgLatency * latencyIter) + latency) / (latencyIter+1);
-     }
-     latencyIter++;
+    // Paced iterations are compared with the pacer's clock; others can use the (possibly cheaper) timebase
+    MQINT64 latencyStartTime = intendedStart != 0 ? cphUtilGetMonotonicNs() : cphUtilGetTimestampNs();
+    oneIteration();
+    MQINT64 latencyEndTime = intendedStart != 0 ? cphUtilGetMonotonicNs() : cphUtilGetTimestampNs();
+    uint64_t latency = latencyEndTime > latencyStartTime ? (uint64_t) (latencyEndTime - latencyStartTime) / 1000 : 0;
+
+    // Publish the latencies and the iteration count together, so readers of the slot see them agree
+    cphSeqlockWriteBegin(&pCounters->sequence);
+    latencyHistograms[LATENCY_ITERATION]->record(latency);
+    if(intendedStart != 0){
+      /*
+       * The window pacer runs batches of iterations between sleeps, so an iteration may start before its
+       * intended time; the corrected latency is never less than the actual one.
+       */
+      uint64_t corrected = latencyEndTime > intendedStart ? (uint64_t) (latencyEndTime - intendedStart) / 1000 : 0;
+      latencyHistograms[LATENCY_CORRECTED]->record(corrected > latency ? corrected : latency);
+      if(latencyHistograms[LATENCY_JITTER] != NULL)
+        latencyHistograms[LATENCY_JITTER]->record((uint64_t) (latencyStartTime > intendedStart
+            ? latencyStartTime - intendedStart : intendedStart - latencyStartTime) / 1000);
+    }
+    cphAtomicInc64(&pCounters->iterations);
+    cphSeqlockWriteEnd(&pCounters->sequence);
+  } else {
+    oneIteration();
+    cphAtomicInc64(&pCounters->iterations);
   }
-  iterations++;
+
   if(++its==messages) return false;
   if (yieldRate!=0 && its%yieldRate==0)
     yield();
@@ -290,7 +773,8 @@ inline bool WorkerThread::doOneIteration(unsigned int& its){
 /**
  * Method: pace
  *
- * The main method for this worker thread. Repeatedly calls oneIteration at the desired rate.
+ * The main method for this worker thread. Repeatedly calls oneIteration at the desired rate,
+ * unless the implementation runs the session's iterations from callbacks (see startCallbacks).
  *
  * Returns: true on successful execution, false otherwise
  */
@@ -299,9 +783,20 @@ void WorkerThread::pace() {
   CPHTRACEENTRY(pTrc)
 
   unsigned int its = 0;
+  cphAtomicStore64(&scheduleStart, (uint64_t) cphUtilGetMonotonicNs());
 
-  if(rate==0) // We are not trying to fix the rate
+  if(beginCallbacks()){
+    // Wait for the callbacks to end the session, checking regularly whether we've been asked to shut down
+    while(!shutdown && cphAtomicLoad64(&callbacksEnded) == 0){
+      lockAndWait(callbackLock, MAX_DEADLINE_SLEEP, !shutdown && cphAtomicLoad64(&callbacksEnded) == 0)
+    }
+    finishCallbacks();
+  } else if(globalTokens.isOpen())
+    paceToTokens(its);
+  else if(schedule.empty()) // We are not trying to fix the rate
     while(doOneIteration(its));
+  else if(deadlinePacing)
+    paceToDeadlines(its);
   else { // We are trying to fix the rate
 
     //Nominally, CPH_SLEEP_GRANULARITY has [Dimension: 1/t | Units: 1/seconds]
@@ -365,6 +860,14 @@ void WorkerThread::pace() {
      */
     CPH_TIME windowStart;
 
+    /**
+     * windowStartNs [Dimension: time | Units: nanoseconds]
+     * -------------
+     * The time when the current window started, from cphUtilGetMonotonicNs,
+     * from which the intended start of each iteration is given to doOneIteration.
+     */
+    MQINT64 windowStartNs;
+
     // Ramping Period
     if(rampTime>0){
       CPHTRACEMSG(pTrc, (char*) "Starting ramping period: %ds.", rampTime)
@@ -382,8 +885,10 @@ void WorkerThread::pace() {
       double windowPosition = 0;
 
       windowStart = cphUtilGetNow();
+      windowStartNs = cphUtilGetMonotonicNs();
 
-      while(windowPosition<rampTime && doOneIteration(its)) {
+      // When ramping, iteration n is intended to start sqrt(integral*n) seconds into the window
+      while(windowPosition<rampTime && doOneIteration(its, windowStartNs + (MQINT64) (sqrt(integral*its) * 1000000000))) {
         if(its==nextCheck){
           windowPosition = sqrt(integral*nextCheck);
           CPHTRACEMSG(pTrc, (char*) "Ramping period: %d iterations in %f seconds", nextCheck, windowPosition)
@@ -442,14 +947,24 @@ void WorkerThread::pace() {
      */
     double windowPosition = 0;
 
+    /**
+     * windowPositionIts [Dimension: count | Units: iterations]
+     * -----------------
+     * The value of its when windowPosition was last updated, so that the intended start of
+     * the next iteration is windowPosition + (its-windowPositionIts)*period seconds into the window.
+     */
+    unsigned int windowPositionIts = its;
+
     windowStart = cphUtilGetNow();
+    windowStartNs = cphUtilGetMonotonicNs();
 
     int const minCheckFrequency = (int) round(rate * MIN_PERIOD_BETWEEN_SLEEPS);
 
-    while(doOneIteration(its)) {
+    while(doOneIteration(its, windowStartNs + (MQINT64) ((windowPosition + (its-windowPositionIts)*period) * 1000000000))) {
       if(its==nextCheck){
         windowPosition += period * itsBeforeCheck;
         windowCount += itsBeforeCheck;
+        windowPositionIts = its;
         CPHTRACEMSG(pTrc, (char*) "This window: %d iterations in %lf seconds", windowCount, windowPosition)
 
         double now = cphUtilGetDoubleDuration(windowStart, cphUtilGetNow());
@@ -509,6 +1024,7 @@ void WorkerThread::pace() {
           }
           windowPosition = sleep / CPH_SLEEP_GRANULARITY;
           windowStart = cphUtilGetNow();
+          windowStartNs = cphUtilGetMonotonicNs();
           windowSleep = windowCount = 0;
         }
       }
@@ -518,6 +1034,142 @@ void WorkerThread::pace() {
   CPHTRACEEXIT(pTrc)
 }
 
+/**
+ * Method: paceToDeadlines
+ *
+ * Repeatedly calls oneIteration at the desired rate, sleeping until the absolute deadline
+ * at which each iteration is intended to start (see sleepUntil), so that iterations are evenly
+ * spaced rather than run in batches between periodic sleeps.
+ *
+ * The n'th iteration is intended to start when the schedule has n iterations due (see RateSchedule::getTime):
+ * with rt and rp, that is sqrt(2*rampTime*n/rate) seconds after the start while ramping (so the rate rises
+ * linearly over rampTime), and one period after the previous iteration thereafter.
+ * With random arrivals, n is instead the sum of the gaps drawn by nextArrivalGap, each with a mean of
+ * one iteration, so that iterations arrive at random around the same schedule (e.g. as a Poisson process)
+ * regardless of how long earlier iterations took. As with the window algorithm, a thread that falls more
+ * than WINDOW_SIZE seconds behind schedule moves its schedule on, rather than running too fast for a long
+ * time to catch up. The session ends when the schedule does.
+ */
+void WorkerThread::paceToDeadlines(unsigned int& its) {
+  CPHTRACEREF(pTrc, pConfig->pTrc)
+  CPHTRACEENTRY(pTrc)
+
+  CPHTRACEMSG(pTrc, (char*) "Pacing to deadlines: spin %uus.", spinTime)
+
+  /*The position in the schedule (in iterations) of the next arrival.*/
+  double n = arrivals == ARRIVALS_EVEN ? 0 : nextArrivalGap();
+  MQINT64 deadline;
+  while((deadline = nextDeadline(n)) >= 0){
+    if(deadline > cphUtilGetMonotonicNs())
+      sleepUntil(deadline);
+    if(!doOneIteration(its, deadline)) break;
+  }
+  if(deadline < 0){
+    CPHTRACEMSG(pTrc, (char*) "End of rate schedule after %u iterations.", its)
+  }
+
+  CPHTRACEEXIT(pTrc)
+}
+
+/**
+ * Method: nextDeadline
+ *
+ * Find the time (from cphUtilGetMonotonicNs) the arrival at position n (in iterations) of the schedule is due,
+ * measured from the start of the session, and move n on to the next arrival (see nextArrivalGap).
+ * If that time is more than WINDOW_SIZE seconds ago, the schedule is moved on so that it isn't.
+ *
+ * Returns: the deadline, or -1 if the schedule ends first.
+ */
+MQINT64 WorkerThread::nextDeadline(double &n) {
+  double const due = schedule.getTime(n);
+  if(due < 0) return -1;
+
+  MQINT64 const start = (MQINT64) scheduleStart;
+  MQINT64 deadline = start + (MQINT64) (due * 1000000000);
+  n += nextArrivalGap();
+
+  MQINT64 const maxDeficit = (MQINT64) WINDOW_SIZE * 1000000000;
+  MQINT64 const now = cphUtilGetMonotonicNs();
+  if(now - deadline > maxDeficit){
+    CPHTRACEMSG(pConfig->pTrc, (char*) "Schedule deficit too large, limiting to WINDOW SIZE: %ds", WINDOW_SIZE)
+    cphAtomicStore64(&scheduleStart, (uint64_t) (start + now - deadline - maxDeficit));
+    deadline = now - maxDeficit;
+  }
+  return deadline;
+}
+
+/**
+ * Method: paceToTokens
+ *
+ * Repeatedly calls oneIteration, each time using a token from the global TokenBucket (gr),
+ * so that all the threads sharing it together run at its rate. Tokens are claimed in batches,
+ * and each iteration waits (see sleepUntil) until its token is issued, which is the time it is
+ * intended to start. A thread that stops iterating only holds up the tokens of its current batch;
+ * the rest of the rate is taken up by the others.
+ */
+void WorkerThread::paceToTokens(unsigned int& its) {
+  CPHTRACEREF(pTrc, pConfig->pTrc)
+  CPHTRACEENTRY(pTrc)
+
+  unsigned int const batchSize = globalTokens.getBatchSize();
+  double const interval = globalTokens.getInterval();
+  unsigned int used = batchSize;
+  MQINT64 batchStart = 0;
+  MQINT64 deadline;
+
+  do {
+    if(used == batchSize){
+      batchStart = globalTokens.claim(batchSize);
+      used = 0;
+    }
+    deadline = batchStart + (MQINT64) (used++ * interval);
+    if(deadline > cphUtilGetMonotonicNs())
+      sleepUntil(deadline);
+  } while(doOneIteration(its, deadline));
+
+  CPHTRACEEXIT(pTrc)
+}
+
+/**
+ * Method: nextArrivalGap
+ *
+ * Draw the gap (in iterations, with a mean of 1) between one arrival and the next from the
+ * configured distribution (pa), using a SplitMix64 generator local to this thread.
+ */
+double WorkerThread::nextArrivalGap() {
+  if(arrivals == ARRIVALS_EVEN) return 1;
+
+  uint64_t z = (arrivalRandom += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  z ^= z >> 31;
+  // Uniform in (0,1), never 0 so the logarithm below is finite
+  double const u = ((double) (z >> 11) + 0.5) / 9007199254740992.0;
+
+  return arrivals == ARRIVALS_EXPONENTIAL ? -log(u) : 2 * u;
+}
+
+/**
+ * Method: sleepUntil
+ *
+ * Sleep until deadline (from cphUtilGetMonotonicNs). Sleeps longer than MAX_DEADLINE_SLEEP ms are
+ * broken up so that a shutdown request is noticed promptly; if spinTime is set, the last spinTime
+ * microseconds are spent spinning on the clock instead, to avoid the scheduler's wake-up latency.
+ *
+ * Throws: ShutdownException if the thread is asked to shut down while sleeping.
+ */
+void WorkerThread::sleepUntil(MQINT64 deadline) {
+  MQINT64 const wake = deadline - (MQINT64) spinTime * 1000;
+  MQINT64 const maxSleep = (MQINT64) MAX_DEADLINE_SLEEP * 1000000;
+  MQINT64 now;
+
+  while((now = cphUtilGetMonotonicNs()) < wake){
+    cphUtilSleepUntilNs(wake - now > maxSleep ? now + maxSleep : wake);
+    checkShutdown();
+  }
+  while(cphUtilGetMonotonicNs() < deadline);
+}
+
 /**
  * Method: getState
  *
@@ -537,35 +1189,160 @@ unsigned int WorkerThread::getState() const {
  *
  * Returns: the number of iterations executed by this worker thread
  */
-unsigned int WorkerThread::getIterations() const {
-  return iterations;
+uint64_t WorkerThread::getIterations() const {
+  return cphAtomicLoad64(&pCounters->iterations);
+}
+
+/**
+ * Static Method: isPaced
+ *
+ * Returns true if worker threads are paced to a target rate (rt, pf or gr).
+ */
+bool WorkerThread::isPaced() {
+  return !schedule.empty() || globalTokens.isOpen();
+}
+
+/**
+ * Static Method: getGlobalRate
+ *
+ * Returns the total rate (iterations/second) shared by all threads (gr), or 0 if not set.
+ */
+double WorkerThread::getGlobalRate() {
+  return globalTokens.getRate();
+}
+
+/**
+ * Method: getTargetIterations
+ *
+ * Returns the (fractional) number of iterations the target rate called for in the current (or last)
+ * session by the given time (from cphUtilGetMonotonicNs), or 0 if the thread hasn't started pacing.
+ */
+double WorkerThread::getTargetIterations(MQINT64 at) const {
+  MQINT64 const start = (MQINT64) cphAtomicLoad64(&scheduleStart);
+  if(start == 0 || schedule.empty()) return 0;
+  return schedule.getIterations((double) (at - start) / 1000000000);
 }
 
 /**
  * Method: setCollectLatencyStats
  *
- * This method toggles the collection of latency timestamps
+ * This method toggles the collection of latency timestamps. When paced, the corrected latency
+ * is also collected, and the jitter too if each iteration has its own intended start time (pm=deadline,
+ * gr or np); the window pacer runs iterations in batches, so their start times mean nothing.
+ * Must be called after the thread is added to any WorkerPool.
  *
  */
 void WorkerThread::setCollectLatencyStats(bool flag) {
+  if(flag){
+    enableLatencyStats(LATENCY_ITERATION);
+    if(isPaced()){
+      enableLatencyStats(LATENCY_CORRECTED);
+      if(deadlinePacing || globalTokens.isOpen() || pooled)
+        enableLatencyStats(LATENCY_JITTER);
+    }
+  }
   collectLatencyStats = flag;
 }
 
+/**
+ * Method: enableLatencyStats
+ *
+ * This method creates the histogram for the given type of latency, so that recordLatency
+ * can be called for it. It must be called before the thread is started.
+ *
+ */
+void WorkerThread::enableLatencyStats(LatencyType type) {
+  if(latencyHistograms[type] == NULL){
+    latencyHistograms[type] = new (WorkerCountersArray::getHistogramStorage(pCounters, type)) Histogram();
+    pCounters->collecting |= 1u << type;
+  }
+}
+
+/**
+ * Method: isCollectingLatencyStats
+ *
+ * This method returns whether this worker thread records the given type of latency.
+ *
+ */
+bool WorkerThread::isCollectingLatencyStats(LatencyType type) const {
+  return latencyHistograms[type] != NULL;
+}
+
 /**
  * Method: getLatencyStats
  *
- * This method returns the current values for avgLatency, maxLatency and minLatency
- * then resets them.
+ * This method copies the latency histogram of the given type accumulated by this worker thread
+ * since it started into the given histogram (which is left empty if that type is not collected).
+ * The worker's histogram is never reset, so callers wanting per-interval figures should
+ * subtract the previous snapshot.
+ *
+ */
+void WorkerThread::getLatencyStats(Histogram &snapshot, LatencyType type) const {
+  if(latencyHistograms[type] == NULL)
+    snapshot.reset();
+  else {
+    for(unsigned int attempt = 0; attempt < CPH_SEQLOCK_READ_ATTEMPTS; attempt++){
+      uint64_t seq = cphSeqlockReadBegin(&pCounters->sequence);
+      latencyHistograms[type]->snapshot(snapshot);
+      if(!cphSeqlockReadRetry(&pCounters->sequence, seq)) break;
+    }
+  }
+}
+
+/**
+ * Method: setCollectCallStats
+ *
+ * This method toggles the collection of per-call statistics by implementations that make
+ * calls to a messaging provider. It must be called before the thread is started.
  *
  */
-void WorkerThread::getLatencyStats(long statsArray[]) {
-  statsArray[0] = avgLatency;
-  statsArray[1] = maxLatency;
-  statsArray[2] = minLatency;
+void WorkerThread::setCollectCallStats(bool flag) {
+  if(flag && pCallStats == NULL){
+    pCallStats = new (WorkerCountersArray::getCallStatsStorage(pCounters)) CallStats();
+    pCounters->collecting |= CPH_STATS_COLLECTING_CALLS;
+  } else if(!flag){
+    pCounters->collecting &= ~CPH_STATS_COLLECTING_CALLS;
+    pCallStats = NULL;
+  }
+}
 
-  minLatency=LONG_MAX;
-  maxLatency=0;
-  latencyIter=0;
+/**
+ * Method: isCollectingCallStats
+ *
+ * This method returns whether this worker thread records per-call statistics.
+ *
+ */
+bool WorkerThread::isCollectingCallStats() const {
+  return pCallStats != NULL;
+}
+
+/**
+ * Method: getCallStats
+ *
+ * This method copies the per-call statistics accumulated by this worker thread since it
+ * started into the given object (which is left empty if they are not collected).
+ *
+ */
+void WorkerThread::getCallStats(CallStats &snapshot) const {
+  if(pCallStats == NULL)
+    snapshot.reset();
+  else
+    pCallStats->snapshot(snapshot);
+}
+
+/**
+ * Method: getCpuTime
+ *
+ * This method finds the CPU time used by the worker thread so far, or in total once it has ended.
+ *
+ * Returns: true if the CPU time could be found, false otherwise
+ */
+bool WorkerThread::getCpuTime(CpuTime &cpu) const {
+  if(cpuTimeFinal){
+    cpu = finalCpuTime;
+    return true;
+  }
+  return Thread::getCpuTime(cpu);
 }
 
 /**
@@ -35,6 +35,12 @@
 #include "cphdefs.h"
 #include "Thread.hpp"
 #include "ControlThread.hpp"
+#include "Histogram.hpp"
+#include "CallStats.hpp"
+#include "WorkerCounters.hpp"
+#include "RateSchedule.hpp"
+#include "TokenBucket.hpp"
+#include "ThreadPlacement.hpp"
 #include "cphUtil.h"
 #include "cphConfig.h"
 #include "cphTrace.h"
@@ -108,36 +114,69 @@ private:
   static unsigned int seq;
   static unsigned int count;
 
-  /*A code representing the current state of this WorkerThread.*/
-  unsigned int state;
-  /*The total number of iterations completed so far by this WorkerThread.*/
-  unsigned int iterations;
+  /*This thread's slot in its ControlThread's WorkerCountersArray, holding its state, counters and statistics.*/
+  WorkerCounters * const pCounters;
+  /*A code representing the current state of this WorkerThread (published in its slot).*/
+  volatile uint32_t & state;
   /*The time when the thread first starts running iterations, after opening the initial session.*/
   CPH_TIME startTime;
   /*The time when the thread completes execution.*/
   CPH_TIME endTime;
+  /*The CPU time used by the thread, recorded as it completes execution (once cpuTimeFinal is set).*/
+  CpuTime finalCpuTime;
+  volatile bool cpuTimeFinal;
+  /*The time (from cphUtilGetMonotonicNs) the target rate of the current session is measured from, or 0 before the first.*/
+  volatile uint64_t scheduleStart;
+  /*The state of the generator of this thread's arrival times (see nextArrivalGap).*/
+  uint64_t arrivalRandom;
   
-  /*Latency stats variables*/
+  /*Whether to time each iteration, recording the result in latencyHistograms[LATENCY_ITERATION].*/
   bool collectLatencyStats;
-  long maxLatency;
-  long minLatency;
-  long avgLatency;
-  long latencyIter;
-
-  CPH_TIME latencyStartTime;
-  CPH_TIME latencyStopTime;
-  long latency;
-
+  /*Distributions of latencies (microseconds) by LatencyType, only written by this thread, held in its slot. NULL if not collected.*/
+  Histogram * latencyHistograms[LATENCY_TYPES];
   
   /*A pointer to the control thread that created this WorkerThread.*/
   ControlThread * const pControlThread;
 
+  /*Whether this thread is driven by a WorkerPool (np), rather than running on its own.*/
+  bool pooled;
+  /*Progress through the current session when driven by a WorkerPool (np), kept between calls to poolStep.*/
+  unsigned int poolIts;
+  unsigned int poolSessions;
+  double poolPosition;
+  MQINT64 poolDeadline;
+  /*Whether the iterations of the current session are run by callbacks (see startCallbacks) rather than poolStep.*/
+  bool callbackDriven;
+  /*The number of iterations run by callbacks in the current session.*/
+  unsigned int callbackIts;
+  /*Set (non-zero) by endCallbacks once callbacks have finished the session, with callbackError set if they failed.*/
+  volatile uint64_t callbacksEnded;
+  std::string callbackError;
+  /*Notified by endCallbacks.*/
+  Lock callbackLock;
+
   void pace();
+  void paceToDeadlines(unsigned int& its);
+  void paceToTokens(unsigned int& its);
+  MQINT64 nextDeadline(double &n);
+  double nextArrivalGap();
+  void sleepUntil(MQINT64 deadline);
   virtual void run();
+  void fail(std::runtime_error const &e);
+  void finish();
+  bool beginCallbacks();
+  void finishCallbacks();
 
   inline void _openSession();
   inline void _closeSession();
-  inline bool doOneIteration(unsigned int& its);
+  inline bool doOneIteration(unsigned int& its, MQINT64 intendedStart = 0);
+
+  friend class WorkerPool;
+  bool poolOpen();
+  MQINT64 poolBegin();
+  MQINT64 poolBeginSession();
+  MQINT64 poolStep();
+  void poolAbort(std::runtime_error const &e);
 
 protected:
   // Configuration values - see WorkerThread.properties
@@ -145,11 +184,21 @@ protected:
   static float rate;
   static unsigned int yieldRate;
   static unsigned int rampTime;
+  static bool deadlinePacing;
+  static unsigned int spinTime;
+  enum Arrivals {ARRIVALS_EVEN, ARRIVALS_EXPONENTIAL, ARRIVALS_UNIFORM};
+  static Arrivals arrivals;
+  static unsigned int arrivalSeed;
+  static RateSchedule schedule;
+  static TokenBucket globalTokens;
+  static ThreadPlacement placement;
+  static bool localBuffers;
   static unsigned int sessions;
   static unsigned int sessionInterval;
 
-  /*The name of the class providing the final implementation of this WorkerThread.*/
-  std::string const className;
+  /*Counts and times of the calls made to the messaging provider by this thread, held in its slot, or NULL if not collected (vs).*/
+  CallStats * pCallStats;
+
   /*A unique identifier of this WorkerThread among others - the sequence number of object creation.*/
   unsigned int const threadNum;
   /*
@@ -189,15 +238,49 @@ protected:
 
   static int getWorkerCount();
 
+  virtual void allocateLocalBuffers();
+
+  virtual bool startCallbacks();
+  virtual void stopCallbacks();
+  bool callbackIteration(MQINT64 start);
+  void endCallbacks(char const * const error);
+  bool isPooled() const { return pooled; }
+
+  void enableLatencyStats(LatencyType type);
+
+  /*
+   * Method: recordLatency
+   * ---------------------
+   *
+   * Record a latency (in microseconds) of the given type,
+   * which must previously have been enabled by enableLatencyStats.
+   */
+  inline void recordLatency(LatencyType type, uint64_t latency) {
+    cphSeqlockWriteBegin(&pCounters->sequence);
+    latencyHistograms[type]->record(latency);
+    cphSeqlockWriteEnd(&pCounters->sequence);
+  }
+
 public:
+  /*The name of the class providing the final implementation of this WorkerThread.*/
+  std::string const className;
   std::string const name;
 
   WorkerThread(ControlThread *pControlThread, std::string className);
   virtual ~WorkerThread();
   unsigned int getState() const;
-  unsigned int getIterations() const;
+  uint64_t getIterations() const;
   void setCollectLatencyStats(bool flag);
-  void getLatencyStats(long statsArray[]);
+  bool isCollectingLatencyStats(LatencyType type) const;
+  void getLatencyStats(Histogram &snapshot, LatencyType type) const;
+  void setCollectCallStats(bool flag);
+  bool isCollectingCallStats() const;
+  void getCallStats(CallStats &snapshot) const;
+  static bool isPaced();
+  static double getGlobalRate();
+  double getTargetIterations(MQINT64 at) const;
+  virtual bool getCpuTime(CpuTime &cpu) const;
+  virtual bool canRunPooled() const;
   CPH_TIME getStartTime() const;
   CPH_TIME getEndTime() const;
 };
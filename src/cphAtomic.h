@@ -0,0 +1,171 @@
+/*<copyright notice="lm-source" pids="" years="2026">*/
+/*******************************************************************************
+ * Copyright (c) 2026 IBM Corp.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+/*
+ * Contributors:
+ *    Various members of the WebSphere MQ Performance Team at IBM Hursley UK
+ *******************************************************************************/
+/*</copyright>*/
+/*******************************************************************************/
+/*                                                                             */
+/* Performance Harness for IBM MQ C-MQI interface                              */
+/*                                                                             */
+/*******************************************************************************/
+
+/*
+ * cphAtomic.h
+ * -----------
+ *
+ * Minimal set of lock-free 64-bit operations, used to publish counters from
+ * worker threads to the threads reporting on them without taking a lock.
+ *
+ * cphAtomicLoad64/cphAtomicStore64 are intended for the single-writer case,
+ * where the owning thread is the only one updating the value, and compile
+ * down to plain loads and stores on 64-bit platforms.
+ * cphAtomicAdd64 and cphAtomicCompareAndSwap64 are full read-modify-writes and
+ * are safe with many writers.
+ *
+ * The cphSeqlock functions let a single writer update a group of values that
+ * readers on other threads (or processes sharing the memory) copy consistently:
+ * the writer makes the sequence number odd while updating, and readers retry
+ * if it was odd or changed during their copy. All the values in the group must
+ * themselves be written with cphAtomicStore64/cphAtomicInc64.
+ */
+
+#ifndef _CPHATOMIC
+#define _CPHATOMIC
+
+#include "cphdefs.h"
+
+#if defined(_MSC_VER)
+  #include <Windows.h>
+  #if _MSC_VER < 1600
+    #include "msint.h"
+  #else
+    #include <stdint.h>
+  #endif
+  #define CPH_ATOMIC_INLINE static __inline
+#else
+  #include <stdint.h>
+  #define CPH_ATOMIC_INLINE static inline
+#endif
+
+#if defined(__cplusplus)
+   extern "C" {
+#endif
+
+CPH_ATOMIC_INLINE uint64_t cphAtomicLoad64(volatile uint64_t const *pValue) {
+#if defined(GCC_VERSION) && GCC_VERSION >= 40700
+  return __atomic_load_n(pValue, __ATOMIC_ACQUIRE);
+#elif defined(_MSC_VER) && defined(_WIN64)
+  return *pValue;
+#elif defined(_MSC_VER)
+  return (uint64_t) InterlockedCompareExchange64((volatile LONGLONG *) pValue, 0, 0);
+#else
+  return __sync_fetch_and_add((volatile uint64_t *) pValue, 0);
+#endif
+}
+
+CPH_ATOMIC_INLINE void cphAtomicStore64(volatile uint64_t *pValue, uint64_t value) {
+#if defined(GCC_VERSION) && GCC_VERSION >= 40700
+  __atomic_store_n(pValue, value, __ATOMIC_RELEASE);
+#elif defined(_MSC_VER) && defined(_WIN64)
+  *pValue = value;
+#elif defined(_MSC_VER)
+  InterlockedExchange64((volatile LONGLONG *) pValue, (LONGLONG) value);
+#else
+  __sync_synchronize();
+  *pValue = value;
+  __sync_synchronize();
+#endif
+}
+
+/* Returns the value after the addition */
+CPH_ATOMIC_INLINE uint64_t cphAtomicAdd64(volatile uint64_t *pValue, uint64_t delta) {
+#if defined(GCC_VERSION) && GCC_VERSION >= 40700
+  return __atomic_add_fetch(pValue, delta, __ATOMIC_ACQ_REL);
+#elif defined(_MSC_VER)
+  return (uint64_t) InterlockedExchangeAdd64((volatile LONGLONG *) pValue, (LONGLONG) delta) + delta;
+#else
+  return __sync_add_and_fetch(pValue, delta);
+#endif
+}
+
+/* Sets the value to desired if it is expected, returning non-zero if it was */
+CPH_ATOMIC_INLINE int cphAtomicCompareAndSwap64(volatile uint64_t *pValue, uint64_t expected, uint64_t desired) {
+#if defined(GCC_VERSION) && GCC_VERSION >= 40700
+  return __atomic_compare_exchange_n(pValue, &expected, desired, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+#elif defined(_MSC_VER)
+  return (uint64_t) InterlockedCompareExchange64((volatile LONGLONG *) pValue, (LONGLONG) desired, (LONGLONG) expected) == expected;
+#else
+  return __sync_bool_compare_and_swap(pValue, expected, desired);
+#endif
+}
+
+/* Single-writer increment: cheaper than cphAtomicAdd64 as no bus lock is taken */
+CPH_ATOMIC_INLINE void cphAtomicInc64(volatile uint64_t *pValue) {
+  cphAtomicStore64(pValue, cphAtomicLoad64(pValue) + 1);
+}
+
+/* Orders all earlier loads and stores before later stores */
+CPH_ATOMIC_INLINE void cphAtomicReleaseFence(void) {
+#if defined(GCC_VERSION) && GCC_VERSION >= 40700
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+#elif defined(_MSC_VER)
+  MemoryBarrier();
+#else
+  __sync_synchronize();
+#endif
+}
+
+/* Orders all earlier loads before later loads and stores */
+CPH_ATOMIC_INLINE void cphAtomicAcquireFence(void) {
+#if defined(GCC_VERSION) && GCC_VERSION >= 40700
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+#elif defined(_MSC_VER)
+  MemoryBarrier();
+#else
+  __sync_synchronize();
+#endif
+}
+
+/* The number of times a reader copies a seqlocked group before settling for an inconsistent copy */
+#define CPH_SEQLOCK_READ_ATTEMPTS 8
+
+CPH_ATOMIC_INLINE void cphSeqlockWriteBegin(volatile uint64_t *pSequence) {
+  cphAtomicStore64(pSequence, *pSequence + 1);
+  cphAtomicReleaseFence();
+}
+
+CPH_ATOMIC_INLINE void cphSeqlockWriteEnd(volatile uint64_t *pSequence) {
+  cphAtomicStore64(pSequence, *pSequence + 1);
+}
+
+/* Returns the sequence number to pass to cphSeqlockReadRetry, or an odd number if a write is in progress */
+CPH_ATOMIC_INLINE uint64_t cphSeqlockReadBegin(volatile uint64_t const *pSequence) {
+  return cphAtomicLoad64(pSequence);
+}
+
+/* Returns non-zero if the values copied since cphSeqlockReadBegin may be inconsistent */
+CPH_ATOMIC_INLINE int cphSeqlockReadRetry(volatile uint64_t const *pSequence, uint64_t sequence) {
+  cphAtomicAcquireFence();
+  return (sequence & 1) != 0 || cphAtomicLoad64(pSequence) != sequence;
+}
+
+#if defined(__cplusplus)
+   }
+#endif
+#endif
@@ -511,6 +511,80 @@ void MQENTRY MQSUB (
   }
 }
 
+#ifndef CPH_WMQV6
+/*********************************************************************/
+/*  MQCB Function -- Register a message consumer callback            */
+/*********************************************************************/
+
+void MQENTRY MQCB (
+  MQHCONN  Hconn,         /* I: Connection handle */
+  MQLONG   Operation,     /* I: Operation */
+  PMQVOID  pCallbackDesc, /* I: Callback descriptor */
+  MQHOBJ   Hobj,          /* I: Object handle */
+  PMQVOID  pMsgDesc,      /* I: Message descriptor */
+  PMQVOID  pGetMsgOpts,   /* I: Get message options */
+  PMQLONG  pCompCode,     /* OC: Completion code */
+  PMQLONG  pReason)       /* OR: Reason code qualifying CompCode */
+{
+  if (ETM_DLL_found && ETM_dynamic_MQ_entries.mqcb)
+  {
+    (ETM_dynamic_MQ_entries.mqcb)(Hconn,Operation,pCallbackDesc,Hobj,pMsgDesc,pGetMsgOpts,pCompCode,pReason);
+  }
+  else
+  {
+    *pCompCode = MQCC_FAILED;
+    //*pReason   = MQRC_LIBRARY_LOAD_ERROR;
+    *pReason   = 6000;
+  }
+}
+
+/*********************************************************************/
+/*  MQCTL Function -- Start or stop message consumer callbacks       */
+/*********************************************************************/
+
+void MQENTRY MQCTL (
+  MQHCONN  Hconn,         /* I: Connection handle */
+  MQLONG   Operation,     /* I: Operation */
+  PMQVOID  pControlOpts,  /* I: Control options */
+  PMQLONG  pCompCode,     /* OC: Completion code */
+  PMQLONG  pReason)       /* OR: Reason code qualifying CompCode */
+{
+  if (ETM_DLL_found && ETM_dynamic_MQ_entries.mqctl)
+  {
+    (ETM_dynamic_MQ_entries.mqctl)(Hconn,Operation,pControlOpts,pCompCode,pReason);
+  }
+  else
+  {
+    *pCompCode = MQCC_FAILED;
+    //*pReason   = MQRC_LIBRARY_LOAD_ERROR;
+    *pReason   = 6000;
+  }
+}
+
+/*********************************************************************/
+/*  MQSTAT Function -- Retrieve status information                   */
+/*********************************************************************/
+
+void MQENTRY MQSTAT (
+  MQHCONN  Hconn,         /* I: Connection handle */
+  MQLONG   Type,          /* I: Type of status information */
+  PMQVOID  pStatus,       /* IO: Status information */
+  PMQLONG  pCompCode,     /* OC: Completion code */
+  PMQLONG  pReason)       /* OR: Reason code qualifying CompCode */
+{
+  if (ETM_DLL_found && ETM_dynamic_MQ_entries.mqstat)
+  {
+    (ETM_dynamic_MQ_entries.mqstat)(Hconn,Type,pStatus,pCompCode,pReason);
+  }
+  else
+  {
+    *pCompCode = MQCC_FAILED;
+    //*pReason   = MQRC_LIBRARY_LOAD_ERROR;
+    *pReason   = 6000;
+  }
+}
+#endif
+
 /*
 ** Method: cphMQSplitterCheckMQLoaded
 **
@@ -613,6 +687,9 @@ long cphMQSplitterLoadMQ(CPH_LOG *pLog, Pmq_epList ep, int isClient)
     ep->mqcrtmh  = (MQCRTMHPTR) GetProcAddress(pLibrary,"MQCRTMH");
     ep->mqdltmh  = (MQDLTMHPTR) GetProcAddress(pLibrary,"MQDLTMH");
     ep->mqsetmp  = (MQSETMPPTR) GetProcAddress(pLibrary,"MQSETMP");
+    ep->mqcb     = (MQCBPTR)    GetProcAddress(pLibrary,"MQCB");
+    ep->mqctl    = (MQCTLPTR)   GetProcAddress(pLibrary,"MQCTL");
+    ep->mqstat   = (MQSTATPTR)  GetProcAddress(pLibrary,"MQSTAT");
 #endif
 
   rc = TRUE;     /* TRUE means it worked - dll was found */
@@ -704,6 +781,9 @@ long cphMQSplitterLoadMQ(CPH_LOG *pLog, Pmq_epList ep, int isClient)
     explen = strlen("MQCRTMH"); QleGetExpLong(&actmark, 0, &explen, "MQCRTMH", &ep->mqcrtmh, &exptype, &errorinfo);
     explen = strlen("MQMQDLTMH"); QleGetExpLong(&actmark, 0, &explen, "MQDLTMH", &ep->mqdltmh, &exptype, &errorinfo);
     explen = strlen("MQSETMP"); QleGetExpLong(&actmark, 0, &explen, "MQSETMP", &ep->mqsetmp, &exptype, &errorinfo);
+    explen = strlen("MQCB"); QleGetExpLong(&actmark, 0, &explen, "MQCB", &ep->mqcb, &exptype, &errorinfo);
+    explen = strlen("MQCTL"); QleGetExpLong(&actmark, 0, &explen, "MQCTL", &ep->mqctl, &exptype, &errorinfo);
+    explen = strlen("MQSTAT"); QleGetExpLong(&actmark, 0, &explen, "MQSTAT", &ep->mqstat, &exptype, &errorinfo);
 #endif
   rc = 1; /* to show it worked */
   }
@@ -783,6 +863,9 @@ long cphMQSplitterLoadMQ(CPH_LOG *pLog, Pmq_epList ep, int isClient)
     ep->mqcrtmh  = (MQCRTMHPTR)  dlsym(pLibrary,"MQCRTMH");
     ep->mqdltmh  = (MQDLTMHPTR)  dlsym(pLibrary,"MQDLTMH");
     ep->mqsetmp  = (MQSETMPPTR)  dlsym(pLibrary,"MQSETMP");
+    ep->mqcb     = (MQCBPTR)     dlsym(pLibrary,"MQCB");
+    ep->mqctl    = (MQCTLPTR)    dlsym(pLibrary,"MQCTL");
+    ep->mqstat   = (MQSTATPTR)   dlsym(pLibrary,"MQSTAT");
 #endif
     rc = 1; /* to show it worked */
   }
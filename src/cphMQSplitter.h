@@ -179,6 +179,30 @@ typedef void (MQENTRY *MQDLTMHPTR) (
   PMQVOID  pDltMsgHOpts,
   PMQLONG  pCompCode,
   PMQLONG  pReason);
+
+typedef void (MQENTRY *MQCBPTR) (
+  MQHCONN  Hconn,
+  MQLONG   Operation,
+  PMQVOID  pCallbackDesc,
+  MQHOBJ   Hobj,
+  PMQVOID  pMsgDesc,
+  PMQVOID  pGetMsgOpts,
+  PMQLONG  pCompCode,
+  PMQLONG  pReason);
+
+typedef void (MQENTRY *MQCTLPTR) (
+  MQHCONN  Hconn,
+  MQLONG   Operation,
+  PMQVOID  pControlOpts,
+  PMQLONG  pCompCode,
+  PMQLONG  pReason);
+
+typedef void (MQENTRY *MQSTATPTR) (
+  MQHCONN  Hconn,
+  MQLONG   Type,
+  PMQVOID  pStatus,
+  PMQLONG  pCompCode,
+  PMQLONG  pReason);
 #endif
 
 #if defined(WIN32)
@@ -243,6 +267,9 @@ typedef struct mq_epList
   MQCRTMHPTR mqcrtmh;
   MQDLTMHPTR mqdltmh;
   MQSETMPPTR mqsetmp;
+  MQCBPTR    mqcb;
+  MQCTLPTR   mqctl;
+  MQSTATPTR  mqstat;
 #endif
 } mq_epList;
 
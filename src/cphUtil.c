@@ -37,6 +37,7 @@
    #endif
    #include <unistd.h>
    #include <pthread.h>
+   #include <errno.h>
 #endif
 
 #include <stdio.h>
@@ -61,6 +62,27 @@ long CountsPerMicrosecond;
 uint64_t performanceFrequency;
 #endif
 
+/* The processor's time stamp counter can be used as the timebase (see cphUtilTimebaseIni) on x86 */
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+  #include <x86intrin.h>
+  #include <cpuid.h>
+  #define CPH_TSC
+#elif (defined(_M_X64) || defined(_M_IX86)) && defined(_MSC_VER)
+  #include <intrin.h>
+  #define CPH_TSC
+#endif
+
+/* How long to calibrate the time stamp counter against the clock for, in milliseconds */
+#define TSC_CALIBRATION_MS 50
+
+#if defined(CPH_TSC)
+/* Whether cphUtilGetTimestampNs reads the time stamp counter, and how to convert its value to nanoseconds */
+static int tscEnabled = CPHFALSE;
+static uint64_t tscAnchor;
+static MQINT64 tscAnchorNs;
+static double tscNsPerTick;
+#endif
+
 /*
 ** Method: cphUtilSleep
 **
@@ -86,6 +108,43 @@ void cphUtilSleep( int mSecs ) {
 #endif
 }
 
+/*
+** Method: cphUtilSleepUntilNs
+**
+** Sleep until the clock read by cphUtilGetMonotonicNs reaches the given value. Where the platform supports
+** it, the deadline is absolute (clock_nanosleep with TIMER_ABSTIME), so neither the time taken to work it out
+** nor a sleep being interrupted by a signal delays it; elsewhere the remaining time is slept for instead
+** (rounded down to a whole number of milliseconds on Windows).
+**
+** Input Parameters: deadline - the value of cphUtilGetMonotonicNs to sleep until
+**
+*/
+void cphUtilSleepUntilNs(MQINT64 deadline) {
+#if defined(WIN32)
+   MQINT64 remaining = deadline - cphUtilGetMonotonicNs();
+   if(remaining >= 1000000) Sleep((DWORD) (remaining / 1000000));
+#elif defined(AMQ_AS400)
+   struct timeval tval;
+   MQINT64 remaining = deadline - cphUtilGetMonotonicNs();
+   if(remaining <= 0) return;
+   tval.tv_sec  = (long) (remaining / 1000000000);
+   tval.tv_usec = (long) ((remaining % 1000000000) / 1000);
+   select(0, NULL, NULL, NULL, &tval);
+#elif defined(AMQ_MACOS)
+   struct timespec rqtp;
+   MQINT64 remaining = deadline - cphUtilGetMonotonicNs();
+   if(remaining <= 0) return;
+   rqtp.tv_sec  = (time_t) (remaining / 1000000000);
+   rqtp.tv_nsec = (long) (remaining % 1000000000);
+   nanosleep(&rqtp, NULL);
+#else
+   struct timespec rqtp;
+   rqtp.tv_sec  = (time_t) (deadline / 1000000000);
+   rqtp.tv_nsec = (long) (deadline % 1000000000);
+   while(EINTR == clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &rqtp, NULL));
+#endif
+}
+
 /*
 ** Method: cphUtilTimeIni
 **
@@ -115,7 +174,8 @@ int cphUtilTimeIni(CPH_TIME *pTime) {
 ** Windows and Linux.
 **
 ** Returns: The CPH_TIME value corresponding to the current time. This is only guaranteed to be useful for comparing times
-** (establishing durations). It is not intended to be used for time-stamping.
+** (establishing durations). It is not intended to be used for time-stamping. Where the platform has one, the
+** time is read from a monotonic clock, so durations are not affected by changes to the system time.
 **
 */
 CPH_TIME cphUtilGetNow() {
@@ -135,12 +195,213 @@ CPH_TIME cphUtilGetNow() {
   /* on other Unix platforms.                                          */
    gettimeofday(&ret, NULL);
 #else
-   clock_gettime(CLOCK_REALTIME, &ret);
+  /* Use the monotonic clock, so that durations aren't affected by     */
+  /* the system time being stepped or slewed (e.g. by NTP)             */
+   clock_gettime(CLOCK_MONOTONIC, &ret);
 #endif
 #endif
    return ret;
 }
 
+/*
+** Method: cphUtilGetMonotonicNs
+**
+** Get a timestamp from a clock that is not affected by changes to the system time, so that
+** timestamps taken by different threads or processes on the same machine can be compared.
+** The epoch of the clock is arbitrary.
+**
+** Returns: the current value of the clock in nanoseconds
+**
+*/
+MQINT64 cphUtilGetMonotonicNs() {
+#if defined(AMQ_NT)
+   LARGE_INTEGER now;
+   if(performanceFrequency==0){
+      LARGE_INTEGER freq;
+      QueryPerformanceFrequency(&freq);
+      performanceFrequency = freq.QuadPart;
+   }
+   QueryPerformanceCounter(&now);
+   return (MQINT64) ((now.QuadPart / performanceFrequency) * 1000000000
+                   + ((now.QuadPart % performanceFrequency) * 1000000000) / performanceFrequency);
+#elif defined(AMQ_AS400) || defined(AMQ_MACOS)
+   /* No monotonic clock available to us here, so fall back to the time of day */
+   struct timeval now;
+   gettimeofday(&now, NULL);
+   return (MQINT64) now.tv_sec * 1000000000 + (MQINT64) now.tv_usec * 1000;
+#else
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return (MQINT64) now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+#if defined(CPH_TSC)
+/*
+** Method: cphUtilTscIsInvariant
+**
+** Whether the processor says its time stamp counter runs at a constant rate in all power states,
+** so that it can be used to measure time.
+*/
+static int cphUtilTscIsInvariant(void) {
+#if defined(_MSC_VER)
+   int regs[4];
+   __cpuid(regs, 0x80000000);
+   if((unsigned int) regs[0] < 0x80000007) return CPHFALSE;
+   __cpuid(regs, 0x80000007);
+   return (regs[3] & (1 << 8)) ? CPHTRUE : CPHFALSE;
+#else
+   unsigned int eax, ebx, ecx, edx;
+   if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return CPHFALSE;
+   return (edx & (1 << 8)) ? CPHTRUE : CPHFALSE;
+#endif
+}
+
+/*
+** Method: cphUtilTscSample
+**
+** Read the time stamp counter and cphUtilGetMonotonicNs together, taking the pair read closest
+** together of a few attempts so that being descheduled between them has little effect.
+*/
+static void cphUtilTscSample(uint64_t *pTsc, MQINT64 *pNs) {
+   int i;
+   uint64_t best = 0;
+   for(i = 0; i < 10; i++){
+      uint64_t before = __rdtsc();
+      MQINT64 ns = cphUtilGetMonotonicNs();
+      uint64_t after = __rdtsc();
+      if(i == 0 || after - before < best){
+         best = after - before;
+         *pTsc = before + (after - before) / 2;
+         *pNs = ns;
+      }
+   }
+}
+#endif
+
+/*
+** Method: cphUtilTimebaseIni
+**
+** Choose the timebase read by cphUtilGetTimestampNs. This must be called before any other threads are
+** started. When the time stamp counter is requested it is calibrated against the monotonic clock, which
+** takes TSC_CALIBRATION_MS milliseconds, and the clock continues to be used if the processor doesn't have
+** an invariant counter, or the calibration gives an implausible frequency.
+**
+** Input Parameters: useTsc - CPHTRUE to use the processor's time stamp counter, CPHFALSE to use the monotonic clock
+**
+** Returns: CPHTRUE if the time stamp counter is now being used, CPHFALSE otherwise
+**
+*/
+int cphUtilTimebaseIni(int useTsc) {
+#if defined(CPH_TSC)
+   uint64_t tsc1, tsc2;
+   MQINT64 ns1, ns2;
+   double nsPerTick;
+
+   tscEnabled = CPHFALSE;
+   if(useTsc != CPHTRUE || cphUtilTscIsInvariant() != CPHTRUE) return CPHFALSE;
+
+   cphUtilTscSample(&tsc1, &ns1);
+   cphUtilSleep(TSC_CALIBRATION_MS);
+   cphUtilTscSample(&tsc2, &ns2);
+   if(tsc2 <= tsc1 || ns2 <= ns1) return CPHFALSE;
+
+   /* Allow for counters between 100MHz and 10GHz */
+   nsPerTick = (double) (ns2 - ns1) / (double) (tsc2 - tsc1);
+   if(nsPerTick < 0.1 || nsPerTick > 10) return CPHFALSE;
+
+   tscAnchor = tsc2;
+   tscAnchorNs = ns2;
+   tscNsPerTick = nsPerTick;
+   tscEnabled = CPHTRUE;
+   return CPHTRUE;
+#else
+   (void) useTsc;
+   return CPHFALSE;
+#endif
+}
+
+/*
+** Method: cphUtilGetTimestampNs
+**
+** Get a timestamp from the timebase chosen by cphUtilTimebaseIni, for timing short intervals within this
+** process (such as single iterations or MQI calls) as cheaply as possible. When the time stamp counter is
+** in use, the result is scaled to nanoseconds and starts from the value of cphUtilGetMonotonicNs at the end
+** of calibration, but may drift from it by the calibration error, so it must not be compared with values
+** from cphUtilGetMonotonicNs or from other processes.
+**
+** Returns: the current value of the timebase in nanoseconds
+**
+*/
+MQINT64 cphUtilGetTimestampNs() {
+#if defined(CPH_TSC)
+   if(tscEnabled == CPHTRUE)
+      return tscAnchorNs + (MQINT64) ((double) (MQINT64) (__rdtsc() - tscAnchor) * tscNsPerTick);
+#endif
+   return cphUtilGetMonotonicNs();
+}
+
+/*
+** Method: cphUtilGetTimebaseFrequency
+**
+** Returns: the calibrated frequency (Hz) of the time stamp counter if cphUtilGetTimestampNs is reading it, 0 otherwise
+**
+*/
+double cphUtilGetTimebaseFrequency() {
+#if defined(CPH_TSC)
+   if(tscEnabled == CPHTRUE) return 1000000000 / tscNsPerTick;
+#endif
+   return 0;
+}
+
+/*
+** Method: cphUtilGetTimestampCost
+**
+** Measure the average time taken by a call to cphUtilGetTimestampNs, which is the overhead added
+** to each measurement taken with it.
+**
+** Returns: the time taken by each call in nanoseconds
+**
+*/
+double cphUtilGetTimestampCost() {
+   int i;
+   int const calls = 100000;
+   volatile MQINT64 last = 0;
+   MQINT64 start = cphUtilGetMonotonicNs();
+   for(i = 0; i < calls; i++)
+      last = cphUtilGetTimestampNs();
+   (void) last;
+   return (double) (cphUtilGetMonotonicNs() - start) / calls;
+}
+
+/*
+** Method: cphUtilGetEpochMs
+**
+** Get the current time of day, for time-stamping records that are read outside of cph.
+**
+** Returns: the number of milliseconds since 00:00:00 UTC on 1 January 1970
+**
+*/
+MQINT64 cphUtilGetEpochMs() {
+#if defined(AMQ_NT)
+   FILETIME now;
+   ULARGE_INTEGER ticks;
+   GetSystemTimeAsFileTime(&now);
+   ticks.LowPart = now.dwLowDateTime;
+   ticks.HighPart = now.dwHighDateTime;
+   /* FILETIME counts 100ns intervals since 1 January 1601 */
+   return (MQINT64) (ticks.QuadPart / 10000) - 11644473600000LL;
+#elif defined(AMQ_AS400) || defined(AMQ_MACOS)
+   struct timeval now;
+   gettimeofday(&now, NULL);
+   return (MQINT64) now.tv_sec * 1000 + now.tv_usec / 1000;
+#else
+   struct timespec now;
+   clock_gettime(CLOCK_REALTIME, &now);
+   return (MQINT64) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#endif
+}
+
 /*
 ** Method: cphUtilGetTimeDifference
 **
@@ -71,6 +71,13 @@
 /* Function prototypes */
 void cphUtilSleep( int mSecs );
 CPH_TIME cphUtilGetNow(void);
+MQINT64 cphUtilGetMonotonicNs(void);
+int cphUtilTimebaseIni(int useTsc);
+MQINT64 cphUtilGetTimestampNs(void);
+double cphUtilGetTimebaseFrequency(void);
+double cphUtilGetTimestampCost(void);
+void cphUtilSleepUntilNs(MQINT64 deadline);
+MQINT64 cphUtilGetEpochMs(void);
 int cphUtilTimeIni(CPH_TIME *pTime);
 long cphUtilGetTimeDifference(CPH_TIME time1, CPH_TIME time2);
 long cphUtilGetUsTimeDifference(CPH_TIME time1, CPH_TIME time2);